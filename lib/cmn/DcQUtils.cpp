@@ -20,6 +20,13 @@
 #include <QTime>
 #include <QSysInfo>
 #include <QStringList>
+#include <QFile>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
 
 int DcQUtils::verStrToDec( const QString& str )
 {
@@ -82,3 +89,35 @@ QString DcQUtils::getOsVersion()
     return "*nix";
 #endif
 }
+
+//-------------------------------------------------------------------------
+bool DcQUtils::syncFile( QFile& file )
+{
+    if( !file.flush() )
+    {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit( file.handle() ) == 0;
+#else
+    return ::fsync( file.handle() ) == 0;
+#endif
+}
+
+//-------------------------------------------------------------------------
+bool DcQUtils::syncDir( const QString& path )
+{
+#ifdef Q_OS_WIN
+    Q_UNUSED( path );
+    return true;
+#else
+    int fd = ::open( QFile::encodeName( path ).constData(),O_RDONLY );
+    if( fd < 0 )
+    {
+        return false;
+    }
+    bool ok = ::fsync( fd ) == 0;
+    ::close( fd );
+    return ok;
+#endif
+}
@@ -17,6 +17,8 @@
 *------------------------------------------------------------------------*/
 #include <QString>
 
+class QFile;
+
 class DcQUtils
 {
 public:
@@ -29,6 +31,16 @@ public:
      static int verStrToDec( const QString& str );
     static QString getTimeStamp();
     static QString getOsVersion();
+
+    /** Flushes the open file and asks the OS to commit it to disk.
+     *  @return bool false if the commit failed
+     */
+    static bool syncFile( QFile& file );
+
+    /** Commits the directory entry changes (e.g. a rename) in path to disk.
+     *  Does nothing on Windows.
+     */
+    static bool syncDir( const QString& path );
 protected:
 	
 private:
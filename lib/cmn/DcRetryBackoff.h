@@ -0,0 +1,61 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#pragma once
+#include <QtGlobal>
+
+/*!
+  Exponential backoff with jitter for I/O retries.  The delay before retry
+  n (starting at 0) is baseMs * 2^n, capped at maxMs, then spread by up to
+  +/- jitterPct percent so parallel retries do not line up.
+*/
+class DcRetryBackoff
+{
+public:
+    DcRetryBackoff( int baseMs = 100, int maxMs = 2000, int jitterPct = 25 )
+    {
+        setup( baseMs, maxMs, jitterPct );
+    }
+
+    void setup( int baseMs, int maxMs, int jitterPct )
+    {
+        _baseMs = qMax( 0, baseMs );
+        _maxMs = qMax( _baseMs, maxMs );
+        _jitterPct = qBound( 0, jitterPct, 100 );
+    }
+
+    int baseMs() const { return _baseMs; }
+    int maxMs() const { return _maxMs; }
+    int jitterPct() const { return _jitterPct; }
+
+    int delayMs( int attempt ) const
+    {
+        qint64 d = (qint64)_baseMs << qBound( 0, attempt, 16 );
+        d = qMin( d, (qint64)_maxMs );
+
+        int span = (int)(d * _jitterPct / 100);
+        if( span > 0 )
+        {
+            d += (qrand() % (2 * span + 1)) - span;
+        }
+        return (int)qMax( (qint64)0, d );
+    }
+
+private:
+    int _baseMs;
+    int _maxMs;
+    int _jitterPct;
+};
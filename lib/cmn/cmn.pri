@@ -14,6 +14,7 @@ HEADERS += \
       $$CMN/DcCallOnce.h \
       $$CMN/DcGlobals.h \
       $$CMN/DcSigleton.h \
+      $$CMN/DcRetryBackoff.h \
       $$CMN/DcState.h \
       $$CMN/DcStateMachineHelpers.h
       
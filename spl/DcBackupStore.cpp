@@ -0,0 +1,298 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcBackupStore.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QCryptographicHash>
+#include "DcPresetBundle.h"
+#include "cmn/DcLog.h"
+#include "cmn/DcQUtils.h"
+
+const char* DcBackupStore::kManifestSuffix = ".dcm";
+const char* DcBackupStore::kManifestMagic = "DCM1";
+
+//-------------------------------------------------------------------------
+DcBackupStore::DcBackupStore()
+    : _syncFiles(false),_bytesSaved(0)
+{
+}
+
+//-------------------------------------------------------------------------
+void DcBackupStore::setRoot( const QString& root )
+{
+    _root = QDir::cleanPath( root );
+}
+
+//-------------------------------------------------------------------------
+QString DcBackupStore::objectsPath() const
+{
+    return _root + "/objects/";
+}
+
+//-------------------------------------------------------------------------
+QString DcBackupStore::objectPath( const QString& hash ) const
+{
+    return objectsPath() + hash.left( 2 ) + "/" + hash + ".syx";
+}
+
+//-------------------------------------------------------------------------
+bool DcBackupStore::isManifest( const QString& path )
+{
+    return path.endsWith( kManifestSuffix,Qt::CaseInsensitive );
+}
+
+//-------------------------------------------------------------------------
+QString DcBackupStore::presetHash( const DcMidiData& preset, int numberOffset )
+{
+    QByteArray ba = preset.toByteArray();
+    if( numberOffset + 1 < ba.size() )
+    {
+        ba[numberOffset] = 0;
+        ba[numberOffset + 1] = 0;
+    }
+    return QCryptographicHash::hash( ba,QCryptographicHash::Sha1 ).toHex();
+}
+
+//-------------------------------------------------------------------------
+bool DcBackupStore::writeObject( const QString& hash, const DcMidiData& preset )
+{
+    QString path = objectPath( hash );
+    if( QFile::exists( path ) )
+    {
+        _bytesSaved += preset.length();
+        return true;
+    }
+
+    QDir().mkpath( QFileInfo( path ).absolutePath() );
+
+    QString tmpPath = path + ".tmp";
+    QFile file( tmpPath );
+    if( !file.open( QIODevice::WriteOnly ) )
+    {
+        _lastErrorString = "Unable to write the backup object: " + tmpPath;
+        return false;
+    }
+    QByteArray ba = preset.toByteArray();
+    bool ok = file.write( ba ) == ba.size() && file.flush();
+    if( ok && _syncFiles )
+    {
+        ok = DcQUtils::syncFile( file );
+    }
+    file.close();
+
+    // A partial object would be shared by every later backup of this preset
+    if( !ok || !QFile::rename( tmpPath,path ) )
+    {
+        _lastErrorString = "Unable to write the backup object: " + path;
+        QFile::remove( tmpPath );
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool DcBackupStore::saveBackup( const QString& manifestPath, const QString& device,
+                                const QList<DcMidiData>& presets, int numberOffset )
+{
+    QStringList lines;
+    lines << QString( "%1 %2 %3" ).arg( kManifestMagic ).arg( numberOffset ).arg( device );
+
+    foreach( const DcMidiData& md,presets )
+    {
+        QString hash = presetHash( md,numberOffset );
+        if( !writeObject( hash,md ) )
+        {
+            return false;
+        }
+        lines << QString( "%1 %2" ).arg( md.get14bit( numberOffset,0 ) ).arg( hash );
+    }
+
+    QString tmpPath = manifestPath + ".tmp";
+    QFile file( tmpPath );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Text ) )
+    {
+        _lastErrorString = "Unable to write the backup manifest: " + tmpPath;
+        return false;
+    }
+    QTextStream out( &file );
+    out << lines.join( "\n" ) << "\n";
+    out.flush();
+    bool ok = out.status() == QTextStream::Ok && file.error() == QFile::NoError;
+    if( ok && _syncFiles )
+    {
+        ok = DcQUtils::syncFile( file );
+    }
+    file.close();
+
+    if( !ok )
+    {
+        _lastErrorString = "Unable to write the backup manifest: " + tmpPath;
+        QFile::remove( tmpPath );
+        return false;
+    }
+
+    QFile::remove( manifestPath );
+    if( !QFile::rename( tmpPath,manifestPath ) )
+    {
+        _lastErrorString = "Unable to rename " + tmpPath + " to " + manifestPath;
+        QFile::remove( tmpPath );
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool DcBackupStore::restore( const QString& manifestPath, QList<DcMidiData>& presets )
+{
+    QFile file( manifestPath );
+    if( !file.open( QIODevice::ReadOnly | QIODevice::Text ) )
+    {
+        _lastErrorString = "Unable to open the file:\n" + manifestPath;
+        return false;
+    }
+
+    QTextStream in( &file );
+    QStringList hdr = in.readLine().split( ' ' );
+    if( hdr.size() < 2 || hdr.at( 0 ) != kManifestMagic )
+    {
+        _lastErrorString = manifestPath + " is not a backup manifest";
+        return false;
+    }
+    int numberOffset = hdr.at( 1 ).toInt();
+
+    while( !in.atEnd() )
+    {
+        QStringList fields = in.readLine().split( ' ',QString::SkipEmptyParts );
+        if( fields.size() != 2 )
+        {
+            continue;
+        }
+
+        QFile obj( objectPath( fields.at( 1 ) ) );
+        if( !obj.open( QIODevice::ReadOnly ) )
+        {
+            _lastErrorString = "Backup object " + fields.at( 1 ) + " is missing from " + objectsPath();
+            return false;
+        }
+
+        // Objects are shared by every slot holding the same preset, so one
+        // damaged object must not be copied into each of them
+        DcMidiData md( obj.readAll() );
+        if( md.length() < numberOffset + 2 || presetHash( md,numberOffset ) != fields.at( 1 ) )
+        {
+            _lastErrorString = "Backup object " + fields.at( 1 ) + " in " + objectsPath() + " is damaged";
+            return false;
+        }
+        md.set14bit( numberOffset,fields.at( 0 ).toInt() );
+        presets.append( md );
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool DcBackupStore::restoreToBundle( const QString& manifestPath, const QString& bundlePath )
+{
+    QList<DcMidiData> presets;
+    if( !restore( manifestPath,presets ) )
+    {
+        return false;
+    }
+
+    QFile file( bundlePath );
+    if( !file.open( QIODevice::WriteOnly ) )
+    {
+        _lastErrorString = "Unable to write the file:\n" + bundlePath;
+        return false;
+    }
+    foreach( const DcMidiData& md,presets )
+    {
+        QByteArray ba = md.toByteArray();
+        if( file.write( ba ) != ba.size() )
+        {
+            _lastErrorString = "Unable to write the file:\n" + bundlePath;
+            return false;
+        }
+    }
+    file.close();
+    return true;
+}
+
+//-------------------------------------------------------------------------
+int DcBackupStore::migrate( const QString& dir, int numberOffset, bool removeOriginals )
+{
+    int converted = 0;
+    QStringList bundles = QDir( dir ).entryList( QStringList() << "*.syx",QDir::Files );
+
+    foreach( const QString& name,bundles )
+    {
+        QString path = QDir( dir ).filePath( name );
+
+        DcPresetBundle bundle;
+        if( !bundle.open( path ) )
+        {
+            continue;
+        }
+
+        QList<DcMidiData> presets;
+        int cnt = bundle.splitSysex();
+        for( int idx = 0; idx < cnt; idx++ )
+        {
+            if( !bundle.isNak( idx ) )
+            {
+                presets.append( bundle.view( idx ) );
+            }
+        }
+        if( presets.isEmpty() )
+        {
+            continue;
+        }
+
+        // The device name is the start of the backup file name
+        QString device = QFileInfo( name ).baseName().section( '_',0,0 );
+        QString manifestPath = QDir( dir ).filePath( QFileInfo( name ).completeBaseName() + kManifestSuffix );
+        if( !saveBackup( manifestPath,device,presets,numberOffset ) )
+        {
+            DCLOG() << "Backup migration failed for " << path << ": " << _lastErrorString;
+            continue;
+        }
+        converted++;
+
+        if( removeOriginals )
+        {
+            QList<DcMidiData> check;
+            bool same = restore( manifestPath,check ) && check.size() == presets.size();
+            for( int idx = 0; same && idx < check.size(); idx++ )
+            {
+                same = check.at( idx ).toByteArray() == presets.at( idx ).toByteArray();
+            }
+
+            presets.clear();
+            bundle.close();
+            if( same )
+            {
+                QFile::remove( path );
+            }
+            else
+            {
+                DCLOG() << "Backup migration kept " << path << ", the manifest did not restore identically";
+            }
+        }
+    }
+    return converted;
+}
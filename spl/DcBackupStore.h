@@ -0,0 +1,95 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcBackupStore.h
+ \brief Content addressed preset backup store.  Each distinct preset is
+ kept once under objects/, keyed by a hash of its bytes with the preset
+ number field masked out.  A backup is a small text manifest listing the
+ preset number and object hash of each slot.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include "DcMidi/DcMidiData.h"
+
+class DcBackupStore
+{
+public:
+
+    static const char* kManifestSuffix;     // ".dcm"
+    static const char* kManifestMagic;      // "DCM1"
+
+    DcBackupStore();
+
+    /*!
+      Sets the store folder, objects are kept in <root>/objects/.
+    */
+    void setRoot( const QString& root );
+    QString root() const { return _root; }
+    QString objectsPath() const;
+
+    /*!
+      When set, objects and manifests are committed to disk before they
+      are renamed into place.
+    */
+    void setSyncFiles( bool sync ) { _syncFiles = sync; }
+
+    /*!
+      Writes any presets not already in the store and then the manifest.
+      numberOffset is the offset of the 14 bit preset number.
+    */
+    bool saveBackup( const QString& manifestPath, const QString& device,
+                     const QList<DcMidiData>& presets, int numberOffset );
+
+    /*!
+      Rebuilds the preset list recorded by a manifest.  Fails if an
+      object is missing or no longer matches its hash.
+    */
+    bool restore( const QString& manifestPath, QList<DcMidiData>& presets );
+
+    /*!
+      Rebuilds a manifest as a standard preset bundle.
+    */
+    bool restoreToBundle( const QString& manifestPath, const QString& bundlePath );
+
+    /*!
+      Converts every .syx bundle in dir to a manifest.  Originals are only
+      deleted when removeOriginals is set and the manifest restores to
+      identical bytes.  Returns the number of bundles converted.
+    */
+    int migrate( const QString& dir, int numberOffset, bool removeOriginals );
+
+    static bool isManifest( const QString& path );
+
+    /*!
+      Hash of the preset with the number field masked out, as hex.
+    */
+    static QString presetHash( const DcMidiData& preset, int numberOffset );
+
+    qint64 bytesSaved() const { return _bytesSaved; }
+    QString getLastErrorString() const { return _lastErrorString; }
+
+private:
+    QString objectPath( const QString& hash ) const;
+    bool writeObject( const QString& hash, const DcMidiData& preset );
+
+    QString _root;
+    bool _syncFiles;
+    qint64 _bytesSaved;
+    QString _lastErrorString;
+};
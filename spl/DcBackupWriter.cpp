@@ -0,0 +1,259 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcBackupWriter.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include "DcPresetArchive.h"
+#include "cmn/DcQUtils.h"
+
+//-------------------------------------------------------------------------
+DcBackupWriter::DcBackupWriter( QObject* parent /*= 0*/ )
+    : QObject(parent),_thread(this),_busy(false),_stop(false),_fsync(FsyncFile)
+{
+    _thread.start( QThread::LowPriority );
+}
+
+//-------------------------------------------------------------------------
+DcBackupWriter::~DcBackupWriter()
+{
+    {
+        QMutexLocker lock( &_mutex );
+        _stop = true;
+        _jobReady.wakeAll();
+    }
+    _thread.wait();
+}
+
+//-------------------------------------------------------------------------
+void DcBackupWriter::setStoreRoot( const QString& root )
+{
+    QMutexLocker lock( &_mutex );
+    _storeRoot = root;
+}
+
+//-------------------------------------------------------------------------
+void DcBackupWriter::setFsyncPolicy( FsyncPolicy policy )
+{
+    QMutexLocker lock( &_mutex );
+    _fsync = policy;
+}
+
+//-------------------------------------------------------------------------
+bool DcBackupWriter::enqueue( const QString& basePath, const QList<DcMidiData>& presets, Format fmt,
+                              const QString& device, const QString& fwVersion, int numberOffset )
+{
+    Job job;
+    job.BasePath = basePath;
+    job.Key = QFileInfo( basePath ).absolutePath() + "/" + device;
+    job.Presets = presets;
+    job.Fmt = fmt;
+    job.Device = device;
+    job.FwVersion = fwVersion;
+    job.NumberOffset = numberOffset;
+
+    QCryptographicHash h( QCryptographicHash::Sha1 );
+    foreach( const DcMidiData& md,presets )
+    {
+        h.addData( md.toByteArray() );
+    }
+    job.Digest = h.result();
+
+    QMutexLocker lock( &_mutex );
+
+    if( _lastDigest.value( job.Key ) == job.Digest )
+    {
+        return false;
+    }
+    _lastDigest.insert( job.Key,job.Digest );
+    job.Fsync = _fsync;
+    job.StoreRoot = _storeRoot;
+
+    // A newer backup of the same folder and device replaces a queued one
+    for( int idx = 0; idx < _queue.size(); idx++ )
+    {
+        if( _queue.at( idx ).Key == job.Key )
+        {
+            _queue[idx] = job;
+            return true;
+        }
+    }
+
+    if( _queue.size() >= kMaxQueue )
+    {
+        Job dropped = _queue.dequeue();
+
+        // It was never written, so the same data must not be coalesced later
+        if( _lastDigest.value( dropped.Key ) == dropped.Digest )
+        {
+            _lastDigest.remove( dropped.Key );
+        }
+        emit backupFailed( dropped.BasePath,"backup queue full, skipped" );
+    }
+
+    _queue.enqueue( job );
+    _jobReady.wakeOne();
+    return true;
+}
+
+//-------------------------------------------------------------------------
+void DcBackupWriter::flush()
+{
+    QMutexLocker lock( &_mutex );
+    while( !_queue.isEmpty() || _busy )
+    {
+        _idle.wait( &_mutex );
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcBackupWriter::run()
+{
+    QMutexLocker lock( &_mutex );
+
+    while( true )
+    {
+        while( _queue.isEmpty() && !_stop )
+        {
+            _idle.wakeAll();
+            _jobReady.wait( &_mutex );
+        }
+
+        // Queued backups are still written when stopping
+        if( _queue.isEmpty() )
+        {
+            break;
+        }
+
+        Job job = _queue.dequeue();
+        _busy = true;
+        lock.unlock();
+
+        QString path, error;
+        if( writeJob( job,path,error ) )
+        {
+            emit backupWritten( path );
+        }
+        else
+        {
+            emit backupFailed( path,error );
+        }
+
+        lock.relock();
+        _busy = false;
+
+        // Let the same data be backed up again after a failure
+        if( !error.isEmpty() && _lastDigest.value( job.Key ) == job.Digest )
+        {
+            _lastDigest.remove( job.Key );
+        }
+    }
+    _idle.wakeAll();
+}
+
+//-------------------------------------------------------------------------
+bool DcBackupWriter::writeJob( const Job& job, QString& path, QString& error )
+{
+    if( job.Fmt == Manifest )
+    {
+        path = job.BasePath + DcBackupStore::kManifestSuffix;
+        _store.setRoot( job.StoreRoot );
+        _store.setSyncFiles( job.Fsync != FsyncNone );
+        if( !_store.saveBackup( path,job.Device,job.Presets,job.NumberOffset ) )
+        {
+            error = _store.getLastErrorString();
+            return false;
+        }
+        if( job.Fsync == FsyncFileAndDir )
+        {
+            DcQUtils::syncDir( QFileInfo( path ).absolutePath() );
+        }
+        return true;
+    }
+
+    path = job.BasePath + (job.Fmt == Compressed ? DcPresetArchive::kSuffix : ".syx");
+    QString tmpPath = path + ".tmp";
+
+    if( job.Fmt == Compressed )
+    {
+        if( !DcPresetArchive::save( tmpPath,job.Presets,job.Device,job.FwVersion,error ) )
+        {
+            QFile::remove( tmpPath );
+            return false;
+        }
+    }
+    else
+    {
+        QFile file( tmpPath );
+        if( !file.open( QIODevice::WriteOnly ) )
+        {
+            error = "Unable to open the file: " + tmpPath;
+            return false;
+        }
+        // A short write must not be renamed over the last good backup
+        bool ok = true;
+        foreach( const DcMidiData& md,job.Presets )
+        {
+            QByteArray ba = md.toByteArray();
+            if( file.write( ba ) != ba.size() )
+            {
+                ok = false;
+                break;
+            }
+        }
+        ok = ok && file.flush();
+        file.close();
+
+        if( !ok )
+        {
+            error = "Unable to write the file: " + tmpPath;
+            QFile::remove( tmpPath );
+            return false;
+        }
+    }
+
+    return commit( tmpPath,path,job.Fsync,error );
+}
+
+//-------------------------------------------------------------------------
+bool DcBackupWriter::commit( const QString& tmpPath, const QString& path, FsyncPolicy fsync, QString& error )
+{
+    if( fsync != FsyncNone )
+    {
+        QFile file( tmpPath );
+        if( !file.open( QIODevice::ReadWrite ) || !DcQUtils::syncFile( file ) )
+        {
+            error = "Unable to commit the file: " + tmpPath;
+            return false;
+        }
+    }
+
+    QFile::remove( path );
+    if( !QFile::rename( tmpPath,path ) )
+    {
+        error = "Unable to rename " + tmpPath + " to " + path;
+        QFile::remove( tmpPath );
+        return false;
+    }
+
+    if( fsync == FsyncFileAndDir )
+    {
+        DcQUtils::syncDir( QFileInfo( path ).absolutePath() );
+    }
+    return true;
+}
@@ -0,0 +1,120 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcBackupWriter.h
+ \brief Writes preset backups on a background thread so file I/O never
+ holds up a sync.  Jobs go through a small bounded queue, identical
+ back-to-back backups are coalesced, and every file is written to a temp
+ name and renamed into place.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QHash>
+#include <QList>
+#include "DcMidi/DcMidiData.h"
+#include "DcBackupStore.h"
+
+class DcBackupWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    enum Format { Raw, Compressed, Manifest };
+
+    enum FsyncPolicy
+    {
+        FsyncNone = 0,      // leave it to the OS
+        FsyncFile,          // commit each file before it is renamed
+        FsyncFileAndDir     // also commit the rename
+    };
+
+    static const int kMaxQueue = 4;
+
+    DcBackupWriter( QObject* parent = 0 );
+    ~DcBackupWriter();
+
+    /*!
+      Set the store folder before the first Manifest backup is queued.
+    */
+    void setStoreRoot( const QString& root );
+    void setFsyncPolicy( FsyncPolicy policy );
+
+    /*!
+      Queues a backup of presets to basePath plus the suffix for fmt.
+      Returns false if it was coalesced with the previous backup of the
+      same folder and device because the data is identical.
+    */
+    bool enqueue( const QString& basePath, const QList<DcMidiData>& presets, Format fmt,
+                  const QString& device, const QString& fwVersion, int numberOffset );
+
+    /*!
+      Blocks until every queued backup has been written.
+    */
+    void flush();
+
+signals:
+    void backupWritten( const QString& path );
+    void backupFailed( const QString& path, const QString& error );
+
+private:
+    struct Job
+    {
+        QString BasePath;
+        QString Key;
+        QList<DcMidiData> Presets;
+        Format Fmt;
+        QString Device;
+        QString FwVersion;
+        int NumberOffset;
+        FsyncPolicy Fsync;
+        QString StoreRoot;
+        QByteArray Digest;
+    };
+
+    class Thread : public QThread
+    {
+    public:
+        Thread( DcBackupWriter* owner ) : _owner( owner ) {}
+    protected:
+        void run() { _owner->run(); }
+    private:
+        DcBackupWriter* _owner;
+    };
+
+    void run();
+    bool writeJob( const Job& job, QString& path, QString& error );
+    bool commit( const QString& tmpPath, const QString& path, FsyncPolicy fsync, QString& error );
+
+    Thread _thread;
+    QMutex _mutex;
+    QWaitCondition _jobReady;
+    QWaitCondition _idle;
+    QQueue<Job> _queue;
+    QHash<QString,QByteArray> _lastDigest;
+    bool _busy;
+    bool _stop;
+    FsyncPolicy _fsync;
+    QString _storeRoot;
+
+    // Only used by the writer thread
+    DcBackupStore _store;
+};
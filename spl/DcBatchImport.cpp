@@ -0,0 +1,215 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcBatchImport.h"
+#include "DcPresetBundle.h"
+#include "DcPresetArchive.h"
+#include "DcPresetSchema.h"
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <QThread>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+
+namespace
+{
+    // F0 00 01 55, the Strymon manufacturer id
+    const char kStrymonSysex[] = { '\xF0','\x00','\x01','\x55' };
+    const int  kPresetWriteCmdOffset = 6;
+    const char kPresetWriteCmd = 0x62;
+}
+
+//-------------------------------------------------------------------------
+DcBatchImport::DcBatchImport( const QByteArray& presetHdr )
+    : _hdr( presetHdr )
+{
+}
+
+//-------------------------------------------------------------------------
+QStringList DcBatchImport::collect( const QString& dir )
+{
+    QStringList files;
+    if(QFileInfo( dir ).isFile())
+    {
+        files.append( QDir::cleanPath( dir ) );
+        return files;
+    }
+
+    QDirIterator it( QDir::cleanPath( dir ),QStringList() << "*.syx" << "*.syz",QDir::Files,QDirIterator::Subdirectories );
+    while(it.hasNext())
+    {
+        files.append( it.next() );
+    }
+    files.sort();
+    return files;
+}
+
+//-------------------------------------------------------------------------
+QList<DcBatchImport::Result> DcBatchImport::run( const QStringList& files )
+{
+    _files = files;
+    _results.clear();
+    _results.resize( files.length() );
+    _next.store( 0 );
+
+    QThreadPool pool;
+    int workers = qMin( qMax( 1,QThread::idealThreadCount() ),files.length() );
+    for (int idx = 0; idx < workers; idx++)
+    {
+        pool.start( new Worker( this ) );
+    }
+
+    // Keep the window painting while the files are read
+    while(!pool.waitForDone( 50 ))
+    {
+        QCoreApplication::processEvents( QEventLoop::ExcludeUserInputEvents );
+    }
+    return _results.toList();
+}
+
+//-------------------------------------------------------------------------
+void DcBatchImport::work()
+{
+    int idx;
+    while((idx = _next.fetchAndAddOrdered( 1 )) < _files.length())
+    {
+        // Each result is only touched by the worker that claimed it
+        Result& r = _results[idx];
+        r.Path = _files.at( idx );
+        read( r );
+        classify( r );
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcBatchImport::read( Result& r ) const
+{
+    if(DcPresetArchive::isArchive( r.Path ))
+    {
+        DcPresetArchiveReader reader;
+        if(!reader.open( r.Path ))
+        {
+            r.Error = reader.getLastErrorString();
+            return;
+        }
+        DcMidiData md;
+        while(reader.next( md ))
+        {
+            r.Offsets.append( r.Messages.length() );
+            r.Messages.append( md );
+        }
+        if(!reader.atEnd())
+        {
+            r.Error = reader.getLastErrorString();
+        }
+        return;
+    }
+
+    DcPresetBundle bundle;
+    if(!bundle.open( r.Path ))
+    {
+        r.Error = bundle.getLastErrorString();
+        return;
+    }
+
+    // Copies, the mapping goes away with the bundle
+    int msgCount = bundle.splitSysex();
+    for (int idx = 0; idx < msgCount; idx++)
+    {
+        r.Offsets.append( bundle.offset( idx ) );
+        r.Messages.append( bundle.copy( idx ) );
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcBatchImport::classify( Result& r ) const
+{
+    QList<int> own;
+    bool foreign = false;
+    bool strymon = false;
+
+    for (int idx = 0; idx < r.Messages.length(); idx++)
+    {
+        const QByteArray& ba = r.Messages.at( idx ).toByteArray();
+        if(!ba.startsWith( QByteArray::fromRawData( kStrymonSysex,sizeof( kStrymonSysex ) ) ))
+        {
+            continue;
+        }
+        strymon = true;
+
+        if(ba.startsWith( _hdr ))
+        {
+            // NAK placeholders are read responses for empty slots
+            if(DcPresetRef( ba ).isValid())
+            {
+                own.append( idx );
+            }
+        }
+        else if(ba.length() > kPresetWriteCmdOffset && ba.at( kPresetWriteCmdOffset ) == kPresetWriteCmd)
+        {
+            foreign = true;
+        }
+    }
+
+    foreach(int idx,own)
+    {
+        DcPresetRef preset( r.Messages.at( idx ).toByteArray() );
+        if(preset.computeChecksum() == preset.checksum())
+        {
+            r.Presets.append( r.Messages.at( idx ) );
+        }
+        else
+        {
+            r.BadChecksums++;
+        }
+    }
+
+    if(!own.isEmpty())
+    {
+        r.Type = (r.Messages.length() == 1) ? Preset : Bundle;
+    }
+    else if(foreign)
+    {
+        r.Type = Foreign;
+    }
+    else if(strymon)
+    {
+        r.Type = Firmware;
+    }
+    else
+    {
+        r.Type = Invalid;
+        if(r.Error.isEmpty())
+        {
+            r.Error = "No Strymon sysex found";
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+QString DcBatchImport::kindName( Kind kind )
+{
+    switch (kind)
+    {
+    case Preset:    return "preset";
+    case Bundle:    return "bundle";
+    case Firmware:  return "firmware";
+    case Foreign:   return "foreign device";
+    default:        return "invalid";
+    }
+}
@@ -0,0 +1,97 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcBatchImport.h
+ \brief Reads and classifies a folder of preset files on a thread pool.
+ Each file is read once, its sysex messages are copied out and its
+ presets for the current device are checksum validated, so the caller
+ can merge every result into the work list or library in one step.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVector>
+#include <QRunnable>
+#include <QAtomicInt>
+#include "DcMidi/DcMidiData.h"
+
+class DcBatchImport
+{
+public:
+
+    enum Kind
+    {
+        Preset,     // a single preset for the current device
+        Bundle,     // several presets for the current device
+        Firmware,   // Strymon sysex that is not presets
+        Foreign,    // presets for another device
+        Invalid     // unreadable, or not Strymon sysex
+    };
+
+    struct Result
+    {
+        Result() : Type( Invalid ),BadChecksums( 0 ) {}
+
+        QString Path;
+        Kind Type;
+        QList<DcMidiData> Messages;     // every message in the file
+        QList<qint64> Offsets;          // byte offsets, or ordinals for a .syz
+        QList<DcMidiData> Presets;      // valid presets for the current device
+        int BadChecksums;
+        QString Error;
+    };
+
+    /*!
+      presetHdr is the preset write header of the current device, files
+      with other Strymon presets are classified as Foreign.
+    */
+    DcBatchImport( const QByteArray& presetHdr );
+
+    /*!
+      Every .syx and .syz file under dir, or dir itself when it is a
+      file, e.g. a library root added by importing a single file.
+    */
+    static QStringList collect( const QString& dir );
+
+    /*!
+      Reads and classifies the files on a thread pool and blocks until all
+      are done.  Results are in the same order as files.
+    */
+    QList<Result> run( const QStringList& files );
+
+    static QString kindName( Kind kind );
+
+private:
+    class Worker : public QRunnable
+    {
+    public:
+        Worker( DcBatchImport* owner ) : _owner( owner ) {}
+        void run() { _owner->work(); }
+    private:
+        DcBatchImport* _owner;
+    };
+
+    void work();
+    void read( Result& r ) const;
+    void classify( Result& r ) const;
+
+    QByteArray _hdr;
+    QStringList _files;
+    QVector<Result> _results;
+    QAtomicInt _next;
+};
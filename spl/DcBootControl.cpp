@@ -6,6 +6,8 @@
 #include <QThread>
 #include "DcMidi/DcMidiIdent.h"
 #include <QApplication>
+#include <QEventLoop>
+#include <QTimer>
 #include "cmn/DcLog.h"
 
 const char* DcBootControl::kPrivateResetPartial = "F0 00 01 55 vv vv 1B F7";
@@ -15,7 +17,7 @@ const char* DcBootControl::kFUFailed = "F0 00 01 55 42 0C 02 F7";
 const char* DcBootControl::kFUResponcePattern = "F0 00 01 55 42 0C .. F7";
 
 DcBootControl::DcBootControl( DcMidiIn& i, DcMidiOut& o, DcDeviceDetails& d)
-    : _pMidiIn(&i),_pMidiOut(&o),_pDevDetails(&d),_blindMode(d.CrippledIo)
+    : _pMidiIn(&i),_pMidiOut(&o),_pDevDetails(&d),_blindMode(d.CrippledIo),_fuTimedOut(false)
 {
     _lastErrorMsg.setString(&_lastErrorMsgStr);
 }
@@ -182,56 +184,104 @@ bool DcBootControl::writeFirmwareUpdateMsg(DcMidiData& msg,int timeOutMs /*= 200
      _pMidiOut->dataOut(msg);
 
     DcMidiData md;
+    _fuTimedOut = false;
 
     // Wait for the response data, or timeout after 300ms
     if(autotc.wait(timeOutMs))
     {
         if(autotc.dequeue(md))
         {
+            rtval = checkFirmwareReply(md);
+        }
+    }
+    else
+    {
+        _fuTimedOut = true;
+        DCLOG() << "Timeout waiting on " << msg.toString(' ') << "\n";
+        _lastErrorMsg << "Firmware update failure - timeout after write command.\n" << msg.toString(' ').mid(15,38);
+    }
+
+    return rtval;
+}
+
+//-------------------------------------------------------------------------
+bool DcBootControl::waitForLateFirmwareReply(int waitMs)
+{
+    bool rtval = false;
+    bool acceptLate = _fuTimedOut;
+    const char* pattern = _blindMode ? "F0 00 01 55" : kFUResponcePattern;
+    _fuTimedOut = false;
+
+    // Run the backoff in a local event loop so the UI keeps painting.  If the
+    // last write timed out its status may still show up here, and a good one
+    // ends the wait early.
+    QEventLoop loop;
+    QTimer::singleShot( waitMs, &loop, SLOT(quit()) );
 
-          if(_blindMode )
+    if( acceptLate )
+    {
+        QObject::connect( _pMidiIn, &DcMidiIn::dataIn, &loop, [&](const DcMidiData& data)
+        {
+            if( rtval || !data.contains( pattern ) )
             {
-                if(md.match("F0 00 01 55 42 00") )
-                {
-                    md = kFUGood;
-                }
-                else if(md.match("F0 00 01 55 42 01") )
-                {
-                    DCLOG() << "RECVD: " << md.toString(' ');
-                    md = kFUBad;
-                }
-                else if(md.match("F0 00 01 55 42 02"))
-                {
-                    DCLOG() << "RECVD: " << md.toString(' ');
-                    md = kFUFailed;
-                }
+                return;
             }
 
-            if( md == kFUGood )
+            DCLOG() << "Late firmware write status received";
+            DcMidiData md = data;
+            if( checkFirmwareReply( md ) )
             {
                 rtval = true;
+                loop.quit();
             }
-            else if( md == kFUBad )
-            {
-                DCLOG() << "kFUBad";
-                _lastErrorMsg << "Device reject firmware command - BAD packet.";
-            }
-            else if( md == kFUFailed )
-            {
-                DCLOG() << "kFUFailed";
-                _lastErrorMsg << "Device failed firmware command.";
-            }
-            else
-            {
-                DCLOG() << "Unknown response: " << md.toString( ' ' ) << "\n";
-                _lastErrorMsg << "Firmware write generated an unknown response from the device.";
-            }
+        });
+    }
+
+    loop.exec();
+    return rtval;
+}
+
+//-------------------------------------------------------------------------
+bool DcBootControl::checkFirmwareReply(DcMidiData& md)
+{
+    bool rtval = false;
+
+    if(_blindMode )
+    {
+        if(md.match("F0 00 01 55 42 00") )
+        {
+            md = kFUGood;
         }
+        else if(md.match("F0 00 01 55 42 01") )
+        {
+            DCLOG() << "RECVD: " << md.toString(' ');
+            md = kFUBad;
+        }
+        else if(md.match("F0 00 01 55 42 02"))
+        {
+            DCLOG() << "RECVD: " << md.toString(' ');
+            md = kFUFailed;
+        }
+    }
+
+    if( md == kFUGood )
+    {
+        rtval = true;
+    }
+    else if( md == kFUBad )
+    {
+        DCLOG() << "kFUBad";
+        _lastErrorMsg << "Device reject firmware command - BAD packet.";
+    }
+    else if( md == kFUFailed )
+    {
+        DCLOG() << "kFUFailed";
+        _lastErrorMsg << "Device failed firmware command.";
     }
     else
     {
-        DCLOG() << "Timeout waiting on " << msg.toString(' ') << "\n";
-        _lastErrorMsg << "Firmware update failure - timeout after write command.\n" << msg.toString(' ').mid(15,38);
+        DCLOG() << "Unknown response: " << md.toString( ' ' ) << "\n";
+        _lastErrorMsg << "Firmware write generated an unknown response from the device.";
     }
 
     return rtval;
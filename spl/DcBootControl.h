@@ -296,6 +296,13 @@ public:
       wait for status. 
     */ 
     bool writeFirmwareUpdateMsg(DcMidiData& msg,int timeOutMs = 2000);
+
+    /*!
+      Call after writeFirmwareUpdateMsg() fails, before retrying.  Waits
+      waitMs without blocking the event loop.  If the write timed out, a
+      late status reply reporting success ends the wait and returns true.
+    */ 
+    bool waitForLateFirmwareReply(int waitMs);
     
     /*!
        Causes the device to "launch" the active FLASH 
@@ -339,6 +346,8 @@ public:
     bool isBlindMode();
 private:
 
+    bool checkFirmwareReply(DcMidiData& md);
+
     DcMidiIn*   _pMidiIn;
     DcMidiOut* _pMidiOut;
     DcDeviceDetails* _pDevDetails;
@@ -347,6 +356,7 @@ private:
     // This feature was added as a workaround for MIDI devices that have problems with messages larger than 4 bytes.
     // This is a gross work-around/last resort mode of operation.
     bool        _blindMode;
+    bool        _fuTimedOut;
     QTextStream _lastErrorMsg;
     QString     _lastErrorMsgStr;    
 };
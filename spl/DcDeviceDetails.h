@@ -16,6 +16,7 @@
 *-------------------------------------------------------------------------*/
 #pragma once
 #include "DcMidi/DcMidiIdent.h"
+#include "DcPresetCodec.h"
 #include <qglobal.h>
 
 struct DcDeviceDetails : public DcMidiDevIdent
@@ -46,6 +47,7 @@ struct DcDeviceDetails : public DcMidiDevIdent
         PresetNameOffset = 0;
         DeviceIconResPath.clear();
         CrippledIo = false;
+        Codec.clear();
     }
 
     bool isEmpty()
@@ -89,6 +91,9 @@ struct DcDeviceDetails : public DcMidiDevIdent
     QRegExp PresetRd_ACK;
     bool     CrippledIo;
 
+    // Transfer encoding selected for the connected firmware
+    DcPresetCodec Codec;
+
 
 };
 
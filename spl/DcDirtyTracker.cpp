@@ -0,0 +1,142 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcDirtyTracker.h"
+#include <QHash>
+
+//-------------------------------------------------------------------------
+DcDirtyTracker::DcDirtyTracker()
+    : _device( 0 ),_work( 0 ),_count( 0 )
+{
+}
+
+//-------------------------------------------------------------------------
+void DcDirtyTracker::setLists( const DcPresetBank* deviceList,const DcPresetBank* workList )
+{
+    _device = deviceList;
+    _work = workList;
+    clear();
+}
+
+//-------------------------------------------------------------------------
+uint DcDirtyTracker::hashOf( const DcPresetBank& bank,int row )
+{
+    return qHash( bank.view( row ) );
+}
+
+//-------------------------------------------------------------------------
+void DcDirtyTracker::rescan()
+{
+    clear();
+    if(!_device || !_work)
+    {
+        return;
+    }
+
+    _deviceHash.resize( _device->length() );
+    for (int row = 0; row < _device->length(); row++)
+    {
+        _deviceHash[row] = hashOf( *_device,row );
+    }
+
+    _workHash.resize( _work->length() );
+    for (int row = 0; row < _work->length(); row++)
+    {
+        _workHash[row] = hashOf( *_work,row );
+    }
+
+    // Only rows present in both lists can be dirty
+    _dirty.resize( qMin( _device->length(),_work->length() ) );
+    for (int row = 0; row < _dirty.size(); row++)
+    {
+        refresh( row );
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcDirtyTracker::clear()
+{
+    _deviceHash.clear();
+    _workHash.clear();
+    _dirty.clear();
+    _count = 0;
+}
+
+//-------------------------------------------------------------------------
+bool DcDirtyTracker::workRowChanged( int row )
+{
+    if(row < 0 || row >= _workHash.size())
+    {
+        return false;
+    }
+    _workHash[row] = hashOf( *_work,row );
+    return refresh( row );
+}
+
+//-------------------------------------------------------------------------
+bool DcDirtyTracker::deviceRowChanged( int row )
+{
+    if(row < 0 || row >= _deviceHash.size())
+    {
+        return false;
+    }
+    _deviceHash[row] = hashOf( *_device,row );
+    return refresh( row );
+}
+
+//-------------------------------------------------------------------------
+QList<int> DcDirtyTracker::rows() const
+{
+    QList<int> result;
+    for (int row = 0; row < _dirty.size() && result.length() < _count; row++)
+    {
+        if(_dirty.testBit( row ))
+        {
+            result.append( row );
+        }
+    }
+    return result;
+}
+
+//-------------------------------------------------------------------------
+bool DcDirtyTracker::differs( int row ) const
+{
+    // Different hashes are conclusive, equal hashes are confirmed byte for byte
+    if(_workHash.at( row ) != _deviceHash.at( row ))
+    {
+        return true;
+    }
+    return !_work->equals( row,*_device,row );
+}
+
+//-------------------------------------------------------------------------
+bool DcDirtyTracker::refresh( int row )
+{
+    if(row >= _dirty.size())
+    {
+        return false;
+    }
+
+    bool dirty = differs( row );
+    if(dirty == _dirty.testBit( row ))
+    {
+        return false;
+    }
+
+    _dirty.setBit( row,dirty );
+    _count += dirty ? 1 : -1;
+    return true;
+}
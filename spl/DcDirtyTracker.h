@@ -0,0 +1,76 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcDirtyTracker.h
+ \brief Tracks which work list rows differ from the device list.  Each
+ row keeps a cached hash of both sides, so an edit only re-hashes and
+ compares the rows it touched.  A full rescan is only needed when either
+ list is replaced.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QList>
+#include <QVector>
+#include <QBitArray>
+#include "DcPresetBank.h"
+
+class DcDirtyTracker
+{
+public:
+    DcDirtyTracker();
+
+    /*!
+      The lists being compared, they must outlive the tracker.
+    */
+    void setLists( const DcPresetBank* deviceList,const DcPresetBank* workList );
+
+    /*!
+      Re-hashes and compares every row.  Call after either list is replaced.
+    */
+    void rescan();
+
+    /*!
+      Forgets all rows, nothing is dirty until the next rescan.
+    */
+    void clear();
+
+    /*!
+      Call after a row of the work list or device list was changed in
+      place.  Returns true when the dirty state of the row flipped.
+    */
+    bool workRowChanged( int row );
+    bool deviceRowChanged( int row );
+
+    bool isDirty( int row ) const { return row >= 0 && row < _dirty.size() && _dirty.testBit( row ); }
+    int count() const { return _count; }
+
+    /*!
+      Dirty rows in ascending order.
+    */
+    QList<int> rows() const;
+
+private:
+    static uint hashOf( const DcPresetBank& bank,int row );
+    bool differs( int row ) const;
+    bool refresh( int row );
+
+    const DcPresetBank* _device;
+    const DcPresetBank* _work;
+    QVector<uint> _deviceHash;
+    QVector<uint> _workHash;
+    QBitArray _dirty;
+    int _count;
+};
@@ -15,12 +15,59 @@
 
 *-------------------------------------------------------------------------*/
 #include "DcListWidget.h"
+#include <QItemSelectionModel>
 
 
+DcListWidget::DcListWidget( QWidget * parent ) :
+    QListView(parent)
+{
+    connect(this,&QAbstractItemView::doubleClicked,this,[this](const QModelIndex&) { emit itemDoubleClicked(); });
+}
+
+void DcListWidget::setModel( QAbstractItemModel* model )
+{
+    QListView::setModel(model);
+
+    // The selection model is replaced along with the model
+    QItemSelectionModel* sm = selectionModel();
+    connect(sm,&QItemSelectionModel::selectionChanged,this,[this]() { emit itemSelectionChanged(); });
+    connect(sm,&QItemSelectionModel::currentRowChanged,this,[this](const QModelIndex& current) { emit currentRowChanged(current.isValid() ? current.row() : -1); });
+}
+
+int DcListWidget::count() const
+{
+    return model() ? model()->rowCount() : 0;
+}
+
+int DcListWidget::currentRow() const
+{
+    QModelIndex idx = currentIndex();
+    return idx.isValid() ? idx.row() : -1;
+}
+
+QString DcListWidget::rowText( int row ) const
+{
+    return model() ? model()->index(row,0).data().toString() : QString();
+}
+
+QList<int> DcListWidget::selectedRows() const
+{
+    QList<int> rows;
+    if(selectionModel())
+    {
+        foreach(const QModelIndex& idx,selectionModel()->selectedRows())
+        {
+            rows.append(idx.row());
+        }
+    }
+    qSort(rows);
+    return rows;
+}
+
 void DcListWidget::dragEnterEvent( QDragEnterEvent *e )
 {
     qDebug() << e->source()->objectName();
-    qDebug() << "Enter: " << e->pos() << this->itemAt(e->pos())->text();
+    qDebug() << "Enter: " << e->pos() << indexAt(e->pos()).data().toString();
     e->accept();
 }
 
@@ -31,7 +78,11 @@ void DcListWidget::dragLeaveEvent( QDragLeaveEvent *event )
 
 void DcListWidget::dropEvent( QDropEvent *e )
 {
-    qDebug() << this->selectedItems()[0]->text() << "Replaces " << this->itemAt(e->pos())->text();
+    QList<int> rows = selectedRows();
+    if(rows.length())
+    {
+        qDebug() << rowText(rows.first()) << "Replaces " << indexAt(e->pos()).data().toString();
+    }
     e->accept();
 }
 
@@ -39,10 +90,10 @@ void DcListWidget::dragMoveEvent( QDragMoveEvent *e )
 {
     qDebug() << "dragMoveEvent";
 
-     QListWidgetItem* i = this->itemAt(e->pos());
-     if(i)
+     QModelIndex i = this->indexAt(e->pos());
+     if(i.isValid())
      {
-         qDebug() << i->text();
+         qDebug() << i.data().toString();
      }
      e->accept();
 }
@@ -19,18 +19,36 @@
 
 #pragma once
 
-#include <QListWidget>
+#include <QListView>
 #include <QDebug>
 #include <QDropEvent>
 
-class DcListWidget : public QListWidget {
+/*!
+  List view for the work list.  Rows come from a DcPresetListModel, the
+  signals and row helpers keep the QListWidget style used by DcPresetLib.
+*/
+class DcListWidget : public QListView {
+
+    Q_OBJECT
 
 public:
-    DcListWidget(QWidget * parent) :
-        QListWidget(parent) {}
+    DcListWidget(QWidget * parent);
+
+    void setModel(QAbstractItemModel* model);
+
+    int count() const;
+    int currentRow() const;
+    QString rowText(int row) const;
+
+    /*!
+      Selected rows in ascending order.
+    */
+    QList<int> selectedRows() const;
 
 signals:
-    void foo();
+    void itemSelectionChanged();
+    void itemDoubleClicked();
+    void currentRowChanged(int row);
 
 protected:
      void dragEnterEvent(QDragEnterEvent *event);
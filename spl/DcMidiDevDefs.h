@@ -18,6 +18,7 @@
 
 #include <QHash>
 #include <QByteArray>
+#include "DcPresetSchema.h"
 
 /* Identity Request Response
     0xF0  SysEx
@@ -148,12 +149,14 @@ static const char* kTimeLineIdentResponceExample = "\
     20 43 4F 50 53 20 20 20 55 F7";
 */
 
-static const int kPresetNameOffset = 632;
-static const int kPresetNameLen    = 16;
-static const int kPreseLength      = 650;
-static const int kPresetDataOffset  = 9;
-static const int kPresetDataLength  =  650-9-2;
-static const int kPresetChecksumOffset =  648;
+// Defaults for code that runs before a device is known, see DcPresetSchema.h
+static const int kPresetNameOffset = DcPresetSchema::kLayouts[0].offset( DcPresetSchema::Name );
+static const int kPresetNameLen    = DcPresetSchema::kLayouts[0].width( DcPresetSchema::Name );
+static const int kPreseLength      = DcPresetSchema::kLayouts[0].Size;
+static const int kPresetNumberOffset = DcPresetSchema::kLayouts[0].offset( DcPresetSchema::Number );
+static const int kPresetDataOffset  = DcPresetSchema::kLayouts[0].offset( DcPresetSchema::Data );
+static const int kPresetDataLength  = DcPresetSchema::kLayouts[0].width( DcPresetSchema::Data );
+static const int kPresetChecksumOffset = DcPresetSchema::kLayouts[0].offset( DcPresetSchema::Checksum );
 static const int kPreseChecksumOffset      = kPreseLength - 1;
 
 
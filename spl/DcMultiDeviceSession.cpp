@@ -0,0 +1,337 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcMultiDeviceSession.h"
+#include <QVBoxLayout>
+#include <QDialogButtonBox>
+#include <QPushButton>
+#include <QTextStream>
+#include "DcPresetLib.h"
+#include "DcMidiDevDefs.h"
+#include "PresetLibSMDefs.h"
+#include "cmn/DcLog.h"
+
+//-------------------------------------------------------------------------
+DcDeviceSession::DcDeviceSession( const QString& inPort, const QString& outPort, QObject* parent /*= 0*/ )
+    : QObject(parent),_inPort(inPort),_outPort(outPort),_progress(0),_op(Fetch),
+      _maxMsgSize(-1),_delayPerMsgChunk(-1),_done(false),_ok(false)
+{
+    DcState* done   = new DcState( QString("sessionDone"), _outPort );
+    DcState* error  = new DcState( QString("sessionError"), _outPort );
+    DcState* cancel = new DcState( QString("sessionCancel"), _outPort );
+    _machine.addState( done );
+    _machine.addState( error );
+    _machine.addState( cancel );
+
+    QObject::connect( done, SIGNAL(entered()), this, SLOT(xferDone_entered()) );
+    QObject::connect( error, SIGNAL(entered()), this, SLOT(xferError_entered()) );
+    QObject::connect( cancel, SIGNAL(entered()), this, SLOT(xferCancel_entered()) );
+
+    _xferState = _xfer.setupStateMachine( &_machine, &_midiOut, done, error, cancel );
+    _machine.setInitialState( _xferState );
+
+    _idTimer.setSingleShot( true );
+    QObject::connect( &_idTimer, &QTimer::timeout, this, &DcDeviceSession::idTimeout );
+}
+
+//-------------------------------------------------------------------------
+DcDeviceSession::~DcDeviceSession()
+{
+    _machine.stop();
+    _midiIn.close();
+    _midiOut.close();
+}
+
+//-------------------------------------------------------------------------
+void DcDeviceSession::setThroughput( int maxMsgSize, int delayPerMsgChunk, const DcRetryBackoff& backoff )
+{
+    _maxMsgSize = maxMsgSize;
+    _delayPerMsgChunk = delayPerMsgChunk;
+    _xfer.setRetryBackoff( backoff );
+}
+
+//-------------------------------------------------------------------------
+QString DcDeviceSession::label() const
+{
+    QString name = _devDetails.Name.isEmpty() ? QString("Device") : _devDetails.Name;
+    return QString( "%1 on %2 / %3" ).arg( name ).arg( _inPort ).arg( _outPort );
+}
+
+//-------------------------------------------------------------------------
+void DcDeviceSession::start( Op op, IoProgressDialog* progress )
+{
+    _op = op;
+    _progress = progress;
+    _done = false;
+    _ok = false;
+    _result.clear();
+
+    _progress->reset();
+    _progress->setLableText( label() );
+    _progress->setMessage( "Identifying device" );
+
+    _midiIn.init();
+    _midiOut.init();
+
+    if( !_midiIn.open( _inPort ) )
+    {
+        complete( false, "Unable to open MIDI IN: " + _midiIn.getLastErrorString() );
+        return;
+    }
+
+    if( !_midiOut.open( _outPort ) )
+    {
+        complete( false, "Unable to open MIDI OUT: " + _midiOut.getLastErrorString() );
+        return;
+    }
+
+    _midiOut.setMaxPacketSize( _maxMsgSize );
+    _midiOut.setDelayBetweenBackets( _delayPerMsgChunk );
+
+    QObject::connect( &_midiIn, &DcMidiIn::dataIn, this, &DcDeviceSession::recvIdData );
+    _idTimer.start( kIdentTimeoutMs );
+    _midiOut.dataOut( "F0 7E 7F 06 01 F7" );
+}
+
+//-------------------------------------------------------------------------
+void DcDeviceSession::recvIdData( const DcMidiData& data )
+{
+    if( !data.contains( DcMidiDevDefs::kIdentReply ) )
+    {
+        return;
+    }
+
+    _devDetails.fromIdentData( data );
+
+    // Other devices on the same port may answer too, wait for a supported one
+    if( !DcPresetLib::updateDeviceDetails( data, _devDetails ) )
+    {
+        return;
+    }
+
+    _idTimer.stop();
+    QObject::disconnect( &_midiIn, &DcMidiIn::dataIn, this, &DcDeviceSession::recvIdData );
+
+    DCLOG() << "Session: found " << _devDetails.Name << " fw " << _devDetails.FwVersion << " on " << _inPort;
+    startTransfer();
+}
+
+//-------------------------------------------------------------------------
+void DcDeviceSession::idTimeout()
+{
+    QObject::disconnect( &_midiIn, &DcMidiIn::dataIn, this, &DcDeviceSession::recvIdData );
+    complete( false, "No supported device responded" );
+}
+
+//-------------------------------------------------------------------------
+void DcDeviceSession::startTransfer()
+{
+    _xfer.reset( _op == Write );
+
+    if( _op == Fetch )
+    {
+        DcMidiData cmd;
+        for( int presetId = 0; presetId < _devDetails.PresetCount; presetId++ )
+        {
+            cmd.setData( _devDetails.PresetReadTemplate, presetId );
+            _xfer.append( cmd );
+        }
+        QObject::connect( &_midiIn, &DcMidiIn::dataIn, &_xfer, &DcXferMachine::replySlotForDataIn );
+    }
+    else
+    {
+        QByteArray hdr = _devDetails.SOXHdr.toByteArray();
+        for( int i = 0; i < _writeList.length(); i++ )
+        {
+            DcMidiData md = _writeList.at( i );
+            if( md.contains( "F0 00 01 55 XX XX 62 XX XX 47 F7" ) )
+            {
+                continue;
+            }
+
+            if( !md.toByteArray().startsWith( hdr ) || md.length() != _devDetails.PresetSize )
+            {
+                complete( false, "The presets are not for a " + _devDetails.Name );
+                return;
+            }
+            _xfer.append( md );
+        }
+        QObject::connect( &_midiIn, &DcMidiIn::dataIn, &_xfer, &DcXferMachine::replySlotForDataOut );
+    }
+
+    _progress->setLableText( label() );
+    _xfer.setProgressDialog( _progress );
+    _xfer.go( &_devDetails );
+
+    _machine.start();
+}
+
+//-------------------------------------------------------------------------
+void DcDeviceSession::xferDone_entered()
+{
+    _machine.stop();
+    int cnt = (_op == Fetch) ? _xfer.getDataList().length() : _xfer.getCmdsWritten().length();
+    complete( true, QString( "%1 presets %2" ).arg( cnt ).arg( _op == Fetch ? "fetched" : "written" ) );
+}
+
+//-------------------------------------------------------------------------
+void DcDeviceSession::xferError_entered()
+{
+    _machine.stop();
+    complete( false, "Transfer failed: " + _xfer.getStats().Result );
+}
+
+//-------------------------------------------------------------------------
+void DcDeviceSession::xferCancel_entered()
+{
+    _machine.stop();
+    complete( false, "Cancelled" );
+}
+
+//-------------------------------------------------------------------------
+void DcDeviceSession::complete( bool ok, const QString& result )
+{
+    QObject::disconnect( &_midiIn, &DcMidiIn::dataIn, 0, 0 );
+    _midiIn.close();
+    _midiOut.close();
+
+    _done = true;
+    _ok = ok;
+    _result = result;
+    DCLOG() << "Session " << label() << ": " << result;
+
+    _progress->show();
+    _progress->setNoCancel( true );
+    _progress->setLableText( label() );
+    if( ok )
+    {
+        _progress->setMessage( result );
+    }
+    else
+    {
+        _progress->setError( result );
+    }
+
+    emit finished( this );
+}
+
+//-------------------------------------------------------------------------
+DcMultiDeviceSession::DcMultiDeviceSession( QWidget* parent )
+    : QObject(parent),_parent(parent),_pending(0),_maxMsgSize(-1),_delayPerMsgChunk(-1)
+{
+    _view = new QDialog( parent );
+    _view->setWindowTitle( "Multi-device transfer" );
+    _rows = new QVBoxLayout( _view );
+
+    QDialogButtonBox* buttons = new QDialogButtonBox( QDialogButtonBox::Close, _view );
+    QPushButton* cancel = buttons->addButton( "Cancel All", QDialogButtonBox::RejectRole );
+    QObject::connect( cancel, SIGNAL(clicked()), this, SLOT(cancelAll()) );
+    QObject::connect( buttons->button( QDialogButtonBox::Close ), SIGNAL(clicked()), _view, SLOT(hide()) );
+    _rows->addWidget( buttons );
+}
+
+//-------------------------------------------------------------------------
+DcMultiDeviceSession::~DcMultiDeviceSession()
+{
+    qDeleteAll( _sessions );
+    delete _view;
+}
+
+//-------------------------------------------------------------------------
+void DcMultiDeviceSession::setThroughput( int maxMsgSize, int delayPerMsgChunk, const DcRetryBackoff& backoff )
+{
+    _maxMsgSize = maxMsgSize;
+    _delayPerMsgChunk = delayPerMsgChunk;
+    _backoff = backoff;
+}
+
+//-------------------------------------------------------------------------
+void DcMultiDeviceSession::addPortPair( const QString& inPort, const QString& outPort )
+{
+    DcDeviceSession* s = new DcDeviceSession( inPort, outPort );
+    QObject::connect( s, &DcDeviceSession::finished, this, &DcMultiDeviceSession::sessionFinished );
+    _sessions.append( s );
+
+    // The progress dialogs are used as rows of the combined view
+    IoProgressDialog* p = new IoProgressDialog( _view );
+    p->setWindowFlags( Qt::Widget );
+    _rows->insertWidget( _rows->count() - 1, p );
+    _progress.append( p );
+}
+
+//-------------------------------------------------------------------------
+bool DcMultiDeviceSession::start( DcDeviceSession::Op op, const DcMidiDataList_t& writeList /*= DcMidiDataList_t()*/ )
+{
+    if( isRunning() || _sessions.isEmpty() )
+    {
+        return false;
+    }
+
+    _pending = _sessions.length();
+    _timer.start();
+    _view->show();
+
+    for( int i = 0; i < _sessions.length(); i++ )
+    {
+        DcDeviceSession* s = _sessions.at( i );
+        s->setThroughput( _maxMsgSize, _delayPerMsgChunk, _backoff );
+        s->setWriteList( writeList );
+        s->start( op, _progress.at( i ) );
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+void DcMultiDeviceSession::cancelAll()
+{
+    for( int i = 0; i < _sessions.length(); i++ )
+    {
+        if( !_sessions.at( i )->isDone() )
+        {
+            _progress.at( i )->reject();
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcMultiDeviceSession::sessionFinished( DcDeviceSession* session )
+{
+    Q_UNUSED( session );
+    if( --_pending == 0 )
+    {
+        DCLOG() << "Multi-device transfer finished in " << _timer.elapsed() << " ms\n" << summary();
+        emit finished();
+    }
+}
+
+//-------------------------------------------------------------------------
+QString DcMultiDeviceSession::summary() const
+{
+    QString s;
+    QTextStream ts( &s );
+    foreach( DcDeviceSession* d, _sessions )
+    {
+        ts << (d->succeeded() ? "OK    " : "FAILED") << "  " << d->label() << ": " << d->resultString();
+        if( d->getStats().ElapsedMs )
+        {
+            ts << " (" << d->getStats().ElapsedMs << " ms, " << d->getStats().bytesPerSec() << " bytes/sec)";
+        }
+        ts << "\n";
+    }
+    ts << "Total time: " << _timer.elapsed() << " ms\n";
+    ts.flush();
+    return s;
+}
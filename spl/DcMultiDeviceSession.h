@@ -0,0 +1,149 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcMultiDeviceSession.h
+ \brief Runs preset fetches or writes on several MIDI port pairs at once.
+ Each port pair gets its own MIDI ports, device details, throughput
+ settings and transfer engine, so a slow or flaky pedal only holds up
+ itself.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QObject>
+#include <QStateMachine>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDialog>
+#include "DcMidi/DcMidiIn.h"
+#include "DcMidi/DcMidiOut.h"
+#include "DcDeviceDetails.h"
+#include "DcXferMachine.h"
+#include "IoProgressDialog.h"
+
+class QVBoxLayout;
+
+/*!
+  A single device transfer: identify the device on the port pair, then
+  fetch all of its presets or write the given list.
+*/
+class DcDeviceSession : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    enum Op { Fetch, Write };
+
+    static const int kIdentTimeoutMs = 1500;
+
+    DcDeviceSession( const QString& inPort, const QString& outPort, QObject* parent = 0 );
+    ~DcDeviceSession();
+
+    void setThroughput( int maxMsgSize, int delayPerMsgChunk, const DcRetryBackoff& backoff );
+    void setWriteList( const DcMidiDataList_t& presets ) { _writeList = presets; }
+
+    /*!
+      Opens the ports and starts the session, finished() is always emitted,
+      even when the ports can not be opened.
+    */
+    void start( Op op, IoProgressDialog* progress );
+
+    QString label() const;
+    bool isDone() const { return _done; }
+    bool succeeded() const { return _ok; }
+    QString resultString() const { return _result; }
+    DcDeviceDetails& deviceDetails() { return _devDetails; }
+    DcMidiDataList_t getDataList() { return _xfer.getDataList(); }
+    const DcXferStats& getStats() const { return _xfer.getStats(); }
+
+signals:
+    void finished( DcDeviceSession* session );
+
+private slots:
+    void recvIdData( const DcMidiData& data );
+    void idTimeout();
+    void xferDone_entered();
+    void xferError_entered();
+    void xferCancel_entered();
+
+private:
+    void startTransfer();
+    void complete( bool ok, const QString& result );
+
+    QString _inPort;
+    QString _outPort;
+    DcMidiIn _midiIn;
+    DcMidiOut _midiOut;
+    DcDeviceDetails _devDetails;
+    DcXferMachine _xfer;
+    QStateMachine _machine;
+    DcState* _xferState;
+    QTimer _idTimer;
+    IoProgressDialog* _progress;
+    DcMidiDataList_t _writeList;
+
+    Op _op;
+    int _maxMsgSize;
+    int _delayPerMsgChunk;
+    bool _done;
+    bool _ok;
+    QString _result;
+};
+
+/*!
+  Owns a set of device sessions and a combined progress view with one
+  progress row per device.
+*/
+class DcMultiDeviceSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    DcMultiDeviceSession( QWidget* parent );
+    ~DcMultiDeviceSession();
+
+    void addPortPair( const QString& inPort, const QString& outPort );
+    void setThroughput( int maxMsgSize, int delayPerMsgChunk, const DcRetryBackoff& backoff );
+
+    bool start( DcDeviceSession::Op op, const DcMidiDataList_t& writeList = DcMidiDataList_t() );
+    bool isRunning() const { return _pending > 0; }
+
+    const QList<DcDeviceSession*>& sessions() const { return _sessions; }
+
+    /*!
+      One line per device with the outcome and throughput.
+    */
+    QString summary() const;
+
+signals:
+    void finished();
+
+private slots:
+    void sessionFinished( DcDeviceSession* session );
+    void cancelAll();
+
+private:
+    QWidget* _parent;
+    QDialog* _view;
+    QVBoxLayout* _rows;
+    QList<DcDeviceSession*> _sessions;
+    QList<IoProgressDialog*> _progress;
+    int _pending;
+    int _maxMsgSize;
+    int _delayPerMsgChunk;
+    DcRetryBackoff _backoff;
+    QElapsedTimer _timer;
+};
@@ -0,0 +1,318 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPortScanner.h"
+#include <QDateTime>
+#include <QRegExp>
+#include <algorithm>
+#include "DcMidiDevDefs.h"
+#include "DcDeviceDetails.h"
+#include "DcPresetLib.h"
+#include "cmn/DcLog.h"
+
+namespace
+{
+    // Universal identity reply with the Strymon manufacturer id
+    const char* const kStrymonIdentReply = "F0 7E .. 06 02 00 01 55";
+
+    //-------------------------------------------------------------------------
+    QString portBaseName( const QString& name )
+    {
+        // "UM-ONE In" and "UM-ONE Out" are the two sides of one interface
+        QString n = name.toLower();
+        n.remove( QRegExp( "\\b(in|out|input|output)\\b" ) );
+        n.remove( QRegExp( "[^a-z0-9]" ) );
+        return n;
+    }
+}
+
+//-------------------------------------------------------------------------
+DcPortScanner::DcPortScanner( QObject* parent /*= 0*/ )
+    : QObject( parent ),_nextOut( 0 ),_confirmIn( -1 ),_confirmAt( 0 )
+{
+    _settle.setSingleShot( true );
+    _timeout.setSingleShot( true );
+    _stagger.setInterval( kStaggerMs );
+    QObject::connect( &_stagger,&QTimer::timeout,this,&DcPortScanner::sendNext );
+    QObject::connect( &_timeout,&QTimer::timeout,&_loop,&QEventLoop::quit );
+
+    // Every output is asked before the scan settles
+    QObject::connect( &_settle,&QTimer::timeout,this,[this]()
+    {
+        if( _stagger.isActive() )
+        {
+            _settle.start( kSettleMs );
+        }
+        else
+        {
+            _loop.quit();
+        }
+    });
+}
+
+//-------------------------------------------------------------------------
+DcPortScanner::~DcPortScanner()
+{
+    close();
+}
+
+//-------------------------------------------------------------------------
+void DcPortScanner::close()
+{
+    foreach( DcMidiIn* in,_ins )
+    {
+        in->close();
+        in->destroy();
+        delete in;
+    }
+    _ins.clear();
+
+    foreach( DcMidiOut* out,_outs )
+    {
+        out->close();
+        out->destroy();
+        delete out;
+    }
+    _outs.clear();
+}
+
+//-------------------------------------------------------------------------
+QList<DcPortScanner::PortPair> DcPortScanner::scan( int timeoutMs /*= kTimeoutMs*/ )
+{
+    close();
+    _inNames.clear();
+    _outNames.clear();
+    _replies.clear();
+
+    DcMidiIn inProbe;
+    DcMidiOut outProbe;
+    inProbe.init();
+    outProbe.init();
+    QStringList inPorts = inProbe.getPortNames();
+    QStringList outPorts = outProbe.getPortNames();
+
+    foreach( const QString& name,inPorts )
+    {
+        DcMidiIn* in = new DcMidiIn();
+        in->init();
+        if( !in->open( name ) )
+        {
+            DCLOG() << "Port scan: unable to open " << name << ": " << in->getLastErrorString();
+            delete in;
+            continue;
+        }
+
+        int idx = _ins.size();
+        QObject::connect( in,&DcMidiIn::dataIn,this,[this,idx]( const DcMidiData& data ) { recvData( idx,data ); } );
+        _ins.append( in );
+        _inNames.append( name );
+    }
+
+    foreach( const QString& name,outPorts )
+    {
+        DcMidiOut* out = new DcMidiOut();
+        out->init();
+        if( !out->open( name ) )
+        {
+            DCLOG() << "Port scan: unable to open " << name << ": " << out->getLastErrorString();
+            delete out;
+            continue;
+        }
+        _outs.append( out );
+        _outNames.append( name );
+    }
+
+    if( _ins.isEmpty() || _outs.isEmpty() )
+    {
+        _lastErrorString = "No MIDI port pairs could be opened";
+        close();
+        return QList<PortPair>();
+    }
+
+    // The requests are staggered from the event loop, so the UI stays live
+    _timeout.start( timeoutMs );
+    _sentAt.fill( 0,_outs.size() );
+    _nextOut = 0;
+    sendNext();
+    _stagger.start();
+
+    _loop.exec();
+    _timeout.stop();
+    _stagger.stop();
+    _settle.stop();
+
+    // One pair per input, the first supported reply wins
+    QList<PortPair> found;
+    QVector<bool> inUsed( _ins.size(),false );
+    QList<Reply> replies = _replies;
+    foreach( const Reply& r,replies )
+    {
+        QList<int> outs = matchOutputs( r );
+        if( inUsed.at( r.In ) || outs.isEmpty() )
+        {
+            continue;
+        }
+
+        DcDeviceDetails details;
+        details.fromIdentData( r.Data );
+        if( !DcPresetLib::updateDeviceDetails( r.Data,details ) )
+        {
+            continue;
+        }
+
+        // With more than one request in flight the timing only suggests the
+        // output, so ask each candidate on its own until the input answers
+        int out = outs.first();
+        int latency = r.At - _sentAt.at( out );
+        if( outs.size() > 1 )
+        {
+            out = -1;
+            foreach( int candidate,outs )
+            {
+                if( confirm( r.In,candidate,latency ) )
+                {
+                    out = candidate;
+                    break;
+                }
+            }
+            if( out < 0 )
+            {
+                DCLOG() << "Port scan: no output confirmed for " << _inNames.at( r.In );
+                continue;
+            }
+        }
+
+        inUsed[r.In] = true;
+        PortPair p;
+        p.InPort = _inNames.at( r.In );
+        p.OutPort = _outNames.at( out );
+        p.Device = details.Name;
+        p.IdentData = r.Data;
+        p.LatencyMs = latency;
+        found.append( p );
+        DCLOG() << "Port scan: " << p.Device << " on " << p.InPort << " / " << p.OutPort << " in " << p.LatencyMs << " ms";
+    }
+
+    close();
+
+    std::stable_sort( found.begin(),found.end(),[]( const PortPair& a,const PortPair& b ) { return a.LatencyMs < b.LatencyMs; } );
+    if( found.isEmpty() )
+    {
+        _lastErrorString = QString( "No supported device answered on %1 inputs and %2 outputs" ).arg( _inNames.size() ).arg( _outNames.size() );
+    }
+    return found;
+}
+
+//-------------------------------------------------------------------------
+void DcPortScanner::sendNext()
+{
+    if( _nextOut >= _outs.size() )
+    {
+        _stagger.stop();
+        return;
+    }
+
+    _sentAt[_nextOut] = QDateTime::currentMSecsSinceEpoch();
+    _outs.at( _nextOut )->dataOut( "F0 7E 7F 06 01 F7" );
+    _nextOut++;
+}
+
+//-------------------------------------------------------------------------
+bool DcPortScanner::confirm( int in,int out,int& latencyMs )
+{
+    _replies.clear();
+    _confirmIn = in;
+    _confirmAt = QDateTime::currentMSecsSinceEpoch();
+    qint64 sentAt = _confirmAt;
+    _timeout.start( kConfirmMs );
+    _outs.at( out )->dataOut( "F0 7E 7F 06 01 F7" );
+
+    _loop.exec();
+    _timeout.stop();
+    _confirmIn = -1;
+
+    // Stragglers from the first pass may still arrive, only a later reply counts
+    foreach( const Reply& r,_replies )
+    {
+        if( r.In == in && r.At >= sentAt && r.Data.contains( kStrymonIdentReply ) )
+        {
+            latencyMs = r.At - sentAt;
+            DCLOG() << "Port scan: confirmed " << _inNames.at( in ) << " / " << _outNames.at( out );
+            return true;
+        }
+    }
+    return false;
+}
+
+//-------------------------------------------------------------------------
+void DcPortScanner::recvData( int in,const DcMidiData& data )
+{
+    if( !data.contains( DcMidiDevDefs::kIdentReply ) )
+    {
+        return;
+    }
+
+    Reply r;
+    r.In = in;
+    r.At = data.getTimeStamp() ? data.getTimeStamp() : QDateTime::currentMSecsSinceEpoch();
+    r.Data = data;
+    _replies.append( r );
+
+    // While confirming, only the awaited reply ends the wait
+    if( _confirmIn >= 0 )
+    {
+        if( in == _confirmIn && r.At >= _confirmAt && data.contains( kStrymonIdentReply ) )
+        {
+            _loop.quit();
+        }
+        return;
+    }
+
+    // Other gear answering must not cut the wait short for a slower pedal
+    if( !_settle.isActive() && data.contains( kStrymonIdentReply ) )
+    {
+        _settle.start( kSettleMs );
+    }
+}
+
+//-------------------------------------------------------------------------
+QList<int> DcPortScanner::matchOutputs( const Reply& r ) const
+{
+    // Every output asked before the reply, most recent request first
+    QList<int> outs;
+    for( int idx = 0; idx < _sentAt.size(); idx++ )
+    {
+        if( _sentAt.at( idx ) && _sentAt.at( idx ) <= r.At )
+        {
+            outs.append( idx );
+        }
+    }
+    std::stable_sort( outs.begin(),outs.end(),[this]( int a,int b ) { return _sentAt.at( a ) > _sentAt.at( b ); } );
+
+    // An output named like the input and asked within the stagger window
+    // is the likelier match
+    QString inBase = portBaseName( _inNames.at( r.In ) );
+    for( int pos = 0; pos < outs.size(); pos++ )
+    {
+        int idx = outs.at( pos );
+        if( r.At - _sentAt.at( idx ) <= 2 * kStaggerMs && portBaseName( _outNames.at( idx ) ) == inBase )
+        {
+            outs.move( pos,0 );
+            break;
+        }
+    }
+    return outs;
+}
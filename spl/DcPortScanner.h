@@ -0,0 +1,108 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPortScanner.h
+ \brief Finds Strymon pedals on any MIDI port pair in one pass.
+ Every input is opened and listens at once, the identity request goes out
+ on each output a few milliseconds apart, and each reply is matched to
+ the output whose request most recently preceded it.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVector>
+#include <QEventLoop>
+#include <QTimer>
+#include "DcMidi/DcMidiIn.h"
+#include "DcMidi/DcMidiOut.h"
+
+class DcPortScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /*!
+      A supported device and the port pair it answered on.
+    */
+    struct PortPair
+    {
+        PortPair() : LatencyMs( 0 ) {}
+
+        QString InPort;
+        QString OutPort;
+        QString Device;
+        DcMidiData IdentData;
+        int LatencyMs;      // from the request on OutPort to the reply on InPort
+    };
+
+    static const int kTimeoutMs = 1500;
+
+    // Gap between requests on successive outputs, replies are expected sooner
+    static const int kStaggerMs = 25;
+
+    // Extra time for other pedals to answer once a Strymon pedal has
+    static const int kSettleMs = 150;
+
+    // Wait for the reply to a single request that confirms a pair
+    static const int kConfirmMs = 300;
+
+    DcPortScanner( QObject* parent = 0 );
+    ~DcPortScanner();
+
+    /*!
+      Opens every port, sends the identity request on each output and
+      collects replies for at most timeoutMs.  When more than one output
+      could have caused a reply, the pair is confirmed with a request on
+      one output at a time.  Returns the pairs with a supported device,
+      fastest reply first.
+    */
+    QList<PortPair> scan( int timeoutMs = kTimeoutMs );
+
+    QString getLastErrorString() const { return _lastErrorString; }
+
+private:
+    struct Reply
+    {
+        int In;
+        qint64 At;
+        DcMidiData Data;
+    };
+
+    void sendNext();
+    void recvData( int in,const DcMidiData& data );
+    QList<int> matchOutputs( const Reply& r ) const;
+    bool confirm( int in,int out,int& latencyMs );
+    void close();
+
+    QList<DcMidiIn*> _ins;
+    QList<DcMidiOut*> _outs;
+    QStringList _inNames;
+    QStringList _outNames;
+    QVector<qint64> _sentAt;
+    QList<Reply> _replies;
+    QEventLoop _loop;
+    QTimer _stagger;
+    QTimer _settle;
+    QTimer _timeout;
+    int _nextOut;
+    int _confirmIn;
+    qint64 _confirmAt;
+    QString _lastErrorString;
+};
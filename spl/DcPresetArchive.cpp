@@ -0,0 +1,305 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetArchive.h"
+#include <QDataStream>
+#include <string.h>
+
+namespace
+{
+    const char kMagic[4] = { 'D','C','P','Z' };
+    const quint16 kVersion = 1;
+    const quint32 kMaxFrameLen = 16*1024*1024;
+}
+
+//-------------------------------------------------------------------------
+DcPresetArchiveWriter::DcPresetArchiveWriter()
+    : _frameCount(0), _presetCount(0), _countPos(0), _rawBytes(0), _writeError(false)
+{
+}
+
+//-------------------------------------------------------------------------
+DcPresetArchiveWriter::~DcPresetArchiveWriter()
+{
+    if( _file.isOpen() )
+    {
+        close();
+    }
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetArchiveWriter::open( const QString& fileName, const QString& device, const QString& fwVersion )
+{
+    _file.setFileName( fileName );
+    if( !_file.open( QIODevice::WriteOnly ) )
+    {
+        _lastErrorString = "Unable to open the file:\n" + fileName;
+        return false;
+    }
+
+    _frame.clear();
+    _frameCount = 0;
+    _presetCount = 0;
+    _rawBytes = 0;
+    _writeError = false;
+
+    QDataStream out( &_file );
+    out.setVersion( QDataStream::Qt_5_1 );
+    out.writeRawData( kMagic,sizeof( kMagic ) );
+    out << kVersion << device << fwVersion;
+
+    // Count is patched in by close()
+    _countPos = _file.pos();
+    out << _presetCount;
+
+    return checkStream( out );
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetArchiveWriter::checkStream( const QDataStream& out )
+{
+    // Each frame gets its own stream, so remember a failure until close()
+    if( out.status() != QDataStream::Ok && !_writeError )
+    {
+        _writeError = true;
+        _lastErrorString = "Unable to write the file:\n" + _file.fileName();
+    }
+    return !_writeError;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetArchiveWriter::append( const DcMidiData& md )
+{
+    QDataStream out( &_frame,QIODevice::Append );
+    out << md.toByteArray();
+    _rawBytes += md.length();
+    _presetCount++;
+
+    if( ++_frameCount >= kPresetsPerFrame )
+    {
+        return flushFrame();
+    }
+    return !_writeError;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetArchiveWriter::flushFrame()
+{
+    if( _frameCount == 0 )
+    {
+        return !_writeError;
+    }
+
+    QByteArray z = qCompress( _frame,kCompressionLevel );
+    QDataStream out( &_file );
+    out << quint32( z.size() );
+    if( out.writeRawData( z.constData(),z.size() ) != z.size() )
+    {
+        out.setStatus( QDataStream::WriteFailed );
+    }
+
+    _frame.clear();
+    _frameCount = 0;
+    return checkStream( out );
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetArchiveWriter::close()
+{
+    flushFrame();
+
+    QDataStream out( &_file );
+    out << quint32( 0 );
+
+    if( !_file.seek( _countPos ) )
+    {
+        out.setStatus( QDataStream::WriteFailed );
+    }
+    out << _presetCount;
+    checkStream( out );
+
+    _file.close();
+    return !_writeError;
+}
+
+//-------------------------------------------------------------------------
+DcPresetArchiveReader::DcPresetArchiveReader()
+    : _framePos(0), _atEnd(false)
+{
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetArchiveReader::open( const QString& fileName )
+{
+    _file.setFileName( fileName );
+    if( !_file.open( QIODevice::ReadOnly ) )
+    {
+        _lastErrorString = "Unable to open the file:\n" + fileName;
+        return false;
+    }
+
+    QDataStream in( &_file );
+    in.setVersion( QDataStream::Qt_5_1 );
+
+    char magic[4];
+    quint16 ver = 0;
+    if( in.readRawData( magic,sizeof( magic ) ) != sizeof( magic ) || memcmp( magic,kMagic,sizeof( magic ) ) != 0 )
+    {
+        _lastErrorString = fileName + " is not a compressed preset file";
+        return false;
+    }
+
+    in >> ver;
+    if( ver != kVersion )
+    {
+        _lastErrorString = fileName + " was written by a newer version";
+        return false;
+    }
+
+    in >> _hdr.Device >> _hdr.FwVersion >> _hdr.PresetCount;
+    _frame.clear();
+    _framePos = 0;
+    _atEnd = false;
+
+    return in.status() == QDataStream::Ok;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetArchiveReader::next( DcMidiData& md )
+{
+    if( _atEnd || !_lastErrorString.isEmpty() )
+    {
+        return false;
+    }
+
+    if( _framePos >= _frame.size() )
+    {
+        QDataStream in( &_file );
+        quint32 len = 0;
+        in >> len;
+        if( in.status() == QDataStream::Ok && len == 0 )
+        {
+            // Only the 0 terminator ends the archive, running out of file
+            // before it means the archive was cut short
+            _atEnd = true;
+            return false;
+        }
+
+        QByteArray z;
+        if( in.status() == QDataStream::Ok && len <= kMaxFrameLen )
+        {
+            z = _file.read( len );
+        }
+
+        _frame = z.size() == int( len ) ? qUncompress( z ) : QByteArray();
+        _framePos = 0;
+        if( _frame.isEmpty() )
+        {
+            _lastErrorString = _file.fileName() + " is damaged";
+            return false;
+        }
+    }
+
+    // Each preset is a length prefixed QByteArray
+    QDataStream in( _frame );
+    in.device()->seek( _framePos );
+    QByteArray ba;
+    in >> ba;
+    _framePos = int( in.device()->pos() );
+
+    if( in.status() != QDataStream::Ok )
+    {
+        _lastErrorString = _file.fileName() + " is damaged";
+        return false;
+    }
+
+    md = ba;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetArchive::isArchive( const QString& fileName )
+{
+    QFile file( fileName );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        return false;
+    }
+    return file.read( sizeof( kMagic ) ) == QByteArray( kMagic,sizeof( kMagic ) );
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetArchive::save( const QString& fileName, const QList<DcMidiData>& presets,
+                            const QString& device, const QString& fwVersion, QString& errorMsg )
+{
+    DcPresetArchiveWriter w;
+    if( !w.open( fileName,device,fwVersion ) )
+    {
+        errorMsg = w.getLastErrorString();
+        return false;
+    }
+
+    foreach( const DcMidiData& md,presets )
+    {
+        if( !w.append( md ) )
+        {
+            w.close();
+            errorMsg = w.getLastErrorString();
+            return false;
+        }
+    }
+
+    if( !w.close() )
+    {
+        errorMsg = w.getLastErrorString();
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetArchive::load( const QString& fileName, QList<DcMidiData>& presets, QString& errorMsg )
+{
+    DcPresetArchiveReader r;
+    if( !r.open( fileName ) )
+    {
+        errorMsg = r.getLastErrorString();
+        return false;
+    }
+
+    QList<DcMidiData> loaded;
+    loaded.reserve( r.header().PresetCount );
+    DcMidiData md;
+    while( r.next( md ) )
+    {
+        loaded.append( md );
+    }
+
+    if( !r.getLastErrorString().isEmpty() )
+    {
+        errorMsg = r.getLastErrorString();
+        return false;
+    }
+
+    if( !r.atEnd() || quint32( loaded.length() ) != r.header().PresetCount )
+    {
+        errorMsg = fileName + " is damaged";
+        return false;
+    }
+
+    presets.append( loaded );
+    return true;
+}
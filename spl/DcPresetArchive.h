@@ -0,0 +1,120 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetArchive.h
+ \brief Compressed preset container (.syz).  A small header records the
+ device, firmware version and preset count, followed by zlib (qCompress)
+ frames of up to kPresetsPerFrame presets.  Reading and writing work one
+ frame at a time, so large archives are never fully resident.
+
+ Layout: "DCPZ" | version | header (QDataStream) | { frameLen, frame }* | 0
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QFile>
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QDataStream>
+#include "DcMidi/DcMidiData.h"
+
+struct DcPresetArchiveHeader
+{
+    DcPresetArchiveHeader() : PresetCount(0) {}
+
+    QString Device;
+    QString FwVersion;
+    quint32 PresetCount;
+};
+
+class DcPresetArchiveWriter
+{
+public:
+    static const int kPresetsPerFrame = 32;
+    static const int kCompressionLevel = 9;
+
+    DcPresetArchiveWriter();
+    ~DcPresetArchiveWriter();
+
+    bool open( const QString& fileName, const QString& device, const QString& fwVersion );
+    bool append( const DcMidiData& md );
+
+    /*!
+      Flushes the last frame and records the preset count.
+    */
+    bool close();
+
+    qint64 rawBytes() const { return _rawBytes; }
+    QString getLastErrorString() const { return _lastErrorString; }
+
+private:
+    bool flushFrame();
+    bool checkStream( const QDataStream& out );
+
+    QFile _file;
+    QByteArray _frame;
+    int _frameCount;
+    quint32 _presetCount;
+    qint64 _countPos;
+    qint64 _rawBytes;
+    bool _writeError;
+    QString _lastErrorString;
+};
+
+class DcPresetArchiveReader
+{
+public:
+    DcPresetArchiveReader();
+
+    bool open( const QString& fileName );
+    const DcPresetArchiveHeader& header() const { return _hdr; }
+
+    /*!
+      Returns the next preset, or false at the end of the archive or on a
+      damaged frame (see getLastErrorString()).
+    */
+    bool next( DcMidiData& md );
+
+    /*!
+      True once the 0 terminator has been read.
+    */
+    bool atEnd() const { return _atEnd; }
+
+    QString getLastErrorString() const { return _lastErrorString; }
+
+private:
+    QFile _file;
+    DcPresetArchiveHeader _hdr;
+    QByteArray _frame;
+    int _framePos;
+    bool _atEnd;
+    QString _lastErrorString;
+};
+
+namespace DcPresetArchive
+{
+    static const char* const kSuffix = ".syz";
+
+    /*!
+      Returns true if the file starts with the archive magic number.
+    */
+    bool isArchive( const QString& fileName );
+
+    bool save( const QString& fileName, const QList<DcMidiData>& presets,
+               const QString& device, const QString& fwVersion, QString& errorMsg );
+
+    bool load( const QString& fileName, QList<DcMidiData>& presets, QString& errorMsg );
+}
@@ -0,0 +1,290 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetBank.h"
+#include <QFile>
+#include <string.h>
+#include "DcPresetBundle.h"
+#include "DcPresetSchema.h"
+
+namespace
+{
+    //-------------------------------------------------------------------------
+    const DcPresetSchema::Layout& layoutOf( const QByteArray& msg )
+    {
+        const DcPresetSchema::Layout* layout = DcPresetSchema::forMessage( msg );
+        return layout ? *layout : DcPresetSchema::defaultLayout();
+    }
+}
+
+//-------------------------------------------------------------------------
+DcPresetBank::DcPresetBank( int presetSize /*= kPreseLength*/ )
+    : _stride( presetSize )
+{
+}
+
+//-------------------------------------------------------------------------
+DcPresetBank::DcPresetBank( const QList<DcMidiData>& presets )
+    : _stride( kPreseLength )
+{
+    *this = presets;
+}
+
+//-------------------------------------------------------------------------
+DcPresetBank& DcPresetBank::operator=( const QList<DcMidiData>& presets )
+{
+    clear();
+    reserve( presets.length() );
+    foreach( const DcMidiData& md,presets )
+    {
+        append( md );
+    }
+    return *this;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetBank::clear()
+{
+    _buf.clear();
+    _lens.clear();
+}
+
+//-------------------------------------------------------------------------
+void DcPresetBank::reserve( int count )
+{
+    _buf.reserve( count * _stride );
+    _lens.reserve( count );
+}
+
+//-------------------------------------------------------------------------
+void DcPresetBank::widen( int stride )
+{
+    QByteArray buf( _lens.size() * stride,'\0' );
+    for( int idx = 0; idx < _lens.size(); idx++ )
+    {
+        memcpy( buf.data() + idx * stride,slot( idx ),_lens.at( idx ) );
+    }
+    _buf = buf;
+    _stride = stride;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetBank::append( const DcMidiData& md )
+{
+    int len = md.length();
+    if( len > _stride )
+    {
+        widen( len );
+    }
+
+    int base = _buf.size();
+    _buf.resize( base + _stride );
+    memcpy( _buf.data() + base,md.data(),len );
+    memset( _buf.data() + base + len,0,_stride - len );
+    _lens.append( len );
+}
+
+//-------------------------------------------------------------------------
+void DcPresetBank::replace( int idx,const DcMidiData& md )
+{
+    Q_ASSERT( idx >= 0 && idx < _lens.size() );
+
+    int len = md.length();
+    if( len > _stride )
+    {
+        widen( len );
+    }
+
+    // data() detaches the buffer if another bank still shares it
+    char* p = _buf.data() + idx * _stride;
+    memcpy( p,md.data(),len );
+    memset( p + len,0,_stride - len );
+    _lens[idx] = len;
+}
+
+//-------------------------------------------------------------------------
+DcMidiData DcPresetBank::at( int idx ) const
+{
+    return DcMidiData( QByteArray( slot( idx ),_lens.at( idx ) ) );
+}
+
+//-------------------------------------------------------------------------
+QByteArray DcPresetBank::view( int idx ) const
+{
+    return QByteArray::fromRawData( slot( idx ),_lens.at( idx ) );
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetBank::equals( int idx,const DcPresetBank& other,int otherIdx ) const
+{
+    int len = _lens.at( idx );
+    return len == other._lens.at( otherIdx ) && memcmp( slot( idx ),other.slot( otherIdx ),len ) == 0;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetBank::operator==( const DcPresetBank& other ) const
+{
+    if( _lens != other._lens )
+    {
+        return false;
+    }
+
+    // Slots are zero padded, so equal layouts compare as one block
+    if( _stride == other._stride )
+    {
+        return _buf == other._buf;
+    }
+
+    for( int idx = 0; idx < _lens.size(); idx++ )
+    {
+        if( !equals( idx,other,idx ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+int DcPresetBank::number( int idx ) const
+{
+    QByteArray p = view( idx );
+    int offset = layoutOf( p ).offset( DcPresetSchema::Number );
+    if( p.length() < offset + 2 )
+    {
+        return -1;
+    }
+    return ((uchar)p.at( offset ) << 7) + (uchar)p.at( offset + 1 );
+}
+
+//-------------------------------------------------------------------------
+QString DcPresetBank::name( int idx ) const
+{
+    QByteArray p = view( idx );
+    const DcPresetSchema::Layout& layout = layoutOf( p );
+    if( p.length() < layout.end( DcPresetSchema::Name ) )
+    {
+        return QString();
+    }
+    return QString::fromLatin1( p.constData() + layout.offset( DcPresetSchema::Name ),
+                                layout.width( DcPresetSchema::Name ) ).trimmed();
+}
+
+//-------------------------------------------------------------------------
+quint8 DcPresetBank::checksum( int idx ) const
+{
+    QByteArray p = view( idx );
+    int offset = layoutOf( p ).offset( DcPresetSchema::Checksum );
+    return offset < p.length() ? (quint8)p.at( offset ) : 0;
+}
+
+//-------------------------------------------------------------------------
+QList<DcMidiData> DcPresetBank::toList() const
+{
+    QList<DcMidiData> list;
+    list.reserve( _lens.size() );
+    for( int idx = 0; idx < _lens.size(); idx++ )
+    {
+        list.append( at( idx ) );
+    }
+    return list;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetBank::save( const QString& fileName,QString& errorMsg ) const
+{
+    QFile file( fileName );
+    if( !file.open( QIODevice::WriteOnly ) )
+    {
+        errorMsg = "Unable to open the file:\n" + fileName;
+        return false;
+    }
+
+    // Full slots are written as one block, short messages one at a time
+    bool ok = true;
+    int run = 0;
+    for( int idx = 0; idx <= _lens.size() && ok; idx++ )
+    {
+        if( idx < _lens.size() && _lens.at( idx ) == _stride )
+        {
+            continue;
+        }
+
+        if( idx > run )
+        {
+            ok = file.write( slot( run ),(qint64)(idx - run) * _stride ) == (qint64)(idx - run) * _stride;
+        }
+        if( ok && idx < _lens.size() )
+        {
+            ok = file.write( slot( idx ),_lens.at( idx ) ) == _lens.at( idx );
+        }
+        run = idx + 1;
+    }
+
+    if( !ok )
+    {
+        errorMsg = "Unable to write the file:\n" + fileName;
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetBank::load( const QString& fileName,const QByteArray& presetHdr,int presetSize,QString& errorMsg )
+{
+    DcPresetBundle bundle;
+    if( !bundle.open( fileName ) )
+    {
+        errorMsg = bundle.getLastErrorString();
+        return false;
+    }
+
+    // Check every preset against the mapping before touching the bank
+    int msgCount = bundle.splitSysex();
+    int presetCount = 0;
+    for( int idx = 0; idx < msgCount; idx++ )
+    {
+        if( bundle.isNak( idx ) )
+        {
+            continue;
+        }
+
+        if( !bundle.hasHeader( idx,presetHdr ) || bundle.view( idx ).length() != presetSize )
+        {
+            errorMsg = fileName + " does not hold presets for this device";
+            return false;
+        }
+        presetCount++;
+    }
+
+    if( presetCount == 0 )
+    {
+        errorMsg = fileName + " does not contain any presets";
+        return false;
+    }
+
+    clear();
+    reserve( presetCount );
+    for( int idx = 0; idx < msgCount; idx++ )
+    {
+        // Views into the mapping are copied straight into the slots
+        if( !bundle.isNak( idx ) )
+        {
+            append( bundle.view( idx ) );
+        }
+    }
+    return true;
+}
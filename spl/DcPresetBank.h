@@ -0,0 +1,108 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetBank.h
+ \brief A list of presets stored back to back in one buffer.
+ Every preset gets a slot of presetSize() bytes, shorter messages such as
+ NAK placeholders keep their own length.  Copying a bank shares the buffer
+ until either copy is changed, so handing the device list to the work
+ list, comparing the two and saving them never chase per-preset pointers.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+#include "DcMidi/DcMidiData.h"
+#include "DcMidiDevDefs.h"
+
+class DcPresetBank
+{
+public:
+
+    explicit DcPresetBank( int presetSize = kPreseLength );
+    DcPresetBank( const QList<DcMidiData>& presets );
+    DcPresetBank& operator=( const QList<DcMidiData>& presets );
+
+    int presetSize() const { return _stride; }
+    int length() const { return _lens.size(); }
+    int size() const { return _lens.size(); }
+    bool isEmpty() const { return _lens.isEmpty(); }
+
+    void clear();
+    void reserve( int count );
+
+    /*!
+      Copies md into the bank.  A message longer than presetSize() widens
+      every slot.
+    */
+    void append( const DcMidiData& md );
+    void replace( int idx,const DcMidiData& md );
+
+    /*!
+      Returns a copy of preset idx that stays valid when the bank changes.
+    */
+    DcMidiData at( int idx ) const;
+    DcMidiData first() const { return at( 0 ); }
+    DcMidiData last() const { return at( length() - 1 ); }
+
+    /*!
+      Returns preset idx without copying it.  The view is only valid until
+      the bank is next changed.
+    */
+    QByteArray view( int idx ) const;
+
+    /*!
+      True if preset idx matches preset otherIdx of other byte for byte.
+    */
+    bool equals( int idx,const DcPresetBank& other,int otherIdx ) const;
+    bool operator==( const DcPresetBank& other ) const;
+    bool operator!=( const DcPresetBank& other ) const { return !(*this == other); }
+
+    /*!
+      Fields of preset idx, read in place.  number() is -1 and name()
+      empty when the message is too short to hold the field.
+    */
+    int number( int idx ) const;
+    QString name( int idx ) const;
+    quint8 checksum( int idx ) const;
+
+    QList<DcMidiData> toList() const;
+
+    /*!
+      Writes the presets back to back, the same format as
+      DcPresetLib::savePresetBinary() writes for .syx files.
+    */
+    bool save( const QString& fileName,QString& errorMsg ) const;
+
+    /*!
+      Replaces the bank with the presets in a .syx file, copied from the
+      mapped file straight into the slots.  Every message must start with
+      presetHdr and be presetSize bytes long, NAK placeholders are skipped.
+      Fails if the file holds no presets, the bank is unchanged when this
+      fails.
+    */
+    bool load( const QString& fileName,const QByteArray& presetHdr,int presetSize,QString& errorMsg );
+
+private:
+    const char* slot( int idx ) const { return _buf.constData() + idx * _stride; }
+    void widen( int stride );
+
+    QByteArray _buf;
+    QVector<int> _lens;
+    int _stride;
+};
@@ -0,0 +1,164 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetBundle.h"
+#include <string.h>
+
+//-------------------------------------------------------------------------
+DcPresetBundle::DcPresetBundle()
+    : _base(0), _size(0)
+{
+}
+
+//-------------------------------------------------------------------------
+DcPresetBundle::~DcPresetBundle()
+{
+    close();
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetBundle::open( const QString& fileName )
+{
+    close();
+
+    _file.setFileName( fileName );
+    if( !_file.open( QIODevice::ReadOnly ) )
+    {
+        _lastErrorString = "Unable to open the file:\n" + fileName;
+        return false;
+    }
+
+    _size = _file.size();
+    if( _size == 0 )
+    {
+        _lastErrorString = "The file is empty:\n" + fileName;
+        _file.close();
+        return false;
+    }
+
+    _base = (const char*)_file.map( 0,_size );
+    if( !_base )
+    {
+        _fallback = _file.readAll();
+        _base = _fallback.constData();
+        _size = _fallback.size();
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetBundle::close()
+{
+    if( _base && _fallback.isEmpty() )
+    {
+        _file.unmap( (uchar*)_base );
+    }
+    if( _file.isOpen() )
+    {
+        _file.close();
+    }
+
+    _fallback.clear();
+    _offsets.clear();
+    _lengths.clear();
+    _base = 0;
+    _size = 0;
+}
+
+//-------------------------------------------------------------------------
+int DcPresetBundle::splitFixed( int presetSize )
+{
+    _offsets.clear();
+    _lengths.clear();
+
+    if( presetSize <= 0 )
+    {
+        return 0;
+    }
+
+    for( qint64 pos = 0; pos + presetSize <= _size; pos += presetSize )
+    {
+        _offsets.append( pos );
+        _lengths.append( presetSize );
+    }
+    return count();
+}
+
+//-------------------------------------------------------------------------
+int DcPresetBundle::splitSysex()
+{
+    _offsets.clear();
+    _lengths.clear();
+
+    const char* p = _base;
+    const char* end = _base + _size;
+
+    while( p < end )
+    {
+        const char* sox = (const char*)memchr( p,0xF0,end - p );
+        if( !sox )
+        {
+            break;
+        }
+
+        const char* eox = (const char*)memchr( sox + 1,0xF7,end - sox - 1 );
+        if( !eox )
+        {
+            break;
+        }
+
+        _offsets.append( sox - _base );
+        _lengths.append( int( eox - sox + 1 ) );
+        p = eox + 1;
+    }
+    return count();
+}
+
+//-------------------------------------------------------------------------
+DcMidiData DcPresetBundle::view( int idx ) const
+{
+    return DcMidiData( QByteArray::fromRawData( _base + _offsets.at( idx ),_lengths.at( idx ) ) );
+}
+
+//-------------------------------------------------------------------------
+DcMidiData DcPresetBundle::copy( int idx ) const
+{
+    return DcMidiData( QByteArray( _base + _offsets.at( idx ),_lengths.at( idx ) ) );
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetBundle::hasHeader( int idx, const QByteArray& hdr ) const
+{
+    if( _lengths.at( idx ) < hdr.size() )
+    {
+        return false;
+    }
+    return memcmp( _base + _offsets.at( idx ),hdr.constData(),hdr.size() ) == 0;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetBundle::isNak( int idx ) const
+{
+    int len = _lengths.at( idx );
+    if( len < 2 || len >= 100 )
+    {
+        return false;
+    }
+
+    const char* p = _base + _offsets.at( idx ) + len - 2;
+    return p[0] == 0x47 && (unsigned char)p[1] == 0xF7;
+}
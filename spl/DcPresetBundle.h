@@ -0,0 +1,95 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetBundle.h
+ \brief Read-only, memory mapped view of a preset bundle or sysex file.
+ Presets are handed out as DcMidiData that reference the mapping directly,
+ so they are only valid while the bundle is open.  Use copy() for presets
+ that outlive the bundle, e.g. anything placed in the work list.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include "DcMidi/DcMidiData.h"
+
+class DcPresetBundle
+{
+public:
+
+    DcPresetBundle();
+    ~DcPresetBundle();
+
+    /*!
+      Maps the given file.  Falls back to reading it into memory if the
+      file system doesn't support mapping.
+    */
+    bool open( const QString& fileName );
+    void close();
+    bool isOpen() const { return _base != 0; }
+
+    qint64 size() const { return _size; }
+
+    /*!
+      Splits the mapping into fixed size presets, any partial trailing
+      preset is ignored.  Returns the number of presets.
+    */
+    int splitFixed( int presetSize );
+
+    /*!
+      Splits the mapping into F0..F7 sysex messages, bytes between
+      messages are skipped.  Returns the number of messages.
+    */
+    int splitSysex();
+
+    int count() const { return _offsets.size(); }
+    qint64 offset( int idx ) const { return _offsets.at( idx ); }
+
+    /*!
+      Returns a view of preset idx, no bytes are copied.
+    */
+    DcMidiData view( int idx ) const;
+
+    /*!
+      Returns a deep copy of preset idx.
+    */
+    DcMidiData copy( int idx ) const;
+
+    /*!
+      Returns true if preset idx begins with the given header bytes.
+    */
+    bool hasHeader( int idx, const QByteArray& hdr ) const;
+
+    /*!
+      Returns true if preset idx is a short NAK placeholder (...47 F7).
+    */
+    bool isNak( int idx ) const;
+
+    QString getLastErrorString() const { return _lastErrorString; }
+
+private:
+    QFile _file;
+    QByteArray _fallback;
+    const char* _base;
+    qint64 _size;
+    QVector<qint64> _offsets;
+    QVector<int> _lengths;
+    QString _lastErrorString;
+
+    Q_DISABLE_COPY(DcPresetBundle)
+};
@@ -0,0 +1,73 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetCodec.h"
+
+//-------------------------------------------------------------------------
+const QByteArray& DcPresetCodec::defaultFill()
+{
+    static QByteArray fill;
+    if( fill.isEmpty() )
+    {
+        // 28 sequential bytes followed by 7F padding, 538 bytes total
+        for( char c = 0x18; c <= 0x33; c++ )
+        {
+            fill.append( c );
+        }
+        fill.append( QByteArray( 510, 0x7F ) );
+    }
+    return fill;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetCodec::setCompactRead( bool enable, const QByteArray& fill /*= QByteArray()*/ )
+{
+    _compactRead = enable;
+    _fill = fill.isEmpty() ? defaultFill() : fill;
+}
+
+//-------------------------------------------------------------------------
+DcMidiData DcPresetCodec::decodeRead( const DcMidiData& rsp ) const
+{
+    if( !_compactRead )
+    {
+        return rsp;
+    }
+
+    const QByteArray in = rsp.toByteArray();
+    int chnksz = rsp.get14bit( kChunkSizeOffset );
+    int tailLen = qMax( 0, in.length() - kPayloadOffset - chnksz );
+
+    QByteArray out;
+    out.reserve( kHeaderLen + chnksz + _fill.length() + tailLen );
+    out.append( in.constData(), qMin( kHeaderLen, in.length() ) );
+    if( out.length() > kOpcodeOffset )
+    {
+        out[kOpcodeOffset] = kPresetDataOpcode;
+    }
+    out.append( in.mid( kPayloadOffset, chnksz ) );
+    out.append( _fill );
+    out.append( in.mid( kPayloadOffset + chnksz ) );
+
+    return DcMidiData( out );
+}
+
+//-------------------------------------------------------------------------
+DcMidiData DcPresetCodec::encodeWrite( const DcMidiData& preset ) const
+{
+    // There is no compact write format to encode to yet
+    return preset;
+}
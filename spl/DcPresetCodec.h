@@ -0,0 +1,75 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetCodec.h
+ \brief Converts between the on-the-wire preset transfer format and the
+ full 650 byte preset image.  Firmware that supports fast fetch (opcode 67)
+ omits the constant region of the preset from read responses, the codec
+ fills it back in from a prebuilt binary template.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QByteArray>
+#include "DcMidi/DcMidiData.h"
+
+class DcPresetCodec
+{
+public:
+
+    // Fast fetch response layout
+    static const int kHeaderLen         = 9;
+    static const int kOpcodeOffset      = 6;
+    static const int kChunkSizeOffset   = 11;
+    static const int kPayloadOffset     = 15;
+    static const char kPresetDataOpcode = 0x62;
+
+    DcPresetCodec() { clear(); }
+
+    void clear()
+    {
+        _compactRead = false;
+        _fill.clear();
+    }
+
+    /*!
+      Enables compact reads using the given fill template, an empty
+      template selects the default Strymon fill.
+    */
+    void setCompactRead( bool enable, const QByteArray& fill = QByteArray() );
+    bool isCompactRead() const { return _compactRead; }
+
+    /*!
+      Rebuilds a full preset from a read response.  Full size responses
+      are returned unchanged.
+    */
+    DcMidiData decodeRead( const DcMidiData& rsp ) const;
+
+    /*!
+      Returns the message to send for a preset write.  No shipping firmware
+      accepts a compact write, so this is the full preset for now.
+    */
+    DcMidiData encodeWrite( const DcMidiData& preset ) const;
+
+    /*!
+      The constant preset region omitted by fast fetch on TimeLine, Mobius
+      and BigSky firmware.
+    */
+    static const QByteArray& defaultFill();
+
+private:
+    bool _compactRead;
+    QByteArray _fill;
+};
@@ -0,0 +1,465 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetColumns.h"
+#include "DcPresetSchema.h"
+#include <algorithm>
+
+namespace
+{
+    //-------------------------------------------------------------------------
+    template <typename Pred>
+    void narrow( QVector<quint8>& mask,const QVector<quint16>& col,Pred pred )
+    {
+        // Branch free so the compiler can vectorize it
+        quint8* m = mask.data();
+        const quint16* c = col.constData();
+        const int n = col.size();
+        for (int idx = 0; idx < n; idx++)
+        {
+            m[idx] &= (quint8)pred( c[idx] );
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    QString squash( const QString& s )
+    {
+        return s.toLower().remove( ' ' );
+    }
+}
+
+//-------------------------------------------------------------------------
+DcPresetColumns::DcPresetColumns()
+    : _maxSize( 0 )
+{
+    for (int idx = 0; idx < DcPresetSchema::kLayoutCount; idx++)
+    {
+        _maxSize = qMax( _maxSize,(int)DcPresetSchema::kLayouts[idx].Size );
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcPresetColumns::clear()
+{
+    _presets.clear();
+    _names.clear();
+    _origins.clear();
+    _device.clear();
+    _number.clear();
+    _type.clear();
+    _checksum.clear();
+    _bytes.clear();
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetColumns::append( const QByteArray& preset,const QString& origin )
+{
+    DcPresetRef ref( preset );
+    if(!ref.isValid())
+    {
+        return false;
+    }
+
+    _presets.append( preset );
+    _names.append( ref.name() );
+    _origins.append( origin );
+    _device.append( ref.layout()->Product );
+    _number.append( ref.number() );
+    _type.append( ref.effectType() );
+    _checksum.append( ref.checksum() );
+
+    // Byte columns are rebuilt on next use
+    _bytes.clear();
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetColumns::parseKey( const QString& name,int& key )
+{
+    QString n = name.toLower();
+    if(n == "device")
+    {
+        key = DeviceKey;
+    }
+    else if(n == "number")
+    {
+        key = NumberKey;
+    }
+    else if(n == "type")
+    {
+        key = TypeKey;
+    }
+    else if(n == "checksum")
+    {
+        key = ChecksumKey;
+    }
+    else if(n == "name")
+    {
+        key = NameKey;
+    }
+    else if(n.startsWith( 'b' ))
+    {
+        bool ok;
+        key = n.mid( 1 ).toInt( &ok );
+        if(!ok || key < 0 || key >= _maxSize)
+        {
+            _lastErrorString = QString( "%1 is not a byte offset, use b0 to b%2" ).arg( name ).arg( _maxSize - 1 );
+            return false;
+        }
+    }
+    else
+    {
+        _lastErrorString = "Unknown field " + name + ", use device, number, type, checksum, name or b<offset>";
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+QString DcPresetColumns::keyName( int key ) const
+{
+    switch (key)
+    {
+    case DeviceKey:
+        return "device";
+    case NumberKey:
+        return "number";
+    case TypeKey:
+        return "type";
+    case ChecksumKey:
+        return "checksum";
+    case NameKey:
+        return "name";
+    default:
+        return QString( "b%1" ).arg( key );
+    }
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetColumns::parseCondition( const QString& text,Condition& cond )
+{
+    static const struct { const char* Str; Compare Op; } kOps[] =
+    {
+        { "!=",Ne },{ "<=",Le },{ ">=",Ge },{ "=",Eq },{ "<",Lt },{ ">",Gt },{ "~",Contains }
+    };
+
+    int pos = -1;
+    int opLen = 0;
+    for (unsigned int idx = 0; idx < sizeof( kOps ) / sizeof( kOps[0] ) && pos < 0; idx++)
+    {
+        pos = text.indexOf( QLatin1String( kOps[idx].Str ) );
+        if(pos > 0)
+        {
+            cond.Op = kOps[idx].Op;
+            opLen = qstrlen( kOps[idx].Str );
+        }
+    }
+
+    if(pos <= 0)
+    {
+        _lastErrorString = text + " is not a condition, expected <field><op><value> with op one of = != < > <= >= ~";
+        return false;
+    }
+
+    if(!parseKey( text.left( pos ),cond.Key ))
+    {
+        return false;
+    }
+
+    cond.Text = text.mid( pos + opLen );
+    bool ok;
+    cond.Value = cond.Text.toInt( &ok,0 );
+    cond.Numeric = ok;
+
+    if(cond.Key == NameKey)
+    {
+        if(cond.Op != Eq && cond.Op != Ne && cond.Op != Contains)
+        {
+            _lastErrorString = "name only supports =, != and ~";
+            return false;
+        }
+        cond.Numeric = false;
+        return true;
+    }
+
+    if(cond.Op == Contains)
+    {
+        _lastErrorString = "~ is only supported for name";
+        return false;
+    }
+
+    if(cond.Key == DeviceKey && !cond.Numeric)
+    {
+        for (int idx = 0; idx < DcPresetSchema::kLayoutCount; idx++)
+        {
+            if(squash( QLatin1String( DcPresetSchema::kLayouts[idx].Device ) ) == squash( cond.Text ))
+            {
+                cond.Value = DcPresetSchema::kLayouts[idx].Product;
+                cond.Numeric = true;
+            }
+        }
+    }
+
+    if(!cond.Numeric && !(cond.Key == TypeKey && (cond.Op == Eq || cond.Op == Ne)))
+    {
+        _lastErrorString = cond.Text + " is not a value for " + keyName( cond.Key );
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+const QVector<quint16>& DcPresetColumns::column( int key )
+{
+    switch (key)
+    {
+    case DeviceKey:
+        return _device;
+    case NumberKey:
+        return _number;
+    case TypeKey:
+        return _type;
+    case ChecksumKey:
+        return _checksum;
+    default:
+        break;
+    }
+
+    QHash<int,QVector<quint16> >::iterator it = _bytes.find( key );
+    if(it == _bytes.end())
+    {
+        QVector<quint16> col( _presets.size() );
+        for (int row = 0; row < _presets.size(); row++)
+        {
+            const QByteArray& p = _presets.at( row );
+            col[row] = key < p.length() ? (uchar)p.at( key ) : 0;
+        }
+        it = _bytes.insert( key,col );
+    }
+    return it.value();
+}
+
+//-------------------------------------------------------------------------
+QVector<quint8> DcPresetColumns::filter( const QList<Condition>& conds )
+{
+    QVector<quint8> mask( _presets.size(),1 );
+
+    foreach(const Condition& c,conds)
+    {
+        if(c.Key == NameKey)
+        {
+            for (int row = 0; row < _names.size(); row++)
+            {
+                bool hit = c.Op == Contains ? _names.at( row ).contains( c.Text,Qt::CaseInsensitive ) :
+                                              _names.at( row ).compare( c.Text,Qt::CaseInsensitive ) == 0;
+                mask[row] &= (quint8)(c.Op == Ne ? !hit : hit);
+            }
+            continue;
+        }
+
+        if(!c.Numeric)
+        {
+            // A type name has a different code on each device
+            quint16 codes[256];
+            std::fill( codes,codes + 256,0xFFFF );
+            for (int idx = 0; idx < DcPresetSchema::kLayoutCount; idx++)
+            {
+                const DcPresetSchema::Layout& l = DcPresetSchema::kLayouts[idx];
+                for (int t = 0; t < l.EffectTypeCount; t++)
+                {
+                    if(c.Text.compare( QLatin1String( l.EffectTypes[t] ),Qt::CaseInsensitive ) == 0)
+                    {
+                        codes[l.Product] = t;
+                    }
+                }
+            }
+
+            quint8* m = mask.data();
+            const quint16* dev = _device.constData();
+            const quint16* type = _type.constData();
+            const bool eq = c.Op == Eq;
+            for (int row = 0; row < _type.size(); row++)
+            {
+                m[row] &= (quint8)((type[row] == codes[dev[row] & 0xFF]) == eq);
+            }
+            continue;
+        }
+
+        const QVector<quint16>& col = column( c.Key );
+        const int v = c.Value;
+        switch (c.Op)
+        {
+        case Eq:
+            narrow( mask,col,[v]( int x ) { return x == v; } );
+            break;
+        case Ne:
+            narrow( mask,col,[v]( int x ) { return x != v; } );
+            break;
+        case Lt:
+            narrow( mask,col,[v]( int x ) { return x < v; } );
+            break;
+        case Gt:
+            narrow( mask,col,[v]( int x ) { return x > v; } );
+            break;
+        case Le:
+            narrow( mask,col,[v]( int x ) { return x <= v; } );
+            break;
+        case Ge:
+            narrow( mask,col,[v]( int x ) { return x >= v; } );
+            break;
+        default:
+            break;
+        }
+    }
+    return mask;
+}
+
+//-------------------------------------------------------------------------
+int DcPresetColumns::count( const QVector<quint8>& mask )
+{
+    int n = 0;
+    const quint8* m = mask.constData();
+    for (int idx = 0; idx < mask.size(); idx++)
+    {
+        n += m[idx];
+    }
+    return n;
+}
+
+//-------------------------------------------------------------------------
+QList<QPair<QString,int> > DcPresetColumns::histogram( int key,const QVector<quint8>& mask )
+{
+    QList<QPair<QString,int> > result;
+
+    if(key == NameKey)
+    {
+        QHash<QString,int> counts;
+        for (int row = 0; row < _names.size(); row++)
+        {
+            if(mask.at( row ))
+            {
+                counts[_names.at( row )]++;
+            }
+        }
+        for (QHash<QString,int>::const_iterator it = counts.constBegin(); it != counts.constEnd(); ++it)
+        {
+            result.append( qMakePair( it.key(),it.value() ) );
+        }
+    }
+    else
+    {
+        // Types are counted per device since the codes differ
+        const QVector<quint16>& col = column( key );
+        const quint16* c = col.constData();
+        const quint16* dev = _device.constData();
+        const quint8* m = mask.constData();
+        QVector<int> counts( (key == TypeKey || key == NumberKey) ? 0x10000 : 0x100 );
+        int* n = counts.data();
+        if(key == TypeKey)
+        {
+            for (int row = 0; row < col.size(); row++)
+            {
+                n[((dev[row] & 0xFF) << 8) | (c[row] & 0xFF)] += m[row];
+            }
+        }
+        else
+        {
+            const int limit = counts.size() - 1;
+            for (int row = 0; row < col.size(); row++)
+            {
+                n[qMin( (int)c[row],limit )] += m[row];
+            }
+        }
+
+        for (int code = 0; code < counts.size(); code++)
+        {
+            if(!n[code])
+            {
+                continue;
+            }
+
+            QString lbl;
+            if(key == DeviceKey)
+            {
+                const DcPresetSchema::Layout* l = DcPresetSchema::forProduct( code );
+                lbl = l ? QString( QLatin1String( l->Device ) ) : QString::number( code );
+            }
+            else if(key == TypeKey)
+            {
+                const DcPresetSchema::Layout* l = DcPresetSchema::forProduct( code >> 8 );
+                int t = code & 0xFF;
+                lbl = (l && l->EffectTypes && t < l->EffectTypeCount) ?
+                    QString( "%1 %2" ).arg( QLatin1String( l->Device ) ).arg( QLatin1String( l->EffectTypes[t] ) ) :
+                    QString( "%1 type %2" ).arg( l ? QLatin1String( l->Device ) : QLatin1String( "?" ) ).arg( t );
+            }
+            else
+            {
+                lbl = QString::number( code );
+            }
+            result.append( qMakePair( lbl,n[code] ) );
+        }
+    }
+
+    std::stable_sort( result.begin(),result.end(),[]( const QPair<QString,int>& a,const QPair<QString,int>& b )
+        { return a.second > b.second; } );
+    return result;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetColumns::stats( int key,const QVector<quint8>& mask,int& min,int& max,double& mean )
+{
+    if(key == NameKey)
+    {
+        _lastErrorString = "stats needs a numeric field";
+        return false;
+    }
+
+    const QVector<quint16>& col = column( key );
+    const quint16* c = col.constData();
+    const quint8* m = mask.constData();
+    qint64 sum = 0;
+    int n = 0;
+    int lo = 0xFFFF;
+    int hi = 0;
+    for (int row = 0; row < col.size(); row++)
+    {
+        if(m[row])
+        {
+            sum += c[row];
+            n++;
+            lo = qMin( lo,(int)c[row] );
+            hi = qMax( hi,(int)c[row] );
+        }
+    }
+
+    if(!n)
+    {
+        _lastErrorString = "No presets match";
+        return false;
+    }
+    min = lo;
+    max = hi;
+    mean = (double)sum / n;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+QString DcPresetColumns::rowText( int row ) const
+{
+    DcPresetRef ref( _presets.at( row ) );
+    return QString( "%1 %2 %3 %4 (%5)" ).arg( _origins.at( row ) ).arg( ref.layout()->Device )
+        .arg( ref.location() ).arg( _names.at( row ) ).arg( ref.effectTypeName() );
+}
@@ -0,0 +1,129 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetColumns.h
+ \brief Column store of decoded preset fields for fleet wide queries.
+ Each field is one contiguous array across all presets, so a filter or
+ aggregate is a single pass over one array.  Parameter bytes are gathered
+ into columns on first use.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QVector>
+#include <QHash>
+#include <QByteArray>
+
+class DcPresetColumns
+{
+public:
+
+    /*!
+      Column keys.  Decoded fields are negative, a key >= 0 is the byte at
+      that offset in the preset message.
+    */
+    enum Key
+    {
+        DeviceKey   = -1,
+        NumberKey   = -2,
+        TypeKey     = -3,
+        ChecksumKey = -4,
+        NameKey     = -5
+    };
+
+    enum Compare
+    {
+        Eq,
+        Ne,
+        Lt,
+        Gt,
+        Le,
+        Ge,
+        Contains
+    };
+
+    struct Condition
+    {
+        Condition() : Key( 0 ),Op( Eq ),Value( 0 ),Numeric( true ) {}
+
+        int Key;
+        Compare Op;
+        int Value;
+        QString Text;
+        bool Numeric;       // false when Text must be resolved per device, e.g. type=Shimmer
+    };
+
+    DcPresetColumns();
+
+    void clear();
+
+    /*!
+      Adds a preset, anything that is not a valid preset of a known device
+      is ignored and false returned.  origin is shown by rowText().
+    */
+    bool append( const QByteArray& preset,const QString& origin );
+
+    int rowCount() const { return _presets.size(); }
+
+    /*!
+      Parses a field name: device, number, type, checksum, name or b<offset>.
+    */
+    bool parseKey( const QString& name,int& key );
+    QString keyName( int key ) const;
+
+    /*!
+      Parses a condition such as "type=Shimmer", "b120>50" or "name~pad".
+    */
+    bool parseCondition( const QString& text,Condition& cond );
+
+    /*!
+      Returns a 0/1 mask of the rows matching every condition.
+    */
+    QVector<quint8> filter( const QList<Condition>& conds );
+    static int count( const QVector<quint8>& mask );
+
+    /*!
+      Value counts of a column over the selected rows, most common first.
+    */
+    QList<QPair<QString,int> > histogram( int key,const QVector<quint8>& mask );
+
+    /*!
+      Minimum, maximum and mean of a column over the selected rows.
+      Returns false if no rows are selected.
+    */
+    bool stats( int key,const QVector<quint8>& mask,int& min,int& max,double& mean );
+
+    QString rowText( int row ) const;
+
+    QString getLastErrorString() const { return _lastErrorString; }
+
+private:
+    const QVector<quint16>& column( int key );
+
+    QVector<QByteArray> _presets;
+    QVector<QString> _names;
+    QVector<QString> _origins;
+    QVector<quint16> _device;
+    QVector<quint16> _number;
+    QVector<quint16> _type;
+    QVector<quint16> _checksum;
+    QHash<int,QVector<quint16> > _bytes;
+    int _maxSize;
+    QString _lastErrorString;
+};
@@ -0,0 +1,274 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetDiff.h"
+#include <string.h>
+
+namespace
+{
+    // Changed runs closer than this are reported as one range, parameters
+    // are 14 bit values split over two bytes.
+    const int kMergeGap = 2;
+
+    //-------------------------------------------------------------------------
+    bool sameBytes( const char* a,const char* b,int begin,int end )
+    {
+        return begin >= end || memcmp( a + begin,b + begin,end - begin ) == 0;
+    }
+
+    //-------------------------------------------------------------------------
+    void diffRange( const char* a,const char* b,int begin,int end,QList<DcPresetByteRange>& out )
+    {
+        int i = begin;
+        while(i < end)
+        {
+            // Skip equal words, then equal bytes
+            while(i + 8 <= end)
+            {
+                quint64 wa,wb;
+                memcpy( &wa,a + i,8 );
+                memcpy( &wb,b + i,8 );
+                if(wa != wb)
+                {
+                    break;
+                }
+                i += 8;
+            }
+            while(i < end && a[i] == b[i])
+            {
+                i++;
+            }
+            if(i >= end)
+            {
+                break;
+            }
+
+            int start = i;
+            while(i < end && a[i] != b[i])
+            {
+                i++;
+            }
+
+            if(!out.isEmpty() && start - (out.last().Offset + out.last().Length) <= kMergeGap)
+            {
+                out.last().Length = i - out.last().Offset;
+            }
+            else
+            {
+                out.append( DcPresetByteRange( start,i - start ) );
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    QString hexBytes( const QByteArray& ba,int offset,int len )
+    {
+        return QString( ba.mid( offset,len ).toHex() );
+    }
+}
+
+//-------------------------------------------------------------------------
+DcPresetLayout::DcPresetLayout( const DcPresetSchema::Layout& schema /*= DcPresetSchema::defaultLayout()*/ )
+    : Size( schema.Size ),
+    NumberOffset( schema.offset( DcPresetSchema::Number ) ),
+    EffectTypeOffset( schema.offset( DcPresetSchema::EffectType ) ),
+    DataOffset( schema.offset( DcPresetSchema::Data ) ),
+    DataLength( schema.width( DcPresetSchema::Data ) ),
+    NameOffset( schema.offset( DcPresetSchema::Name ) ),
+    NameLen( schema.width( DcPresetSchema::Name ) ),
+    ChecksumOffset( schema.offset( DcPresetSchema::Checksum ) )
+{
+}
+
+//-------------------------------------------------------------------------
+DcPresetLayout DcPresetLayout::forMessage( const QByteArray& preset )
+{
+    const DcPresetSchema::Layout* schema = DcPresetSchema::forMessage( preset );
+    return schema ? DcPresetLayout( *schema ) : DcPresetLayout();
+}
+
+//-------------------------------------------------------------------------
+int DcPresetDelta::paramBytes() const
+{
+    int bytes = 0;
+    foreach(const DcPresetByteRange& r,Ranges)
+    {
+        bytes += r.Length;
+    }
+    return bytes;
+}
+
+//-------------------------------------------------------------------------
+DcPresetDelta DcPresetDiff::compare( const DcMidiData& a,const DcMidiData& b )
+{
+    DcPresetDelta delta;
+    QByteArray baA = a.toByteArray();
+    QByteArray baB = b.toByteArray();
+    int len = baA.length();
+    DcPresetLayout layout = DcPresetLayout::forMessage( baA );
+
+    if(len != baB.length())
+    {
+        delta.Changes = DcPresetDelta::Length;
+        return delta;
+    }
+    const char* pa = baA.constData();
+    const char* pb = baB.constData();
+    if(memcmp( pa,pb,len ) == 0)
+    {
+        return delta;
+    }
+
+    if(len < layout.Size)
+    {
+        // Not a preset this layout describes, report the raw bytes
+        delta.Changes = DcPresetDelta::Params;
+        diffRange( pa,pb,0,len,delta.Ranges );
+        return delta;
+    }
+
+    int dataEnd  = layout.DataOffset + layout.DataLength;
+    int typeEnd  = layout.EffectTypeOffset + 1;
+    int nameEnd  = layout.NameOffset + layout.NameLen;
+
+    if(!sameBytes( pa,pb,0,layout.NumberOffset ))
+    {
+        delta.Changes |= DcPresetDelta::Header;
+    }
+    if(!sameBytes( pa,pb,layout.NumberOffset,layout.DataOffset ))
+    {
+        delta.Changes |= DcPresetDelta::Number;
+    }
+    if(!sameBytes( pa,pb,layout.EffectTypeOffset,typeEnd ))
+    {
+        delta.Changes |= DcPresetDelta::EffectType;
+    }
+    if(!sameBytes( pa,pb,layout.NameOffset,nameEnd ))
+    {
+        delta.Changes |= DcPresetDelta::Name;
+    }
+    if(!sameBytes( pa,pb,layout.ChecksumOffset,layout.ChecksumOffset + 1 ))
+    {
+        delta.Changes |= DcPresetDelta::Checksum;
+    }
+
+    // Parameter region, less the effect type byte and the name
+    diffRange( pa,pb,qMax( layout.DataOffset,typeEnd ),qMin( layout.NameOffset,dataEnd ),delta.Ranges );
+    diffRange( pa,pb,qMax( layout.DataOffset,nameEnd ),dataEnd,delta.Ranges );
+    if(!delta.Ranges.isEmpty())
+    {
+        delta.Changes |= DcPresetDelta::Params;
+    }
+    return delta;
+}
+
+//-------------------------------------------------------------------------
+DcBundleDiff DcPresetDiff::compare( const QList<DcMidiData>& a,const QList<DcMidiData>& b )
+{
+    DcBundleDiff diff;
+    diff.Compared = qMin( a.length(),b.length() );
+    diff.Removed = a.length() - diff.Compared;
+    diff.Added = b.length() - diff.Compared;
+
+    for (int row = 0; row < diff.Compared; row++)
+    {
+        DcPresetDelta delta = compare( a.at( row ),b.at( row ) );
+        if(!delta.isEmpty())
+        {
+            delta.Row = row;
+            diff.Changed.append( delta );
+        }
+    }
+    return diff;
+}
+
+//-------------------------------------------------------------------------
+QString DcPresetDiff::summary( const DcPresetDelta& delta )
+{
+    QStringList parts;
+    if(delta.Changes & DcPresetDelta::Length)
+    {
+        parts << "length differs";
+    }
+    if(delta.Changes & DcPresetDelta::Header)
+    {
+        parts << "header";
+    }
+    if(delta.Changes & DcPresetDelta::Number)
+    {
+        parts << "number";
+    }
+    if(delta.Changes & DcPresetDelta::Name)
+    {
+        parts << "renamed";
+    }
+    if(delta.Changes & DcPresetDelta::EffectType)
+    {
+        parts << "effect type";
+    }
+    if(delta.Changes & DcPresetDelta::Params)
+    {
+        parts << QString( "%1 param ranges (%2 bytes)" ).arg( delta.Ranges.length() ).arg( delta.paramBytes() );
+    }
+    if(parts.isEmpty() && (delta.Changes & DcPresetDelta::Checksum))
+    {
+        parts << "checksum only";
+    }
+    return parts.isEmpty() ? QString( "same" ) : parts.join( ", " );
+}
+
+//-------------------------------------------------------------------------
+QStringList DcPresetDiff::describe( const DcPresetDelta& delta,const DcMidiData& a,const DcMidiData& b )
+{
+    QStringList lines;
+    QByteArray baA = a.toByteArray();
+    QByteArray baB = b.toByteArray();
+    DcPresetLayout layout = DcPresetLayout::forMessage( baA );
+
+    if(delta.Changes & DcPresetDelta::Length)
+    {
+        lines << QString( "length: %1 -> %2" ).arg( baA.length() ).arg( baB.length() );
+        return lines;
+    }
+    if(delta.Changes & DcPresetDelta::Header)
+    {
+        lines << QString( "header: %1 -> %2" ).arg( hexBytes( baA,0,layout.NumberOffset ) ).arg( hexBytes( baB,0,layout.NumberOffset ) );
+    }
+    if(delta.Changes & DcPresetDelta::Number)
+    {
+        lines << QString( "number: %1 -> %2" ).arg( a.get14bit( layout.NumberOffset ) ).arg( b.get14bit( layout.NumberOffset ) );
+    }
+    if(delta.Changes & DcPresetDelta::Name)
+    {
+        lines << QString( "name: '%1' -> '%2'" )
+            .arg( QString( baA.mid( layout.NameOffset,layout.NameLen ) ).trimmed() )
+            .arg( QString( baB.mid( layout.NameOffset,layout.NameLen ) ).trimmed() );
+    }
+    if(delta.Changes & DcPresetDelta::EffectType)
+    {
+        lines << QString( "effect type: %1 -> %2" ).arg( (int)baA.at( layout.EffectTypeOffset ) ).arg( (int)baB.at( layout.EffectTypeOffset ) );
+    }
+    foreach(const DcPresetByteRange& r,delta.Ranges)
+    {
+        lines << QString( "param @%1+%2: %3 -> %4" ).arg( r.Offset ).arg( r.Length )
+            .arg( hexBytes( baA,r.Offset,r.Length ) ).arg( hexBytes( baB,r.Offset,r.Length ) );
+    }
+    if(delta.Changes & DcPresetDelta::Checksum)
+    {
+        lines << QString( "checksum: %1 -> %2" ).arg( hexBytes( baA,layout.ChecksumOffset,1 ) ).arg( hexBytes( baB,layout.ChecksumOffset,1 ) );
+    }
+    return lines;
+}
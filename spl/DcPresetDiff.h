@@ -0,0 +1,137 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetDiff.h
+ \brief Compares presets and preset bundles field by field using the
+ preset layout of its device, so a rename can be told apart from a sound
+ change.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include "DcMidi/DcMidiData.h"
+#include "DcPresetSchema.h"
+
+/*!
+  Offsets of the fields the diff engine knows about, taken from one
+  DcPresetSchema layout.
+*/
+struct DcPresetLayout
+{
+    explicit DcPresetLayout( const DcPresetSchema::Layout& schema = DcPresetSchema::defaultLayout() );
+
+    /*!
+      Layout of the device named by the preset header, or the default
+      layout for any other message.
+    */
+    static DcPresetLayout forMessage( const QByteArray& preset );
+
+    int Size;
+    int NumberOffset;
+    int EffectTypeOffset;
+    int DataOffset;
+    int DataLength;
+    int NameOffset;
+    int NameLen;
+    int ChecksumOffset;
+};
+
+/*!
+  A run of changed bytes in the parameter region.
+*/
+struct DcPresetByteRange
+{
+    DcPresetByteRange( int offset = 0,int length = 0 ) : Offset( offset ),Length( length ) {}
+    int Offset;
+    int Length;
+};
+
+/*!
+  What changed between two presets.
+*/
+struct DcPresetDelta
+{
+    enum Change
+    {
+        None        = 0x00,
+        Header      = 0x01,
+        Number      = 0x02,
+        Name        = 0x04,
+        EffectType  = 0x08,
+        Params      = 0x10,
+        Checksum    = 0x20,
+        Length      = 0x40
+    };
+
+    DcPresetDelta() : Row( -1 ),Changes( None ) {}
+
+    bool isEmpty() const { return Changes == None; }
+
+    /*!
+      True when only the name, and so the checksum, differ.
+    */
+    bool isRenameOnly() const { return (Changes & ~Checksum) == Name; }
+
+    int paramBytes() const;
+
+    int Row;
+    int Changes;
+    QList<DcPresetByteRange> Ranges;
+};
+
+/*!
+  Result of comparing two bundles slot by slot.
+*/
+struct DcBundleDiff
+{
+    DcBundleDiff() : Compared( 0 ),Added( 0 ),Removed( 0 ) {}
+
+    bool isEmpty() const { return Changed.isEmpty() && !Added && !Removed; }
+
+    int Compared;
+    int Added;
+    int Removed;
+    QList<DcPresetDelta> Changed;
+};
+
+namespace DcPresetDiff
+{
+    /*!
+      Compares two presets.  Identical presets return an empty delta
+      after a single memcmp, otherwise each field of the layout of a is
+      checked and the parameter region is walked a machine word at a time.
+    */
+    DcPresetDelta compare( const DcMidiData& a,const DcMidiData& b );
+
+    /*!
+      Compares two bundles by position.  Slots past the end of the
+      shorter bundle are counted as added or removed.
+    */
+    DcBundleDiff compare( const QList<DcMidiData>& a,const QList<DcMidiData>& b );
+
+    /*!
+      Short description of a delta, e.g. "renamed, 3 params (6 bytes)".
+    */
+    QString summary( const DcPresetDelta& delta );
+
+    /*!
+      One line per changed field, with old and new values.  Parameter
+      bytes are shown as hex.
+    */
+    QStringList describe( const DcPresetDelta& delta,const DcMidiData& a,const DcMidiData& b );
+}
@@ -0,0 +1,296 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetExporter.h"
+#include <QFile>
+#include <QDir>
+#include <QThread>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QTextStream>
+#include "DcPresetBundle.h"
+#include "DcPresetSchema.h"
+
+//-------------------------------------------------------------------------
+DcPresetExporter::DcPresetExporter( QObject* parent )
+    : QObject( parent ),_total( 0 ),_progressStep( 1 )
+{
+    setMaxThreads( QThread::idealThreadCount() );
+}
+
+//-------------------------------------------------------------------------
+DcPresetExporter::~DcPresetExporter()
+{
+    cancel();
+    wait();
+}
+
+//-------------------------------------------------------------------------
+QString DcPresetExporter::sanitizeFileName( const QString& name )
+{
+    static const QString kReserved = "<>:\"/\\|?*";
+
+    QString result;
+    result.reserve( name.length() );
+    foreach(QChar ch,name)
+    {
+        if(ch.unicode() < 0x20 || kReserved.contains( ch ))
+        {
+            result += '_';
+        }
+        else
+        {
+            result += ch;
+        }
+    }
+
+    // Windows drops trailing dots and spaces
+    while(result.endsWith( '.' ) || result.endsWith( ' ' ))
+    {
+        result.chop( 1 );
+    }
+    return result.isEmpty() ? QString( "_" ) : result;
+}
+
+//-------------------------------------------------------------------------
+QString DcPresetExporter::uniquePath( const QString& dir,const QString& name,const QString& suffix,QSet<QString>& used )
+{
+    QString base = QDir::toNativeSeparators( dir + "/" + sanitizeFileName( name ) );
+    QString path = base + suffix;
+
+    // Case is ignored so the names are also unique on Windows and macOS
+    for (int n = 2; used.contains( path.toLower() ); n++)
+    {
+        path = QString( "%1_%2%3" ).arg( base ).arg( n ).arg( suffix );
+    }
+    used.insert( path.toLower() );
+    return path;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetExporter::appendPresetJobs( const QList<DcMidiData>& presets,const QString& dir,QList<Job>& jobs,QSet<QString>& used )
+{
+    QByteArray csv;
+    QTextStream out( &csv );
+    out << "Preset Name,Location,Type\n";
+
+    for (int idx = 0; idx < presets.length(); idx++)
+    {
+        const QByteArray& ba = presets.at( idx ).toByteArray();
+        DcPresetRef preset( ba );
+
+        QString name;
+        if(preset.isValid())
+        {
+            out << preset.name() << "," << preset.location() << "," << preset.effectTypeName() << "\n";
+            name = preset.location() + "_" + preset.name() + "_" + preset.effectTypeName();
+        }
+        else
+        {
+            name = QString( "preset_%1" ).arg( idx );
+        }
+        jobs.append( Job( uniquePath( dir,name,".syx",used ),ba ) );
+    }
+
+    out.flush();
+    jobs.append( Job( uniquePath( dir,"preset_info",".csv",used ),csv ) );
+}
+
+//-------------------------------------------------------------------------
+void DcPresetExporter::setMaxThreads( int count )
+{
+    _pool.setMaxThreadCount( qBound( 1,count,(int)kMaxThreads ) );
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetExporter::start( const QList<Job>& jobs )
+{
+    if(isRunning())
+    {
+        return false;
+    }
+    _pool.waitForDone();
+
+    _jobs = jobs;
+    _cancel.store( 0 );
+    launch();
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetExporter::startSplit( const QString& source,const QString& destPath )
+{
+    if(isRunning())
+    {
+        return false;
+    }
+    _pool.waitForDone();
+
+    // The splitter counts as the one active worker until it hands over
+    _jobs.clear();
+    _cancel.store( 0 );
+    _active.store( 1 );
+    _pool.start( new Splitter( this,source,destPath ) );
+    return true;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetExporter::launch()
+{
+    _total = _jobs.length();
+    _progressStep = qMax( 1,_total / 10 );
+    _next.store( 0 );
+    _done.store( 0 );
+    _failed.store( 0 );
+
+    if(!_total)
+    {
+        _active.store( 0 );
+        emit finished( 0,0,_cancel.load() != 0 );
+        return;
+    }
+
+    int workers = qMin( _pool.maxThreadCount(),_total );
+    _active.store( workers );
+    for (int idx = 0; idx < workers; idx++)
+    {
+        _pool.start( new Worker( this ) );
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcPresetExporter::split( const QString& source,const QString& destPath )
+{
+    QSet<QString> used;
+    int bundles = 0;
+
+    if(QFileInfo( source ).isDir())
+    {
+        QDirIterator it( source,QStringList() << "*.syx",QDir::Files,QDirIterator::Subdirectories );
+        while(it.hasNext() && !_cancel.load())
+        {
+            QString bundlePath = it.next();
+            QString bundleDest = destPath.isEmpty() ? QFileInfo( bundlePath ).absolutePath() : destPath;
+            if(appendBundleJobs( bundlePath,bundleDest,used ))
+            {
+                bundles++;
+            }
+        }
+    }
+    else if(appendBundleJobs( source,destPath,used ))
+    {
+        bundles++;
+    }
+
+    if(_cancel.load())
+    {
+        _jobs.clear();
+    }
+    emit prepared( bundles,_jobs.length() );
+    launch();
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetExporter::appendBundleJobs( const QString& fileName,const QString& destPath,QSet<QString>& used )
+{
+    DcPresetBundle bundle;
+    if(!bundle.open( fileName ))
+    {
+        emit skipped( fileName,bundle.getLastErrorString() );
+        return false;
+    }
+
+    // NAK placeholders are skipped
+    QList<DcMidiData> presets;
+    int msgCount = bundle.splitSysex();
+    for (int idx = 0; idx < msgCount; idx++)
+    {
+        if(!bundle.isNak( idx ))
+        {
+            presets.append( bundle.copy( idx ) );
+        }
+    }
+
+    if(presets.isEmpty())
+    {
+        emit skipped( fileName,"no presets found" );
+        return false;
+    }
+
+    QString path = destPath.isEmpty() ? QFileInfo( fileName ).absolutePath() : destPath;
+    QString exportDirName = QFileInfo( fileName ).baseName();
+    exportDirName.replace( " ","_" );
+    path = QDir::toNativeSeparators( path + "/" + sanitizeFileName( exportDirName ) );
+
+    if(!QDir().mkpath( path ))
+    {
+        emit skipped( fileName,"unable to make " + path );
+        return false;
+    }
+
+    appendPresetJobs( presets,path,_jobs,used );
+    return true;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetExporter::cancel()
+{
+    _cancel.store( 1 );
+}
+
+//-------------------------------------------------------------------------
+void DcPresetExporter::wait()
+{
+    _pool.waitForDone();
+}
+
+//-------------------------------------------------------------------------
+void DcPresetExporter::work()
+{
+    // _jobs is only read while workers are active
+    const QList<Job>& jobs = _jobs;
+
+    while(!_cancel.load())
+    {
+        int idx = _next.fetchAndAddOrdered( 1 );
+        if(idx >= _total)
+        {
+            break;
+        }
+
+        const Job& job = jobs.at( idx );
+        QFile fout( job.Path );
+        bool ok = fout.open( QIODevice::WriteOnly ) && fout.write( job.Data ) == job.Data.size();
+        fout.close();
+        if(!ok)
+        {
+            _failed.fetchAndAddOrdered( 1 );
+        }
+
+        int done = _done.fetchAndAddOrdered( 1 ) + 1;
+        if(done % _progressStep == 0 && done != _total)
+        {
+            emit progress( done,_total );
+        }
+    }
+
+    // The last worker out reports the result
+    if(_active.fetchAndAddOrdered( -1 ) == 1)
+    {
+        int failed = _failed.load();
+        emit finished( _done.load() - failed,failed,_cancel.load() != 0 );
+    }
+}
@@ -0,0 +1,145 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetExporter.h
+ \brief Writes exported preset files on a thread pool.  File names are
+ made safe and unique up front, then a bounded number of workers pull
+ files off a shared list until it is done or the export is cancelled.
+ Splitting bundles also reads and names them on the pool.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QObject>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+#include <QSet>
+#include "DcMidi/DcMidiData.h"
+
+class DcPresetExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    struct Job
+    {
+        Job() {}
+        Job( const QString& path,const QByteArray& data ) : Path( path ),Data( data ) {}
+        QString Path;
+        QByteArray Data;
+    };
+
+    DcPresetExporter( QObject* parent = 0 );
+    ~DcPresetExporter();
+
+    /*!
+      Replaces characters that are not allowed in file names on any of the
+      supported platforms, and trims trailing dots and spaces.
+    */
+    static QString sanitizeFileName( const QString& name );
+
+    /*!
+      Returns dir/name+suffix, with name sanitized and a _2, _3... added if
+      the path is already used.  The path is added to used.
+    */
+    static QString uniquePath( const QString& dir,const QString& name,const QString& suffix,QSet<QString>& used );
+
+    /*!
+      Adds a job per preset, named by location, name and effect type, plus
+      a preset_info.csv listing them.
+    */
+    static void appendPresetJobs( const QList<DcMidiData>& presets,const QString& dir,QList<Job>& jobs,QSet<QString>& used );
+
+    /*!
+      Defaults to the ideal thread count, at most kMaxThreads.
+    */
+    void setMaxThreads( int count );
+
+    static const int kMaxThreads = 8;
+
+    /*!
+      Starts writing jobs.  Returns false if an export is already running.
+    */
+    bool start( const QList<Job>& jobs );
+
+    /*!
+      Splits source, a bundle or a folder of .syx bundles, into one file per
+      preset under destPath (or beside each bundle when empty).  Reading the
+      bundles and making the folders happens on the pool, prepared() is
+      emitted before any file is written.
+    */
+    bool startSplit( const QString& source,const QString& destPath );
+
+    bool isRunning() const { return _active.load() > 0; }
+
+    /*!
+      Workers stop after the file they are writing, finished() is still
+      emitted.
+    */
+    void cancel();
+
+    /*!
+      Blocks until the workers are done.
+    */
+    void wait();
+
+signals:
+    void prepared( int bundles,int files );
+    void skipped( const QString& path,const QString& reason );
+    void progress( int done,int total );
+    void finished( int written,int failed,bool cancelled );
+
+private:
+    class Worker : public QRunnable
+    {
+    public:
+        Worker( DcPresetExporter* owner ) : _owner( owner ) {}
+        void run() { _owner->work(); }
+    private:
+        DcPresetExporter* _owner;
+    };
+
+    class Splitter : public QRunnable
+    {
+    public:
+        Splitter( DcPresetExporter* owner,const QString& source,const QString& destPath )
+            : _owner( owner ),_source( source ),_destPath( destPath ) {}
+        void run() { _owner->split( _source,_destPath ); }
+    private:
+        DcPresetExporter* _owner;
+        QString _source;
+        QString _destPath;
+    };
+
+    void launch();
+    void work();
+    void split( const QString& source,const QString& destPath );
+    bool appendBundleJobs( const QString& fileName,const QString& destPath,QSet<QString>& used );
+
+    QThreadPool _pool;
+    QList<Job> _jobs;
+    int _total;
+    int _progressStep;
+    QAtomicInt _next;
+    QAtomicInt _done;
+    QAtomicInt _failed;
+    QAtomicInt _active;
+    QAtomicInt _cancel;
+};
@@ -0,0 +1,563 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetIndex.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QDataStream>
+#include <QSet>
+#include <algorithm>
+#include "DcPresetBundle.h"
+#include "DcPresetArchive.h"
+#include "DcBackupStore.h"
+#include "DcPresetSchema.h"
+
+//-------------------------------------------------------------------------
+DcPresetIndex::DcPresetIndex()
+    : _backupStore(0),_searchDirty(true),_generation(0)
+{
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetIndex::load( const QString& indexPath )
+{
+    _indexPath = indexPath;
+    _files.clear();
+    _searchDirty = true;
+    _generation++;
+
+    QFile file( indexPath );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        // No index yet
+        return true;
+    }
+
+    QDataStream in( &file );
+    quint32 magic;
+    qint32 ver;
+    in >> magic >> ver;
+    if( magic != kMagicNumber || ver != kVersion )
+    {
+        _lastErrorString = "Preset library index is not compatible, it will be rebuilt";
+        return false;
+    }
+    in.setVersion( QDataStream::Qt_5_1 );
+
+    QStringList roots;
+    qint32 fileCnt;
+    in >> roots >> fileCnt;
+    foreach( const QString& r,roots )
+    {
+        addRoot( r );
+    }
+
+    for( int fidx = 0; fidx < fileCnt && in.status() == QDataStream::Ok; fidx++ )
+    {
+        QString path;
+        FileRec rec;
+        qint32 entryCnt;
+        in >> path >> rec.MTime >> rec.Size >> entryCnt;
+
+        rec.Entries.reserve( entryCnt );
+        for( int eidx = 0; eidx < entryCnt; eidx++ )
+        {
+            DcPresetIndexEntry e;
+            in >> e.Device >> e.Name >> e.EffectType >> e.Location >> e.Number >> e.Checksum >> e.Length >> e.Offset;
+            rec.Entries.append( e );
+        }
+        _files.insert( path,rec );
+    }
+
+    if( in.status() != QDataStream::Ok )
+    {
+        _lastErrorString = "Preset library index is damaged, it will be rebuilt";
+        _files.clear();
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetIndex::save()
+{
+    QString tmpPath = _indexPath + ".tmp";
+    QFile file( tmpPath );
+    if( !file.open( QIODevice::WriteOnly ) )
+    {
+        _lastErrorString = "Unable to write the preset library index: " + tmpPath;
+        return false;
+    }
+
+    QDataStream out( &file );
+    out << kMagicNumber << kVersion;
+    out.setVersion( QDataStream::Qt_5_1 );
+    out << _roots << qint32( _files.size() );
+
+    QMap<QString,FileRec>::const_iterator it;
+    for( it = _files.constBegin(); it != _files.constEnd(); ++it )
+    {
+        const FileRec& rec = it.value();
+        out << it.key() << rec.MTime << rec.Size << qint32( rec.Entries.size() );
+        foreach( const DcPresetIndexEntry& e,rec.Entries )
+        {
+            out << e.Device << e.Name << e.EffectType << e.Location << e.Number << e.Checksum << e.Length << e.Offset;
+        }
+    }
+    file.close();
+
+    QFile::remove( _indexPath );
+    return QFile::rename( tmpPath,_indexPath );
+}
+
+//-------------------------------------------------------------------------
+void DcPresetIndex::addRoot( const QString& dir )
+{
+    QString path = QDir::cleanPath( dir );
+    if( !path.isEmpty() && !_roots.contains( path ) )
+    {
+        _roots.append( path );
+    }
+}
+
+//-------------------------------------------------------------------------
+int DcPresetIndex::presetCount() const
+{
+    int cnt = 0;
+    foreach( const FileRec& rec,_files )
+    {
+        cnt += rec.Entries.size();
+    }
+    return cnt;
+}
+
+//-------------------------------------------------------------------------
+int DcPresetIndex::update()
+{
+    QSet<QString> seen;
+    int indexed = 0;
+
+    foreach( const QString& root,_roots )
+    {
+        // A root that is a file is indexed on its own
+        QStringList paths;
+        if( QFileInfo( root ).isFile() )
+        {
+            paths.append( root );
+        }
+        else
+        {
+            QDirIterator it( root,QStringList() << "*.syx" << "*.syz" << QString( "*" ) + DcBackupStore::kManifestSuffix,QDir::Files,QDirIterator::Subdirectories );
+            while( it.hasNext() )
+            {
+                paths.append( it.next() );
+            }
+        }
+
+        foreach( const QString& path,paths )
+        {
+            QFileInfo fi( path );
+            qint64 mtime = fi.lastModified().toMSecsSinceEpoch();
+            seen.insert( path );
+
+            QMap<QString,FileRec>::iterator rit = _files.find( path );
+            if( rit != _files.end() && rit->MTime == mtime && rit->Size == fi.size() )
+            {
+                continue;
+            }
+
+            FileRec rec;
+            rec.MTime = mtime;
+            rec.Size = fi.size();
+            indexFile( path,rec );
+            _files.insert( path,rec );
+            indexed++;
+        }
+    }
+
+    // Drop files that were deleted or are no longer under a root
+    QMap<QString,FileRec>::iterator rit = _files.begin();
+    while( rit != _files.end() )
+    {
+        if( seen.contains( rit.key() ) )
+        {
+            ++rit;
+        }
+        else
+        {
+            rit = _files.erase( rit );
+            indexed++;
+        }
+    }
+
+    if( indexed )
+    {
+        _searchDirty = true;
+        _generation++;
+    }
+    return indexed;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetIndex::indexFile( const QString& path, FileRec& rec )
+{
+    QList<DcMidiData> presets;
+    QList<qint64> offsets;
+
+    // Raw presets are views into the mapped bundle, which must outlive them
+    DcPresetBundle bundle;
+
+    // Compressed files are addressed by preset ordinal instead of byte offset
+    if( DcPresetArchive::isArchive( path ) )
+    {
+        DcPresetArchiveReader r;
+        if( !r.open( path ) )
+        {
+            return false;
+        }
+        DcMidiData md;
+        while( r.next( md ) )
+        {
+            offsets.append( presets.size() );
+            presets.append( md );
+        }
+        if( !r.atEnd() )
+        {
+            return false;
+        }
+    }
+    else if( DcBackupStore::isManifest( path ) )
+    {
+        // Manifests are indexed rather than the shared objects, so each
+        // backup keeps its own time and location
+        if( !_backupStore || !_backupStore->restore( path,presets ) )
+        {
+            return false;
+        }
+        for( int idx = 0; idx < presets.size(); idx++ )
+        {
+            offsets.append( idx );
+        }
+    }
+    else
+    {
+        if( !bundle.open( path ) )
+        {
+            return false;
+        }
+
+        int msgCount = bundle.splitSysex();
+        for( int idx = 0; idx < msgCount; idx++ )
+        {
+            offsets.append( bundle.offset( idx ) );
+            presets.append( bundle.view( idx ) );
+        }
+    }
+
+    indexPresets( presets,offsets,rec );
+    return true;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetIndex::indexPresets( const QList<DcMidiData>& presets, const QList<qint64>& offsets, FileRec& rec )
+{
+    for( int idx = 0; idx < presets.size(); idx++ )
+    {
+        const DcMidiData& md = presets.at( idx );
+        if( md.length() < kHeaderLen )
+        {
+            continue;
+        }
+
+        DcPresetRef preset( md.toByteArray() );
+        if( !preset.isValid() )
+        {
+            continue;
+        }
+
+        DcPresetIndexEntry e;
+        e.Device = preset.layout()->Device;
+        e.Number = preset.number();
+        e.Name = preset.name();
+        e.EffectType = preset.effectTypeName();
+        e.Checksum = preset.checksum();
+        e.Length = md.length();
+        e.Offset = offsets.at( idx );
+        e.Location = preset.location();
+
+        rec.Entries.append( e );
+    }
+}
+
+//-------------------------------------------------------------------------
+QList<DcPresetIndexHit> DcPresetIndex::find( const QString& text, int limit /*= 500*/ ) const
+{
+    QHash<QString,int> byKey;
+    QList<DcPresetIndexHit> hits;
+
+    QMap<QString,FileRec>::const_iterator it;
+    for( it = _files.constBegin(); it != _files.constEnd(); ++it )
+    {
+        const FileRec& rec = it.value();
+        foreach( const DcPresetIndexEntry& e,rec.Entries )
+        {
+            if( !text.isEmpty() &&
+                !e.Name.contains( text,Qt::CaseInsensitive ) &&
+                !e.EffectType.contains( text,Qt::CaseInsensitive ) &&
+                !e.Device.contains( text,Qt::CaseInsensitive ) &&
+                e.Location.compare( text,Qt::CaseInsensitive ) != 0 )
+            {
+                continue;
+            }
+
+            QString key = e.Device + '\t' + e.Name + '\t' + e.EffectType + '\t' + QString::number( e.Checksum );
+            QHash<QString,int>::const_iterator kit = byKey.constFind( key );
+            if( kit == byKey.constEnd() )
+            {
+                DcPresetIndexHit h;
+                h.Entry = e;
+                h.Path = it.key();
+                h.MTime = rec.MTime;
+                h.Copies = 1;
+                h.Score = 0;
+                byKey.insert( key,hits.size() );
+                hits.append( h );
+            }
+            else
+            {
+                DcPresetIndexHit& h = hits[kit.value()];
+                h.Copies++;
+                if( rec.MTime > h.MTime )
+                {
+                    h.Entry = e;
+                    h.Path = it.key();
+                    h.MTime = rec.MTime;
+                }
+            }
+        }
+    }
+
+    std::sort( hits.begin(),hits.end(),[]( const DcPresetIndexHit& a, const DcPresetIndexHit& b ) { return a.MTime > b.MTime; } );
+    if( limit > 0 && hits.size() > limit )
+    {
+        hits = hits.mid( 0,limit );
+    }
+    return hits;
+}
+
+//-------------------------------------------------------------------------
+QList<DcPresetIndexHit> DcPresetIndex::fuzzyFind( const QString& text, int limit /*= 50*/ )
+{
+    if( _searchDirty )
+    {
+        _search.clear();
+        _searchDocs.clear();
+
+        QMap<QString,FileRec>::const_iterator it;
+        for( it = _files.constBegin(); it != _files.constEnd(); ++it )
+        {
+            const QVector<DcPresetIndexEntry>& entries = it.value().Entries;
+            for( int eidx = 0; eidx < entries.size(); eidx++ )
+            {
+                _search.set( _searchDocs.size(),entries.at( eidx ).Name + " " + entries.at( eidx ).EffectType );
+                _searchDocs.append( qMakePair( it.key(),eidx ) );
+            }
+        }
+        _searchDirty = false;
+    }
+
+    // Backups hold many copies of each preset, so look past the limit before collapsing
+    QList<DcTrigramIndex::Match> matches = _search.search( text,limit*16 );
+
+    QHash<QString,int> byKey;
+    QList<DcPresetIndexHit> hits;
+    foreach( const DcTrigramIndex::Match& m,matches )
+    {
+        const QPair<QString,int>& doc = _searchDocs.at( m.Id );
+        const FileRec& rec = _files[doc.first];
+        const DcPresetIndexEntry& e = rec.Entries.at( doc.second );
+
+        QString key = e.Device + '\t' + e.Name + '\t' + e.EffectType + '\t' + QString::number( e.Checksum );
+        QHash<QString,int>::const_iterator kit = byKey.constFind( key );
+        if( kit == byKey.constEnd() )
+        {
+            if( hits.size() >= limit )
+            {
+                continue;
+            }
+            DcPresetIndexHit h;
+            h.Entry = e;
+            h.Path = doc.first;
+            h.MTime = rec.MTime;
+            h.Copies = 1;
+            h.Score = m.Score;
+            byKey.insert( key,hits.size() );
+            hits.append( h );
+        }
+        else
+        {
+            DcPresetIndexHit& h = hits[kit.value()];
+            h.Copies++;
+            if( rec.MTime > h.MTime )
+            {
+                h.Entry = e;
+                h.Path = doc.first;
+                h.MTime = rec.MTime;
+            }
+        }
+    }
+    return hits;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetIndex::loadPreset( const DcPresetIndexHit& hit, DcMidiData& md )
+{
+    if( DcPresetArchive::isArchive( hit.Path ) )
+    {
+        DcPresetArchiveReader r;
+        if( !r.open( hit.Path ) )
+        {
+            _lastErrorString = r.getLastErrorString();
+            return false;
+        }
+        for( qint64 idx = 0; idx <= hit.Entry.Offset; idx++ )
+        {
+            if( !r.next( md ) )
+            {
+                md = DcMidiData();
+                break;
+            }
+        }
+    }
+    else if( DcBackupStore::isManifest( hit.Path ) )
+    {
+        QList<DcMidiData> presets;
+        if( !_backupStore || !_backupStore->restore( hit.Path,presets ) )
+        {
+            _lastErrorString = _backupStore ? _backupStore->getLastErrorString() : "Unable to open the file:\n" + hit.Path;
+            return false;
+        }
+        md = presets.value( (int)hit.Entry.Offset );
+    }
+    else
+    {
+        QFile file( hit.Path );
+        if( !file.open( QIODevice::ReadOnly ) || !file.seek( hit.Entry.Offset ) )
+        {
+            _lastErrorString = "Unable to open the file:\n" + hit.Path;
+            return false;
+        }
+
+        md = file.read( hit.Entry.Length );
+    }
+
+    // The file may have changed since it was indexed
+    if( !entryMatches( hit.Entry,md ) )
+    {
+        _lastErrorString = hit.Path + " has changed since it was indexed, rescan the library";
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+int DcPresetIndex::loadAll( QList<DcMidiData>& presets, QStringList& paths )
+{
+    int skipped = 0;
+
+    QMap<QString,FileRec>::const_iterator it;
+    for( it = _files.constBegin(); it != _files.constEnd(); ++it )
+    {
+        const QVector<DcPresetIndexEntry>& entries = it.value().Entries;
+        if( entries.isEmpty() )
+        {
+            continue;
+        }
+
+        // Entries are in file order, so a .syz is read through once
+        QList<DcMidiData> found;
+        if( DcPresetArchive::isArchive( it.key() ) )
+        {
+            DcPresetArchiveReader r;
+            DcMidiData md;
+            qint64 ordinal = 0;
+            int eidx = 0;
+            if( r.open( it.key() ) )
+            {
+                while( eidx < entries.size() && r.next( md ) )
+                {
+                    if( ordinal++ == entries.at( eidx ).Offset )
+                    {
+                        found.append( md );
+                        eidx++;
+                    }
+                }
+            }
+        }
+        else if( DcBackupStore::isManifest( it.key() ) )
+        {
+            QList<DcMidiData> presets;
+            if( _backupStore && _backupStore->restore( it.key(),presets ) )
+            {
+                foreach( const DcPresetIndexEntry& e,entries )
+                {
+                    found.append( presets.value( (int)e.Offset ) );
+                }
+            }
+        }
+        else
+        {
+            QFile file( it.key() );
+            if( file.open( QIODevice::ReadOnly ) )
+            {
+                foreach( const DcPresetIndexEntry& e,entries )
+                {
+                    found.append( file.seek( e.Offset ) ? DcMidiData( file.read( e.Length ) ) : DcMidiData() );
+                }
+            }
+        }
+
+        for( int eidx = 0; eidx < entries.size(); eidx++ )
+        {
+            if( eidx < found.size() && entryMatches( entries.at( eidx ),found.at( eidx ) ) )
+            {
+                presets.append( found.at( eidx ) );
+                paths.append( it.key() );
+            }
+            else
+            {
+                skipped++;
+            }
+        }
+    }
+    return skipped;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetIndex::entryMatches( const DcPresetIndexEntry& e, const DcMidiData& md )
+{
+    if( md.length() != e.Length || md.length() < kHeaderLen )
+    {
+        return false;
+    }
+
+    DcPresetRef preset( md.toByteArray() );
+    return preset.isValid() &&
+           preset.number() == e.Number &&
+           preset.checksum() == e.Checksum;
+}
@@ -0,0 +1,152 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetIndex.h
+ \brief Searchable index of every preset in the backup folders and any
+ other folders added to the library, raw (.syx), compressed (.syz) or
+ backup manifests (.dcm).  Files are only re-read when their
+ modification time or size changes, the index is saved between runs.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QHash>
+#include "DcTrigramIndex.h"
+#include "DcMidi/DcMidiData.h"
+
+class DcBackupStore;
+
+struct DcPresetIndexEntry
+{
+    QString Device;
+    QString Name;
+    QString EffectType;
+    QString Location;
+    quint16 Number;
+    quint8  Checksum;
+    quint16 Length;
+    qint64  Offset;     // byte offset, or preset ordinal in a .syz or .dcm
+};
+
+/*!
+  One distinct preset found by a query.  Presets with the same device,
+  name, type and checksum are reported once, pointing at the newest copy.
+*/
+struct DcPresetIndexHit
+{
+    DcPresetIndexEntry Entry;
+    QString Path;
+    qint64  MTime;
+    int     Copies;
+    float   Score;
+};
+
+class DcPresetIndex
+{
+public:
+
+    static const quint32 kMagicNumber = 0x44435049;
+    static const qint32  kVersion = 1;
+    static const int     kHeaderLen = 6;
+
+    DcPresetIndex();
+
+    bool load( const QString& indexPath );
+    bool save();
+
+    /*!
+      Folders scanned by update(), or single preset files, these are saved
+      with the index.
+    */
+    void addRoot( const QString& dir );
+    QStringList roots() const { return _roots; }
+
+    /*!
+      Store used to rebuild backup manifests, manifests are skipped
+      until it is set.
+    */
+    void setBackupStore( DcBackupStore* store ) { _backupStore = store; }
+
+    /*!
+      Scans the roots for .syx files, re-indexing new or changed files and
+      dropping deleted ones.  Returns the number of files re-indexed.
+    */
+    int update();
+
+    /*!
+      Returns distinct presets whose name, effect type, device or location
+      contains text (case insensitive), newest first.  An empty text
+      matches everything.
+    */
+    QList<DcPresetIndexHit> find( const QString& text, int limit = 500 ) const;
+
+    /*!
+      Fuzzy (trigram) search over preset names and effect types, best
+      match first.  Distinct presets are collapsed as in find().
+    */
+    QList<DcPresetIndexHit> fuzzyFind( const QString& text, int limit = 50 );
+
+    /*!
+      Reads the preset for the hit from its source file.
+    */
+    bool loadPreset( const DcPresetIndexHit& hit, DcMidiData& md );
+
+    /*!
+      Reads every indexed preset, each file is opened once.  paths gets the
+      file of each preset.  Returns the number of entries skipped because
+      their file changed since it was indexed.
+    */
+    int loadAll( QList<DcMidiData>& presets, QStringList& paths );
+
+    /*!
+      Changes whenever files are indexed or dropped, so callers can tell
+      when data derived from the index is stale.
+    */
+    quint32 generation() const { return _generation; }
+
+    int fileCount() const { return _files.size(); }
+    int presetCount() const;
+
+    QString getLastErrorString() const { return _lastErrorString; }
+
+private:
+    struct FileRec
+    {
+        qint64 MTime;
+        qint64 Size;
+        QVector<DcPresetIndexEntry> Entries;
+    };
+
+    bool indexFile( const QString& path, FileRec& rec );
+    static bool entryMatches( const DcPresetIndexEntry& e, const DcMidiData& md );
+    void indexPresets( const QList<DcMidiData>& presets, const QList<qint64>& offsets, FileRec& rec );
+
+    QString _indexPath;
+    QStringList _roots;
+    QMap<QString,FileRec> _files;
+    DcBackupStore* _backupStore;
+
+    // Fuzzy search over every entry, rebuilt on the first search after a change
+    DcTrigramIndex _search;
+    QVector<QPair<QString,int> > _searchDocs;
+    bool _searchDirty;
+    quint32 _generation;
+
+    QString _lastErrorString;
+};
@@ -27,6 +27,8 @@
 
 #include <QKeyEvent>
 #include <QDir>
+#include <algorithm>
+#include <QDirIterator>
 #include <QSysInfo>
 #include <QStandardPaths>
 #include <QSettings>
@@ -38,6 +40,8 @@
 // State machine
 #include <QFinalState>
 #include <QHistoryState>
+#include <QHash>
+#include <QElapsedTimer>
 #include <QSignalTransition>
 #include "cmn/DcState.h"
 #include "cmn/DcGlobals.h"
@@ -57,6 +61,11 @@
 #include "RenameDialog.h"
 #include "MoveDialog.h"
 #include "DcListWidget.h"
+#include "DcPresetBundle.h"
+#include "DcSysexScanner.h"
+#include "DcBackupStore.h"
+#include "DcPresetArchive.h"
+#include "DcBackupWriter.h"
 
 #include <QTime>
 #include <QDesktopServices>
@@ -95,15 +104,35 @@ const char* DcMidiDevDefs::kMobiusIdent   = "F0 7E .. 06 02 00 01 55 12 00 02";
 const char* DcMidiDevDefs::kBigSkyIdent   = "F0 7E .. 06 02 00 01 55 12 00 03"; // Big sky
 const char* DcMidiDevDefs::kTestDevice    = "F0 7E .. 06 02 00 01 55 12 00 04"; // Test Device
 
-bool gUseAltPresetSize = false;
 
 DcPresetLib::DcPresetLib(QWidget *parent)
     : QMainWindow(parent),_log(0)
 {
     setupFilePaths();
+    connect(&_backupWriter,&DcBackupWriter::backupWritten,this,&DcPresetLib::backupWritten);
+    connect(&_backupWriter,&DcBackupWriter::backupFailed,this,&DcPresetLib::backupFailed);
+    connect(&_exporter,&DcPresetExporter::prepared,this,&DcPresetLib::exportPrepared);
+    connect(&_exporter,&DcPresetExporter::skipped,this,&DcPresetLib::exportSkipped);
+    connect(&_exporter,&DcPresetExporter::progress,this,&DcPresetLib::exportProgress);
+    connect(&_exporter,&DcPresetExporter::finished,this,&DcPresetLib::exportFinished);
     _log = new DcLog(QDir::toNativeSeparators(_dataPath + QApplication::applicationName() + ".log"));
 
      ui.setupUi(this);
+    _dirtyRows.setLists(&_deviceListData,&_workListData);
+
+    // Both lists are views over the preset data, labels are built as rows are shown
+    DcPresetListModel::LabelFunction label = [this](const DcMidiData& md) { DcMidiData p = md; return presetToBankPatchName(p); };
+    _deviceListModel = new DcPresetListModel(this);
+    _deviceListModel->setLabelFunction(label);
+    _deviceListModel->setPresets(&_deviceListData);
+    ui.deviceList->setModel(_deviceListModel);
+
+    _workListModel = new DcPresetListModel(this);
+    _workListModel->setLabelFunction(label);
+    _workListModel->setDirtyTracker(&_dirtyRows);
+    _workListModel->setToolTipFunction([this](int row) { return worklistRowToolTip(row); });
+    _workListModel->setPresets(&_workListData);
+    ui.workList->setModel(_workListModel);
 
 
 
@@ -131,6 +160,13 @@ DcPresetLib::DcPresetLib(QWidget *parent)
     _presetOffset = 0;
     
     _fileDownloader = 0;
+    _verifyWrites = false;
+    _autoDiscover = true;
+    _verifyPass = 0;
+    _multiSession = 0;
+    _libraryDlg = 0;
+    _presetIndexLoaded = false;
+    _multiOp = DcDeviceSession::Fetch;
 
     installEventFilter(this);
 
@@ -233,7 +269,7 @@ void DcPresetLib::closeEvent( QCloseEvent *e )
 {
     writeSettings();
 
-    if(_dirtyItemsIndex.length())
+    if(_dirtyRows.count())
     {
         if (QMessageBox::Discard == QMessageBox::question(this, "Unsaved Worklist Warning",
             "You have unsaved presets in the Worklist.\nAre you sure you want to quit?",
@@ -241,6 +277,8 @@ void DcPresetLib::closeEvent( QCloseEvent *e )
                                                                       QMessageBox::Abort))
         {
             e->accept();
+            _backupWriter.flush();
+            _exporter.wait();
             _con->execCmd("defsv default_defs.bin");
         }
         else
@@ -256,6 +294,8 @@ void DcPresetLib::closeEvent( QCloseEvent *e )
     else
     {
          e->accept();
+         _backupWriter.flush();
+         _exporter.wait();
          _con->execCmd("defsv default_defs.bin");
     }
 
@@ -286,10 +326,18 @@ void DcPresetLib::setupFilePaths()
     _worklistBackupPath = QDir::toNativeSeparators(baseBackupPath  + "worklist/");
     _devlistBackupPath = QDir::toNativeSeparators(baseBackupPath  + "device/");
 
+    // Backups are stored as manifests into a shared preset store unless disabled
+    _backupDedup = settings.value("backup/dedup",true).toBool();
+    _backupCompress = settings.value("backup/compress",false).toBool();
+    _backupStore.setRoot(QDir::toNativeSeparators(baseBackupPath  + "store/"));
+    _backupWriter.setStoreRoot(_backupStore.root());
+    _backupWriter.setFsyncPolicy((DcBackupWriter::FsyncPolicy)settings.value("backup/fsync",DcBackupWriter::FsyncFile).toInt());
+
     if(_backupEnabled)
     {
         QDir().mkpath(_worklistBackupPath);
         QDir().mkpath(_devlistBackupPath);
+        QDir().mkpath(_backupStore.objectsPath());
     }
 
     QString qsspath = QDir::toNativeSeparators(_dataPath + "qss/");
@@ -310,9 +358,9 @@ void DcPresetLib::writeSettings()
     settings.beginGroup("console");
     settings.setValue("show",ui.actionShow_Console->isChecked());
     settings.endGroup();
-    
-    settings.setValue("fastfetch",gUseAltPresetSize);
 
+    settings.setValue("verifywrites",_verifyWrites);
+    settings.setValue("midiio/autodiscover",_autoDiscover);
 }
 
 //-------------------------------------------------------------------------
@@ -354,13 +402,17 @@ void DcPresetLib::readSettings()
     settings.beginGroup("midiio");
     _maxMsgSize = settings.value("MaxMsgSize",-1).toInt();
     _delayPerMsgChunk = settings.value( "DelayPerMsgChunk",-1 ).toInt();
+    _retryBackoff.setup( settings.value( "RetryBaseMs",100 ).toInt(),
+                         settings.value( "RetryMaxMs",2000 ).toInt(),
+                         settings.value( "RetryJitterPct",25 ).toInt() );
     settings.endGroup();
 
+    _xferInMachine.setRetryBackoff( _retryBackoff );
+    _xferOutMachine.setRetryBackoff( _retryBackoff );
+    _xferVerifyMachine.setRetryBackoff( _retryBackoff );
 
-    DCLOG() << "fastfetch: " << gUseAltPresetSize;
-    gUseAltPresetSize = settings.value("fastfetch",false).toBool();
-    DCLOG() << "fastfetch is now: " << gUseAltPresetSize;
-
+    _verifyWrites = settings.value("verifywrites",false).toBool();
+    _autoDiscover = settings.value("midiio/autodiscover",true).toBool();
 }
 
 bool DcPresetLib::sendAndWait( DcMidiData& md,const QString& cmd,const QString& waitForData,int timeout )
@@ -396,7 +448,27 @@ void DcPresetLib::detectDevice_entered()
 
     // Turn on io logging
     int ll = _midiIn.getLoglevel();
-    bool chkResults = checkTestAndConfigureMidiPorts( in_port,out_port );
+
+    // With no usable saved ports, look on every port pair before the slow checks
+    _midiIn.init();
+    _midiOut.init();
+    bool havePorts = _midiIn.getPortNames().contains( in_port ) && _midiOut.getPortNames().contains( out_port );
+    bool chkResults = false;
+    if( !havePorts && _autoDiscover )
+    {
+        chkResults = discoverMidiPorts( in_port,out_port );
+    }
+
+    if( !chkResults )
+    {
+        chkResults = checkTestAndConfigureMidiPorts( in_port,out_port );
+    }
+
+    // The saved ports are wrong
+    if( !chkResults && havePorts && _autoDiscover && !_iodlg->cancled() )
+    {
+        chkResults = discoverMidiPorts( in_port,out_port );
+    }
     
     if( chkResults && !_devDetails.isCrippled() )
     {
@@ -701,6 +773,49 @@ bool DcPresetLib::checkTestAndConfigureMidiPorts( QString in_port,QString out_po
     return false;
 }
 
+//-------------------------------------------------------------------------
+bool DcPresetLib::discoverMidiPorts( QString& in_port,QString& out_port )
+{
+    shutdownMidiIo();
+    dlgMsg( "searching every MIDI port for a device" );
+
+    DcPortScanner scanner;
+    QElapsedTimer t;
+    t.start();
+    QList<DcPortScanner::PortPair> found = scanner.scan();
+    if( found.isEmpty() )
+    {
+        DCLOG() << "Port scan: " << scanner.getLastErrorString();
+        return false;
+    }
+
+    DCLOG() << "Port scan: " << found.length() << " candidate pairs after " << t.elapsed() << " ms";
+
+    // Fastest first, a pair is only kept once the full device check passes
+    foreach( const DcPortScanner::PortPair& p,found )
+    {
+        if( _iodlg->cancled() )
+        {
+            break;
+        }
+
+        DCLOG() << "Port scan: trying " << p.Device << " on " << p.InPort << " / " << p.OutPort;
+        shutdownMidiIo();
+        if( checkTestAndConfigureMidiPorts( p.InPort,p.OutPort ) )
+        {
+            // Remember the pair the same way the MIDI settings dialog does
+            in_port = p.InPort;
+            out_port = p.OutPort;
+            QSettings settings;
+            settings.setValue( "midi/inport-name",in_port );
+            settings.setValue( "midi/outport-name",out_port );
+            return true;
+        }
+    }
+    return false;
+}
+
+//-------------------------------------------------------------------------
 void DcPresetLib::dlgMsg( const QString& msg )
 {
     _iodlg->setMessage(msg);
@@ -890,17 +1005,17 @@ void DcPresetLib::erroRecovery_entered()
     int presetCount = mdl.length();
     if(presetCount)
     {
+        QList<int> changedRows;
         for (int idx = 0; idx < presetCount; idx++)
         {
             DcMidiData md = mdl.at(idx);
             int pid = getPresetNumber(md);
-            _deviceListData[pid] = md;
+            _deviceListData.replace(pid,md);
+            changedRows.append(pid);
         }
 
-        QStringList names = presetListToBankPatchName(_deviceListData);
         // Update device list display
-        ui.deviceList->clear();
-        ui.deviceList->addItems(names);
+        _deviceListModel->rowsChanged(changedRows);
     }
 
     clearMidiInConnections();
@@ -1084,7 +1199,7 @@ void DcPresetLib::userCanFetch_entered()
     // See if the worklist contains data for the detected device
     if(_devDetails.getUid() != _workListDataDeviceUid)
     {
-        if(_dirtyItemsIndex.length())
+        if(_dirtyRows.count())
         {
             if (QMessageBox::Save == QMessageBox::question(this, "The worklist was not inSync with the device",
                 "Would you like to save the changes?", QMessageBox::Save|QMessageBox::No))
@@ -1093,11 +1208,11 @@ void DcPresetLib::userCanFetch_entered()
             }
         }
         
-        _dirtyItemsIndex.clear();
-        ui.workList->clear();
-        ui.deviceList->clear();
+        _dirtyRows.clear();
         _workListData.clear();
         _deviceListData.clear();
+        _workListModel->reset();
+        _deviceListModel->reset();
     }
     else
     {
@@ -1237,6 +1352,11 @@ void DcPresetLib::setupStateMachineHandler()
     
     // Setup the dataOut system
     DcState* xferOutState = _xferOutMachine.setupStateMachine(&_machine,&_midiOut,writePresetsCompleteState,errorRecovery,errorRecovery);
+
+    // Setup the verify-after-write readback
+    DcState *verifyWritesCompleteState = new DcState(QString("verifyWritesCompleteState"));
+    _machine.addState(verifyWritesCompleteState);
+    DcState* xferVerifyState = _xferVerifyMachine.setupStateMachine(&_machine,&_midiOut,verifyWritesCompleteState,errorRecovery,errorRecovery);
     
     // State readPreset will call setupReadPresetXfer and transition to the xferMachine
     QObject::connect(setupReadPresetsState, SIGNAL(entered()), this, SLOT(setupReadPresetXfer_entered())); // IN
@@ -1254,6 +1374,19 @@ void DcPresetLib::setupStateMachineHandler()
     wpt = new DcCustomTransition(WriteCompleteSuccessEvent::TYPE,writePresetsCompleteState);
     wpt->setTargetState(presetEdit);
     writePresetsCompleteState->addTransition(wpt);
+
+    wpt = new DcCustomTransition(VerifyWritesEvent::TYPE,writePresetsCompleteState);
+    wpt->setTargetState(xferVerifyState);
+    writePresetsCompleteState->addTransition(wpt);
+
+    QObject::connect(verifyWritesCompleteState, SIGNAL(entered()), this, SLOT(verifyWritesComplete_entered()));
+    wpt = new DcCustomTransition(WriteCompleteSuccessEvent::TYPE,verifyWritesCompleteState);
+    wpt->setTargetState(presetEdit);
+    verifyWritesCompleteState->addTransition(wpt);
+
+    wpt = new DcCustomTransition(RewriteMismatchesEvent::TYPE,verifyWritesCompleteState);
+    wpt->setTargetState(xferOutState);
+    verifyWritesCompleteState->addTransition(wpt);
     
     // Preset Transfer Complete, setup preset edit state
     QObject::connect(presetEdit, SIGNAL(entered()), this, SLOT(presetEdit_entered()));
@@ -1318,7 +1451,7 @@ void DcPresetLib::noDevice_entered()
 //-------------------------------------------------------------------------
 void DcPresetLib::setupReadPresetXfer_entered()
 {
-    if( _dirtyItemsIndex.length() )
+    if( _dirtyRows.count() )
     {
         QMessageBox::StandardButton c = QMessageBox::question( this,"Work List contains modified presets",
             "Would you like to save the Work List before fetching?",QMessageBox::Save | QMessageBox::No | QMessageBox::Abort );
@@ -1341,9 +1474,9 @@ void DcPresetLib::setupReadPresetXfer_entered()
         return;
     }
 
-    _dirtyItemsIndex.clear();
-    ui.deviceList->clear();
-    ui.workList->clear();
+    _dirtyRows.clear();
+    _deviceListModel->clear();
+    _workListModel->clear();
     _workListDataDeviceUid = 0;
 
     _xferInMachine.reset(false);
@@ -1365,9 +1498,13 @@ void DcPresetLib::setupReadPresetXfer_entered()
     QObject::connect(&_midiIn, &DcMidiIn::dataIn, &_xferInMachine, &DcXferMachine::replySlotForDataIn);
 
     _xferInMachine.setProgressDialog(_iodlg);
+    _xferInMachine.setCheckpointPath(QDir::toNativeSeparators(_dataPath + "fetch.ckpt"));
 
     _xferInMachine.go(&_devDetails);
 
+    // Pick up where an interrupted fetch for this device left off
+    _xferInMachine.resume();
+
     DCLOG() << "Reading presets";
 
     // Signal the state machine to begin
@@ -1380,15 +1517,17 @@ void DcPresetLib::setupWritePresetXfer_entered()
     // backup the work list
     backupWorklist();
 
+    _verifyPass = 0;
     _xferOutMachine.reset(true);
 
-    // Get the number of dirty presets
-    int presetCount = _dirtyItemsIndex.length();
+    // Get the dirty presets
+    QList<int> dirtyRows = _dirtyRows.rows();
+    int presetCount = dirtyRows.length();
 
 
     for (int idx = 0; idx < presetCount; idx++)
     {
-        int pid = _dirtyItemsIndex.at(idx);
+        int pid = dirtyRows.at(idx);
         DcMidiData md = _workListData.at(pid);
         if(md.contains("F0 00 01 55 XX XX 62 XX XX 47 F7"))
         {
@@ -1413,6 +1552,7 @@ void DcPresetLib::setupWritePresetXfer_entered()
     
     _xferOutMachine.setProgressDialog(_iodlg);
     _xferOutMachine.go(&_devDetails);
+    _xferOutMachine.resume();
     
     DCLOG() << "Writing presets: safemode = " + QString(_midiOut.isSafeMode() ? "ENABLED" : "DISABLED");
 
@@ -1465,7 +1605,7 @@ void DcPresetLib::on_actionMove_triggered()
         MoveDialog* m = new MoveDialog(this);
         m->setModal(true);
         m->setDestinations(presetListToBankPatchName(_workListData));
-        m->setTargetPreset(ui.workList->item(presetA_row)->text());
+        m->setTargetPreset(_workListModel->label(presetA_row));
         
         if(QDialog::Accepted ==  m->exec())
         {
@@ -1490,16 +1630,16 @@ void DcPresetLib::on_actionMove_triggered()
                 presetA.set14bit(_devDetails.PresetNumberOffset,presetB_id);
                 _workListData.replace(presetA_row,presetB_data);
                 _workListData.replace(presetB_row,presetA);
+                worklistRowsChanged(QList<int>() << presetA_row << presetB_row);
             }
             else
             {
                 // Replace preset B with preset A
                 presetA.set14bit(_devDetails.PresetNumberOffset,presetB_id); 
                 _workListData.replace(presetB_row,presetA);
-                _dirtyItemsIndex.append(presetB_row);
+                worklistRowsChanged(QList<int>() << presetB_row);
             }
             
-            checkSyncState();
             _machine.postEvent(new WorkListDirtyEvent());
         }
 
@@ -1548,7 +1688,7 @@ void DcPresetLib::on_actionRename_triggered()
 
                 _workListData.replace(row,md);
 
-                checkSyncState();
+                worklistRowsChanged(QList<int>() << row);
 
 
                 // Move the state machine to the unsynchronized/dirty state
@@ -1577,7 +1717,7 @@ void DcPresetLib::renameItemInWorklist(int row,const QString& newName)
             md.replace(_devDetails.PresetNameOffset,_devDetails.PresetNameLen,ba);
             updatePresetChecksum(md);
             _workListData.replace(row,md);
-            checkSyncState();
+            worklistRowsChanged(QList<int>() << row);
             // Move the state machine to the unsynchronized/dirty state
             _machine.postEvent(new WorkListDirtyEvent());
         }
@@ -1677,23 +1817,213 @@ void DcPresetLib::on_workList_itemDoubleClicked()
 //-------------------------------------------------------------------------
 void DcPresetLib::drawWorklist()
 {
-    // Update the names in the work list
-    QStringList names = presetListToBankPatchName(_workListData);
+    // Re-read the work list, the labels are rebuilt as rows are shown
+    _workListModel->reset();
 
-    // Update the name list 
-    ui.workList->clear();
-    ui.workList->addItems(names);
-    
-    // Redraw the modified items
-    for (int i = 0; i < _dirtyItemsIndex.size(); ++i)
+    updateWorklistSearch();
+}
+
+//-------------------------------------------------------------------------
+QString DcPresetLib::worklistRowToolTip( int row )
+{
+    if(row >= _deviceListData.length() || row >= _workListData.length())
     {
-        int ridx = _dirtyItemsIndex.at(i);
-        
-        // Indicate the list is modified
-        QFont font = ui.workList->item(ridx)->font();
-        font.setItalic(true);
-        ui.workList->item(ridx)->setFont(font);
-        ui.workList->item(ridx)->setForeground(Qt::red);
+        return QString();
+    }
+
+    // Show what changed since the fetch
+    const DcMidiData& before = _deviceListData.at(row);
+    const DcMidiData& after = _workListData.at(row);
+    DcPresetDelta delta = DcPresetDiff::compare(before,after);
+    QStringList lines = DcPresetDiff::describe(delta,before,after);
+    return DcPresetDiff::summary(delta) + "\n" + lines.mid(0,8).join("\n");
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::worklistRowsChanged( const QList<int>& rows )
+{
+    foreach(int row,rows)
+    {
+        _dirtyRows.workRowChanged(row);
+        if(row >= 0 && row < _workListData.length())
+        {
+            DcMidiData md = _workListData.at(row);
+            _worklistSearch.set(row,getPresetName(md) + " " + getEffectType(md));
+        }
+    }
+    _workListModel->rowsChanged(rows);
+    applyWorklistFilter();
+    postSyncState();
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::updateWorklistSearch()
+{
+    for (int row = 0; row < _workListData.length(); row++)
+    {
+        DcMidiData md = _workListData.at(row);
+        _worklistSearch.set(row,getPresetName(md) + " " + getEffectType(md));
+    }
+    _worklistSearch.truncate(_workListData.length());
+
+    applyWorklistFilter();
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::applyWorklistFilter()
+{
+    QString text = ui.workListFilter->text();
+    int rowCount = ui.workList->count();
+
+    if(text.trimmed().isEmpty())
+    {
+        for (int row = 0; row < rowCount; row++)
+        {
+            ui.workList->setRowHidden(row,false);
+        }
+        return;
+    }
+
+    QList<DcTrigramIndex::Match> matches = _worklistSearch.search(text,rowCount);
+    QVector<bool> show(rowCount,false);
+    foreach(const DcTrigramIndex::Match& m,matches)
+    {
+        if(m.Id < rowCount)
+        {
+            show[m.Id] = true;
+        }
+    }
+
+    for (int row = 0; row < rowCount; row++)
+    {
+        ui.workList->setRowHidden(row,!show.at(row));
+    }
+
+    if(matches.length() && matches.first().Id < rowCount)
+    {
+        ui.workList->scrollTo(_workListModel->index(matches.first().Id));
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::on_workListFilter_textChanged( const QString& /*text*/ )
+{
+    applyWorklistFilter();
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_find( DcConArgs args )
+{
+    QStringList words;
+    for (int idx = 1; idx <= args.argCount(); idx++)
+    {
+        words << args.at(idx).toString();
+    }
+    QString text = words.join(" ");
+    if(text.isEmpty())
+    {
+        *_con << "usage: find <text>\n";
+        return;
+    }
+
+    QElapsedTimer t;
+    t.start();
+    QList<DcTrigramIndex::Match> matches = _worklistSearch.search(text,20);
+    qint64 wlNs = t.nsecsElapsed();
+
+    *_con << "work list:\n";
+    foreach(const DcTrigramIndex::Match& m,matches)
+    {
+        if(m.Id < _workListData.length())
+        {
+            DcMidiData md = _workListData.at(m.Id);
+            *_con << "  " << presetToBankPatchName(md) << " (" << getEffectType(md) << ") "
+                  << QString::number(m.Score,'f',2) << "\n";
+        }
+    }
+
+    initPresetLibrary();
+    t.restart();
+    QList<DcPresetIndexHit> hits = _presetIndex.fuzzyFind(text,20);
+    qint64 libNs = t.nsecsElapsed();
+
+    *_con << "library:\n";
+    foreach(const DcPresetIndexHit& h,hits)
+    {
+        *_con << "  " << h.Entry.Location << " " << h.Entry.Name << " (" << h.Entry.EffectType << ", " << h.Entry.Device
+              << ") x" << h.Copies << " " << h.Path << "\n";
+    }
+    *_con << "searched " << _worklistSearch.size() << " work list presets in " << QString::number(wlNs/1000.0,'f',1)
+          << " us and " << _presetIndex.presetCount() << " library presets in " << QString::number(libNs/1000.0,'f',1)
+          << " us, 'lib scan' refreshes the library\n";
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_diff( DcConArgs args )
+{
+    QList<DcMidiData> before = _deviceListData.toList();
+    QList<DcMidiData> after = _workListData.toList();
+    QString what = "device list -> work list";
+
+    bool isRow = false;
+    int row = args.first("").toString().toInt(&isRow);
+
+    if(args.argCount() >= 1 && !isRow)
+    {
+        // Files are compared against the work list, or against each other
+        QString fileA = args.first().toString();
+        before.clear();
+        if(!loadPresetBinary(fileA,before))
+        {
+            *_con << "Failed to load " << fileA << "\n";
+            return;
+        }
+        what = fileA + " -> work list";
+
+        if(args.argCount() >= 2)
+        {
+            QString fileB = args.second().toString();
+            after.clear();
+            if(!loadPresetBinary(fileB,after))
+            {
+                *_con << "Failed to load " << fileB << "\n";
+                return;
+            }
+            what = fileA + " -> " + fileB;
+        }
+    }
+
+    if(isRow)
+    {
+        if(row < 0 || row >= qMin(before.length(),after.length()))
+        {
+            *_con << "usage: diff [<row> | <file> [<file>]]\n";
+            return;
+        }
+        DcPresetDelta delta = DcPresetDiff::compare(before.at(row),after.at(row));
+        *_con << presetToBankPatchName(after[row]) << ": " << DcPresetDiff::summary(delta) << "\n";
+        foreach(const QString& line,DcPresetDiff::describe(delta,before.at(row),after.at(row)))
+        {
+            *_con << "  " << line << "\n";
+        }
+        return;
+    }
+
+    QElapsedTimer t;
+    t.start();
+    DcBundleDiff diff = DcPresetDiff::compare(before,after);
+    qint64 us = t.nsecsElapsed() / 1000;
+
+    *_con << what << ": " << diff.Changed.length() << " of " << diff.Compared << " presets changed";
+    if(diff.Added || diff.Removed)
+    {
+        *_con << ", " << diff.Added << " added, " << diff.Removed << " removed";
+    }
+    *_con << " (" << us << " us)\n";
+
+    foreach(const DcPresetDelta& delta,diff.Changed)
+    {
+        *_con << "  " << presetToBankPatchName(after[delta.Row]) << ": " << DcPresetDiff::summary(delta) << "\n";
     }
 }
 
@@ -1706,18 +2036,124 @@ void DcPresetLib::writePresetsComplete_entered()
 
     // Update the device list with the data that was transfered.
     QList<DcMidiData> mdl = _xferOutMachine.getCmdsWritten();
+
+    if( _verifyWrites && mdl.length() )
+    {
+        // Read back just the written presets before trusting the ACKs
+        _verifyPending = mdl;
+        _xferVerifyMachine.reset(false);
+
+        DcMidiData cmd;
+        for (int idx = 0; idx < mdl.length(); idx++)
+        {
+            cmd.setData(_devDetails.PresetReadTemplate,getPresetNumber(mdl.at(idx)));
+            _xferVerifyMachine.append(cmd);
+        }
+
+        QObject::connect(&_midiIn, &DcMidiIn::dataIn, &_xferVerifyMachine, &DcXferMachine::replySlotForDataIn);
+        _xferVerifyMachine.setProgressDialog(_iodlg);
+        _xferVerifyMachine.go(&_devDetails);
+        _iodlg->setMessage("Verifying written presets");
+
+        DCLOG() << "Verifying " << mdl.length() << " written presets";
+        _machine.postEvent(new VerifyWritesEvent());
+        return;
+    }
+
     int presetCount = mdl.length();
     for (int idx = 0; idx < presetCount; idx++)
     {
         DcMidiData md = mdl.at(idx);
         int pid = getPresetNumber(md);
-        _deviceListData[pid] = md;
+        _deviceListData.replace(pid,md);
     }
 
     updateWorkListFromDeviceList();
     _machine.postEvent(new WriteCompleteSuccessEvent());
 }
 
+//-------------------------------------------------------------------------
+void DcPresetLib::verifyWritesComplete_entered()
+{
+    clearMidiInConnections();
+
+    QHash<int,DcMidiData> readBack;
+    foreach( const DcMidiData& md, _xferVerifyMachine.getDataList() )
+    {
+        readBack.insert(getPresetNumber(md),md);
+    }
+
+    QList<DcMidiData> mismatched;
+    foreach( const DcMidiData& md, _verifyPending )
+    {
+        int pid = getPresetNumber(md);
+        if( readbackMatches(md,readBack.value(pid)) )
+        {
+            _deviceListData.replace(pid,md);
+        }
+        else
+        {
+            DCLOG() << "Verify failed for preset " << presetNumberToBankNum(pid);
+            mismatched.append(md);
+        }
+    }
+    _verifyPending.clear();
+
+    if( mismatched.length() && _verifyPass++ < kMaxVerifyRewrites )
+    {
+        DCLOG() << "Rewriting " << mismatched.length() << " presets that failed verification";
+
+        _xferOutMachine.reset(true);
+        for (int idx = 0; idx < mismatched.length(); idx++)
+        {
+            _xferOutMachine.append(mismatched[idx]);
+        }
+
+        QObject::connect(&_midiIn, &DcMidiIn::dataIn, &_xferOutMachine, &DcXferMachine::replySlotForDataOut);
+        _xferOutMachine.setProgressDialog(_iodlg);
+        _xferOutMachine.go(&_devDetails);
+        _iodlg->setMessage("Rewriting presets that failed verification");
+
+        _machine.postEvent(new RewriteMismatchesEvent());
+        return;
+    }
+
+    // Only the device list takes the verified presets, the work list keeps
+    // every edit so mismatches still show as not in sync
+    _deviceListModel->reset();
+    checkSyncState();
+
+    if( mismatched.length() )
+    {
+        QMessageBox::warning(this,"Verify Failed",
+            QString("%1 presets did not read back as written. Check the MIDI interface and sync again.").arg(mismatched.length()));
+    }
+
+    _machine.postEvent(new WriteCompleteSuccessEvent());
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetLib::readbackMatches( const DcMidiData &written, const DcMidiData &readback )
+{
+    if( readback.length() != written.length() || readback.length() < _devDetails.PresetSize )
+    {
+        return false;
+    }
+
+    if( getPresetNumber(readback) != getPresetNumber(written) )
+    {
+        return false;
+    }
+
+    if( readback.at(_devDetails.PresetChkSumOffset) != written.at(_devDetails.PresetChkSumOffset) )
+    {
+        return false;
+    }
+
+    return readback.toByteArray().mid(_devDetails.PresetNameOffset,_devDetails.PresetNameLen) ==
+           written.toByteArray().mid(_devDetails.PresetNameOffset,_devDetails.PresetNameLen);
+}
+
 //-------------------------------------------------------------------------
 void DcPresetLib::readPresetsComplete_entered()
 {
@@ -1787,10 +2223,10 @@ bool DcPresetLib::isBankPresetString( QString s )
 
 
 //-------------------------------------------------------------------------
-QStringList DcPresetLib::presetListToBankPatchName(QList<DcMidiData>& listData)
+QStringList DcPresetLib::presetListToBankPatchName(const DcPresetBank& listData)
 {
     QStringList names;
-    for (int i = 0; i < listData.size(); ++i) 
+    for (int i = 0; i < listData.length(); ++i) 
     {
         DcMidiData presetData = listData.at(i);
 
@@ -1852,7 +2288,7 @@ void DcPresetLib::on_actionLoad_One_triggered()
         fileName = filenames.first();
 #else
     QString fileName = QFileDialog::getOpenFileName(this,
-            tr("Open Presets"), lastOpened, tr("Preset File (*.syx)"));
+            tr("Open Presets"), lastOpened, tr("Preset File (*.syx *.syz)"));
 #endif
 
     if(!fileName.isEmpty())
@@ -1864,30 +2300,38 @@ void DcPresetLib::on_actionLoad_One_triggered()
         }
         else
         {
-            // Get the preset number from the occupant of cur_idx in the worklist
-            int presetNum = _workListData[cur_idx].get14bit(_devDetails.PresetNumberOffset,-1);
-            if(presetNum == -1)
-            {
-                Q_ASSERT(presetNum != -1);
+            replaceWorklistPreset(cur_idx,md);
+        }
 
-                // Something is wrong with the preset in this location, just use the slot number,
-                // it will probably be the same anyway.  THe above code is in place if we ever support
-                // presets list that do not start at zero.
-                presetNum = cur_idx;
-            }
+        settings.setValue("lastSinglePreset",fileName);
+    }
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetLib::replaceWorklistPreset( int row,DcMidiData md )
+{
+    // Get the preset number from the occupant of row in the worklist
+    int presetNum = _workListData.number(row);
+    if(presetNum == -1)
+    {
+        Q_ASSERT(presetNum != -1);
 
-            md.set14bit(_devDetails.PresetNumberOffset,presetNum);
+        // Something is wrong with the preset in this location, just use the slot number,
+        // it will probably be the same anyway.  THe above code is in place if we ever support
+        // presets list that do not start at zero.
+        presetNum = row;
+    }
 
-            // Was this preset a change of the work-list?
-            if(_workListData[cur_idx] != md)
-            {
-                _workListData[cur_idx] = md;
-                checkSyncState();
-            }
-        }
+    md.set14bit(_devDetails.PresetNumberOffset,presetNum);
 
-        settings.setValue("lastSinglePreset",fileName);
+    // Was this preset a change of the work-list?
+    if(_workListData.at(row) != md)
+    {
+        _workListData.replace(row,md);
+        worklistRowsChanged(QList<int>() << row);
+        return true;
     }
+    return false;
 }
 
 //-------------------------------------------------------------------------
@@ -1947,7 +2391,7 @@ void DcPresetLib::on_actionSave_triggered()
 
     // Save the full working buffer
     QString fileName = QFileDialog::getSaveFileName(this,
-        tr("Save Presets"), lastSave, tr("Preset File(*.syx)"));
+        tr("Save Presets"), lastSave, tr("Preset File(*.syx);;Compressed Preset File (*.syz)"));
 
     if(!fileName.isEmpty())
     {
@@ -1970,7 +2414,7 @@ void DcPresetLib::on_actionOpen_triggered()
     if(!fileName.isEmpty())
     {
         
-        QList<DcMidiData> newPresetList;
+        DcPresetBank newPresetList;
         if(!loadPresetBinary(fileName,newPresetList))
         {
             dispErrorMsgBox();
@@ -2003,101 +2447,175 @@ bool DcPresetLib::loadPresetBinary(const QString &fileName,QList<DcMidiData>& da
 { 
     _lastErrorMsgStr.clear();
 
-    QFile file(fileName); 
-
-    if (!file.open(QIODevice::ReadOnly)) 
-    { 
-        _lastErrorMsg << "Unable to open the file:\n" << fileName;
-        return false; 
-    } 
-    
-    QDataStream in(&file); 
-
-    // Check the file size, is it at least one preset in length
-    if(file.size() < _devDetails.PresetSize*_devDetails.PresetCount)
-    {
-       _lastErrorMsg << "File does not contain enough presets.";
-       return false;
-    }
-
-    // Load one preset in, see if it matches the current Manufacture
-    QByteArray ba(_devDetails.PresetSize,'\0');
-
-    while(ba.length() == in.readRawData(ba.data(),ba.length()))
+    // Backup manifests are rebuilt from the backup store
+    if(DcBackupStore::isManifest(fileName))
     {
-        DcMidiData md(ba);
-
-        if(!md.contains(_devDetails.PresetWriteHdr))
+        QList<DcMidiData> presets;
+        if(!_backupStore.restore(fileName,presets))
         {
-            _lastErrorMsg << "File does not contain " << _devDetails.Name << " presets";
+            _lastErrorMsg << _backupStore.getLastErrorString();
             return false;
         }
+        return appendCheckedPresets(presets,dataList);
+    }
 
-        // Filter out any NAK commands
-        if(md.match("47F7") && md.length() < 100)
+    // Compressed bundles are inflated a frame at a time
+    if(DcPresetArchive::isArchive(fileName))
+    {
+        QList<DcMidiData> presets;
+        QString errorMsg;
+        if(!DcPresetArchive::load(fileName,presets,errorMsg))
         {
-            continue;
+            _lastErrorMsg << errorMsg;
+            return false;
         }
-
-
-        // This is a good preset file
-        dataList.append(md);
+        return appendCheckedPresets(presets,dataList);
     }
 
-    file.close();
-
+    // Raw bundles are split and checked by the same rules as the bank
+    DcPresetBank bank;
+    if(!loadPresetBinary(fileName,bank))
+    {
+        return false;
+    }
+    dataList.append(bank.toList());
     return true; 
 }
 
 //-------------------------------------------------------------------------
-// Load one preset
-bool DcPresetLib::loadPresetBinary( const QString &fileName,DcMidiData& md )
+bool DcPresetLib::loadPresetBinary( const QString &fileName,DcPresetBank& bank )
 {
     _lastErrorMsgStr.clear();
-    QFile file(fileName); 
 
-    if (!file.open(QIODevice::ReadOnly)) 
-    { 
-        _lastErrorMsg << "Unable to open the file:\n" << fileName;
+    if(DcBackupStore::isManifest(fileName) || DcPresetArchive::isArchive(fileName))
+    {
+        QList<DcMidiData> presets;
+        if(!loadPresetBinary(fileName,presets))
+        {
+            return false;
+        }
+        if(presets.length() < _devDetails.PresetCount)
+        {
+           _lastErrorMsg << "File does not contain enough presets.";
+           return false;
+        }
+        bank = presets;
+        return true;
+    }
+
+    // Check the file size, is it at least one preset in length
+    if(QFileInfo(fileName).size() < _devDetails.PresetSize*_devDetails.PresetCount)
+    {
+       _lastErrorMsg << "File does not contain enough presets.";
+       return false;
+    }
+
+    // Raw bundles go from the mapped file straight into the bank slots
+    QString errorMsg;
+    if(!bank.load(fileName,_devDetails.PresetWriteHdr.toByteArray(),_devDetails.PresetSize,errorMsg))
+    {
+        _lastErrorMsg << errorMsg;
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// Load one preset
+bool DcPresetLib::loadPresetBinary( const QString &fileName,DcMidiData& md )
+{
+    _lastErrorMsgStr.clear();
+
+    if(DcPresetArchive::isArchive(fileName) || DcBackupStore::isManifest(fileName))
+    {
+        QList<DcMidiData> presets;
+        if(!loadPresetBinary(fileName,presets))
+        {
+            return false;
+        }
+        if(presets.length() != 1)
+        {
+            _lastErrorMsg << "File has more than one preset.";
+            return false;
+        }
+        md = presets.first();
+        return true;
+    }
+
+    DcPresetBundle bundle;
+
+    if(!bundle.open(fileName))
+    {
+        _lastErrorMsg << bundle.getLastErrorString();
         return false; 
     } 
 
-    QDataStream in(&file); 
-
     // Check the file size, is it at least one preset in length
-    if(file.size() < _devDetails.PresetSize)
+    if(bundle.size() < _devDetails.PresetSize)
     {
         _lastErrorMsg << "Preset file is too small.";
         return false;
     }
 
     // Is the file too big?
-    if(file.size() > _devDetails.PresetSize)
+    if(bundle.size() > _devDetails.PresetSize)
     {
         _lastErrorMsg << "File has more than one preset.";
         return false;
     }
 
-    QByteArray ba(_devDetails.PresetSize,'\0');
-    
-    in.readRawData(ba.data(),ba.length());
-
-     md = ba;
+    bundle.splitFixed(_devDetails.PresetSize);
 
-     if(!md.contains(_devDetails.PresetWriteHdr))
-     {
-         _lastErrorMsg << "File does not contain " << _devDetails.Name << " presets";
-         return false;
-     }
+    if(!bundle.hasHeader(0,_devDetails.PresetWriteHdr.toByteArray()))
+    {
+        _lastErrorMsg << "File does not contain " << _devDetails.Name << " presets";
+        return false;
+    }
 
-    file.close();
+    md = bundle.copy(0);
 
     return true; 
 }
 
+//-------------------------------------------------------------------------
+bool DcPresetLib::appendCheckedPresets( const QList<DcMidiData>& presets,QList<DcMidiData>& dataList )
+{
+    QByteArray hdr = _devDetails.PresetWriteHdr.toByteArray();
+    if(presets.isEmpty())
+    {
+        _lastErrorMsg << "File does not contain any presets.";
+        return false;
+    }
+
+    // Same rules as raw bundles, every preset is whole and for this device
+    foreach(const DcMidiData& md,presets)
+    {
+        if(md.length() != _devDetails.PresetSize || !md.toByteArray().startsWith(hdr))
+        {
+            _lastErrorMsg << "File does not contain " << _devDetails.Name << " presets";
+            return false;
+        }
+    }
+    dataList.append(presets);
+    return true;
+}
+
 bool DcPresetLib::savePresetBinary(const QString &fileName,const QList<DcMidiData>& dataList)
 { 
     _lastErrorMsgStr.clear();
+
+    if(fileName.endsWith(DcPresetArchive::kSuffix,Qt::CaseInsensitive))
+    {
+        QString errorMsg;
+        if(!DcPresetArchive::save(fileName,dataList,_devDetails.Name,_devDetails.FwVersion,errorMsg))
+        {
+            _lastErrorMsg << errorMsg;
+            return false;
+        }
+        DCLOG() << "Presets saved to: " << fileName;
+        return true;
+    }
+
     QFile file(fileName); 
 
     if (!file.open(QIODevice::WriteOnly)) 
@@ -2119,6 +2637,26 @@ bool DcPresetLib::savePresetBinary(const QString &fileName,const QList<DcMidiDat
     return true; 
 }
 
+//-------------------------------------------------------------------------
+bool DcPresetLib::savePresetBinary( const QString &fileName,const DcPresetBank& bank )
+{
+    _lastErrorMsgStr.clear();
+
+    if(fileName.endsWith(DcPresetArchive::kSuffix,Qt::CaseInsensitive))
+    {
+        return savePresetBinary(fileName,bank.toList());
+    }
+
+    QString errorMsg;
+    if(!bank.save(fileName,errorMsg))
+    {
+        _lastErrorMsg << errorMsg;
+        return false;
+    }
+    DCLOG() << "Presets saved to: " << fileName;
+    return true;
+}
+
 //-------------------------------------------------------------------------
 bool DcPresetLib::savePresetBinary( const QString &fileName,const DcMidiData& md )
 {
@@ -2143,13 +2681,13 @@ void DcPresetLib::backupDeviceList()
 {
     if(_backupEnabled && _deviceListData.length() == _devDetails.PresetCount)
     {
-        QString t = QTime::currentTime().toString("'_'hhmmss'.syx'");
+        QString t = QTime::currentTime().toString("'_'hhmmss");
         QString filename = QDate::currentDate().toString("'_dl_'yy_MM_dd");
-        QString fullPath = _devlistBackupPath + _devDetails.Name.toLower() + "_" + filename + t;
+        QString basePath = _devlistBackupPath + _devDetails.Name.toLower() + "_" + filename + t;
 
         if(QDir().exists(_devlistBackupPath))
         {
-            savePresetBinary(fullPath,_deviceListData);  
+            writeBackup(basePath,_deviceListData.toList());  
         }
     }
 
@@ -2159,35 +2697,62 @@ void DcPresetLib::backupWorklist()
     // Only backup full preset files
     if(_backupEnabled && (_workListData.length() == _devDetails.PresetCount))
     {
-        QString t = QTime::currentTime().toString("'_'hhmmss'.syx'");
+        QString t = QTime::currentTime().toString("'_'hhmmss");
         QString filename = QDate::currentDate().toString("'_wl_'yy_MM_dd");
-        QString fullPath = _worklistBackupPath + _devDetails.Name.toLower() + "_" + filename + t;
+        QString basePath = _worklistBackupPath + _devDetails.Name.toLower() + "_" + filename + t;
 
         if(QDir().exists(_worklistBackupPath))
         {
-            savePresetBinary(fullPath,_workListData);  
+            writeBackup(basePath,_workListData.toList());  
         }
     }
 }
 
 //-------------------------------------------------------------------------
-bool DcPresetLib::checkSyncState()
+bool DcPresetLib::writeBackup( const QString& basePath,const QList<DcMidiData>& dataList )
 {
-    _dirtyItemsIndex.clear();
+    DcBackupWriter::Format fmt = DcBackupWriter::Manifest;
+    if(!_backupDedup)
+    {
+        fmt = _backupCompress ? DcBackupWriter::Compressed : DcBackupWriter::Raw;
+    }
 
-    // compare the work list with the device list and update the dirty list
-    int len = qMin(_workListData.length(),_deviceListData.length());
-    for (int i = 0; i < len; ++i) 
+    // Written on the backup thread, results come back through backupWritten/backupFailed
+    bool queued = _backupWriter.enqueue(basePath,dataList,fmt,_devDetails.Name,_devDetails.FwVersion,_devDetails.PresetNumberOffset);
+    if(!queued)
     {
-        if(_workListData.at(i).toByteArray() != _deviceListData.at(i).toByteArray())
-        {
-            _dirtyItemsIndex.append(i);
-        }
+        DCLOG() << "Backup skipped, no change since the last backup: " << basePath;
     }
+    return queued;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::backupWritten( const QString& path )
+{
+    DCLOG() << "Backup saved to: " << path;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::backupFailed( const QString& path,const QString& error )
+{
+    DCLOG() << "Backup failed: " << path << " - " << error;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetLib::checkSyncState()
+{
+    // compare the work list with the device list and update the dirty list
+    _dirtyRows.rescan();
 
     drawWorklist();
+    return postSyncState();
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetLib::postSyncState()
+{
     bool isInSync = true;
-    if(_dirtyItemsIndex.length() > 0)
+    if(_dirtyRows.count() > 0)
     {
         _machine.postEvent(new WorkListIsDifferentThanDeviceListEvent());
         isInSync  = false;
@@ -2282,7 +2847,7 @@ QString  DcPresetLib::execOpenDialog( QString lastOpened )
         fileName = filenames.first();
 #else
     QString fileName = QFileDialog::getOpenFileName(this,
-        tr("Open Presets"), lastOpened, tr("Preset File (*.syx)"));
+        tr("Open Presets"), lastOpened, tr("Preset File (*.syx *.syz);;Backup Manifest (*.dcm)"));
 #endif
 
     return fileName;
@@ -2305,115 +2870,32 @@ void DcPresetLib::updateWorkListFromDeviceList()
 {
     // Reset the preset work list cache
     _workListData.clear();
-    _dirtyItemsIndex.clear();
+    _dirtyRows.clear();
 
     _workListData = _deviceListData;
-    QStringList names = presetListToBankPatchName(_deviceListData);
+    _dirtyRows.rescan();
 
     // Update preset displays
-    ui.deviceList->clear();
-    ui.deviceList->addItems(names);
-    ui.workList->clear();
-    ui.workList->addItems(names);
+    _deviceListModel->reset();
+    _workListModel->reset();
+
+    updateWorklistSearch();
 }
 
 //-------------------------------------------------------------------------
 // Experimental 
 bool DcPresetLib::loadSysexFile( const QString &fileName,QList<DcMidiData>& dataList, QList<DcMidiData>* pRejectDataList /* = 0 */)
 {
-    bool result = true;
     _lastErrorMsgStr.clear();
 
-    QFile file(fileName); 
-
-    if (!file.open(QIODevice::ReadOnly)) 
-    { 
-        _lastErrorMsg << "Unable to open the file:\n" << fileName;
-        return false; 
-    } 
-
-    QDataStream in(&file); 
-
-    // Load one preset in, see if it matches the current Manufacture
-    unsigned char byte;
-    DcMidiData md;
-    bool lookForStatusByte = true;
-
-    while(1 == in.readRawData((char*)&byte,1))
-    {
-        if(lookForStatusByte)
-        {
-            if(byte == 0xF0)
-            {
-                md.clear();
-                md.appendNum(byte);
-                lookForStatusByte = false;
-            }
-        }
-        else
-        {
-            if(byte == 0xF7)
-            {
-                md.appendNum(byte);
-                
-                if(0 == pRejectDataList) 
-                {
-                    dataList.append(md);
-                } 
-                else 
-                {
-                    bool reject = false;
-                    // Apply the filter
-                    foreach(DcMidiData rejectMd,*pRejectDataList)
-                    {
-                        if(md.contains(rejectMd)) 
-                        {
-                            reject = true;
-                            break;
-                        }
-                    }
-
-                    if(!reject)
-                    {
-                        dataList.append(md);
-                    }
-                }
-                
-                lookForStatusByte = true;
-            }
-            else if(byte == 0xF0)
-            {
-                // Terminate the MIDI stream
-                md.appendNum(0xF7);
-
-                if(0 == pRejectDataList) 
-                {
-                    dataList.append(md);
-                } 
-                else if(!pRejectDataList->contains(md)) 
-                {
-                    dataList.append(md);
-                }
-                
-                md.clear();
-                md.appendNum(0xF0);
-            }
-            else
-            {
-                md.appendNum(byte);
-            }
-        }
-    }
-
-    if(dataList.count() == 0)
+    QString errorMsg;
+    if(!DcSysexScanner::loadFile(fileName,dataList,pRejectDataList,errorMsg))
     {
-        _lastErrorMsg << fileName << " did not contain any MIDI data\n";
-        result = false;
+        _lastErrorMsg << errorMsg;
+        return false;
     }
 
-    file.close();
-
-    return result ; 
+    return true; 
 }
 
 //-------------------------------------------------------------------------
@@ -2799,11 +3281,23 @@ void DcPresetLib::setupConsole()
     _con->addCmd( "ren!",this,SLOT( conCmd_RenameItemInWorklist( DcConArgs ) ),"[<row> <name>] - rename preset at given row number with given name. at 'row' with given 'name.' If no args, then rename all with randome names!!!" );
     _con->addCmd( "fastfetch",this,SLOT( conCmd_enableFastFetch( DcConArgs ) ),"<on|off> - controls the preset fetch size." );
     _con->addCmd( "sm.trace",this,SLOT( conCmd_smtrace( DcConArgs ) ),"display state machine history" );
+    _con->addCmd( "verifywrites",this,SLOT( conCmd_verifyWrites( DcConArgs ) ),"<on|off> - read back written presets after a sync and rewrite any that don't match" );
+    _con->addCmd( "xferstats",this,SLOT( conCmd_xferStats( DcConArgs ) ),"Display latency, retry and throughput statistics for the last fetch and write" );
+    _con->addCmd( "backup",this,SLOT( conCmd_backup( DcConArgs ) ),"dedup <on|off> | fsync <0|1|2> | migrate [delete] | restore <manifest.dcm> <bundle.syx> - manage the deduplicating backup store and how backups are committed to disk" );
+    _con->addCmd( "archive",this,SLOT( conCmd_archive( DcConArgs ) ),"pack <in.syx> <out.syz> | unpack <in.syz> <out.syx> | stats [folder] | compress <on|off> - compressed preset files; stats reports ratio and load times for the backups" );
+    _con->addCmd( "diff",this,SLOT( conCmd_diff( DcConArgs ) ),"[<row> | <file> [<file>]] - show what changed between the device list and the work list, a backup and the work list, or two backups. A row shows each changed field" );
+    _con->addCmd( "import",this,SLOT( conCmd_import( DcConArgs ) ),"<folder or file> [lib] - read and classify every .syx and .syz file in parallel, then merge the valid presets into the work list by preset number, or add the files to the preset library" );
+    _con->addCmd( "dupes",this,SLOT( conCmd_dupes( DcConArgs ) ),"<wl | lib | folder> [maxdiff] [<out folder>] - report presets whose parameters are identical, or differ in at most maxdiff bytes (default 8, 0 for exact only), ignoring names. With an out folder, writes a copy of every bundle with the duplicates removed" );
+    _con->addCmd( "portscan",this,SLOT( conCmd_portScan( DcConArgs ) ),"[on|off] - list the supported devices found on every MIDI port pair, or turn automatic port discovery on or off for when the saved ports don't answer" );
+    _con->addCmd( "query",this,SLOT( conCmd_query( DcConArgs ) ),"<wl | dl | lib | folder> [<field><op><value> ...] [count | hist <field> | stats <field> | list [n]] - filter and summarize presets from every device. Fields are device, number, type, checksum, name or b<offset> for a raw preset byte; ops are = != < > <= >= and ~ (name contains). Example: query lib device=bigsky type=shimmer b120>50 hist type" );
+    _con->addCmd( "find",this,SLOT( conCmd_find( DcConArgs ) ),"<text> - fuzzy search preset names and effect types in the work list and the preset library" );
+    _con->addCmd( "lib",this,SLOT( conCmd_library( DcConArgs ) ),"scan | add <dir> | <text> - search the preset library (backups and added folders) by name, effect type, device or location" );
+    _con->addCmd( "multi",this,SLOT( conCmd_multiDevice( DcConArgs ) ),"fetch <in>:<out> [<in>:<out> ...] | write <preset file> <in>:<out> [<in>:<out> ...] - fetch from, or write to, several devices at once. Port numbers are as listed by lsdev." );
 
 
     _con->addCmd("cpsel",this,SLOT(conCmd_cpsel(DcConArgs)),"Copies the selected presets to the specified stating location" );
-    _con->addCmd("exportwl",this,SLOT(conCmd_ExportWorklistPresets(DcConArgs)),"Export the worklist to given the path" );
-    _con->addCmd("exportfile",this,SLOT(conCmd_SplitPresetBundle(DcConArgs)),"<source preset file> [<destination path>] - export each preset found in the provided file." );
+    _con->addCmd("exportwl",this,SLOT(conCmd_ExportWorklistPresets(DcConArgs)),"<path> | cancel - Export the worklist to given the path" );
+    _con->addCmd("exportfile",this,SLOT(conCmd_SplitPresetBundle(DcConArgs)),"<source preset file or folder> [<destination path>] | cancel - export each preset found in the provided file, or in every .syx bundle under the folder. Files are written in the background." );
 
     _con->addCmd("printenv",this,SLOT(conCmd_PrintEnvi(DcConArgs))," print the system environment");
 
@@ -2865,22 +3359,22 @@ void DcPresetLib::conCmd_enableFastFetch( DcConArgs args )
 {
     if(args.noArgs())
     {
-        *_con << (gUseAltPresetSize ? "fastfetch is enabled\n" : "fastfetch is disabled\n");
+        *_con << (_devDetails.Codec.isCompactRead() ? "fastfetch is enabled\n" : "fastfetch is disabled\n");
     }
     else if(!args.firstTruthy())
     {
-        if(gUseAltPresetSize)
+        if(_devDetails.Codec.isCompactRead())
         {
-            gUseAltPresetSize = false;
+            _devDetails.Codec.setCompactRead(false);
             setFamilyDetails(_devDetails);
         }
         *_con << "fastfetch is disabled\n";
     }
     else if(args.firstTruthy())
     {
-        if(!gUseAltPresetSize)
+        if(!_devDetails.Codec.isCompactRead())
         {
-            gUseAltPresetSize = true;
+            _devDetails.Codec.setCompactRead(true);
             setFamilyDetails(_devDetails);
         }
 
@@ -2889,6 +3383,162 @@ void DcPresetLib::conCmd_enableFastFetch( DcConArgs args )
 }
 
 
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_verifyWrites( DcConArgs args )
+{
+    if(!args.noArgs())
+    {
+        _verifyWrites = args.firstTruthy();
+    }
+    *_con << (_verifyWrites ? "verifywrites is enabled\n" : "verifywrites is disabled\n");
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_portScan( DcConArgs args )
+{
+    if(!args.noArgs())
+    {
+        _autoDiscover = args.firstTruthy();
+        *_con << (_autoDiscover ? "port discovery is enabled\n" : "port discovery is disabled\n");
+        return;
+    }
+
+    // Scanning needs every port, including the ones in use.  Detection
+    // reopens the device ports afterwards
+    shutdownMidiIo();
+
+    DcPortScanner scanner;
+    QElapsedTimer t;
+    t.start();
+    QList<DcPortScanner::PortPair> found = scanner.scan();
+    if(found.isEmpty())
+    {
+        *_con << scanner.getLastErrorString() << "\n";
+    }
+    foreach(const DcPortScanner::PortPair& p,found)
+    {
+        *_con << p.Device << " on " << p.InPort << " / " << p.OutPort << " (" << p.LatencyMs << " ms)\n";
+    }
+    *_con << "scan took " << t.elapsed() << " ms, reconnecting to the device\n";
+    _machine.postEvent( new VerifyDeviceConnection() );
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_xferStats( DcConArgs args )
+{
+    Q_UNUSED(args);
+
+    const DcXferStats& in = _xferInMachine.getStats();
+    const DcXferStats& out = _xferOutMachine.getStats();
+
+    *_con << (in.isEmpty() ? QString("No fetch session recorded\n") : in.toString());
+    *_con << (out.isEmpty() ? QString("No write session recorded\n") : out.toString());
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_multiDevice( DcConArgs args )
+{
+    if( _multiSession && _multiSession->isRunning() )
+    {
+        *_con << "A multi-device transfer is already running\n";
+        return;
+    }
+
+    QString op = args.first("").toString();
+    int firstPair = 2;
+    DcMidiDataList_t writeList;
+
+    if( op == "fetch" )
+    {
+        _multiOp = DcDeviceSession::Fetch;
+    }
+    else if( op == "write" )
+    {
+        _multiOp = DcDeviceSession::Write;
+        firstPair = 3;
+        if( !loadPresetBinary( args.second("").toString(),writeList ) )
+        {
+            *_con << _lastErrorMsgStr << "\n";
+            return;
+        }
+    }
+    else
+    {
+        *_con << args.meta("doc") << "\n";
+        return;
+    }
+
+    if( args.argCount() < firstPair )
+    {
+        *_con << "Specify at least one <in>:<out> port pair\n";
+        return;
+    }
+
+    if( !_midiIn.isOpen() )
+    {
+        _midiIn.init();
+        _midiOut.init();
+    }
+    QStringList inNames = _midiIn.getPortNames();
+    QStringList outNames = _midiOut.getPortNames();
+
+    delete _multiSession;
+    _multiSession = new DcMultiDeviceSession( this );
+    _multiSession->setThroughput( _maxMsgSize,_delayPerMsgChunk,_retryBackoff );
+    QObject::connect( _multiSession,&DcMultiDeviceSession::finished,this,&DcPresetLib::multiSessionFinished );
+
+    for( int i = firstPair; i <= args.argCount(); i++ )
+    {
+        QStringList pair = args.at(i).toString().split(':');
+        int in = pair.length() == 2 ? pair.at(0).toInt() : 0;
+        int out = pair.length() == 2 ? pair.at(1).toInt() : 0;
+        if( in < 1 || in > inNames.length() || out < 1 || out > outNames.length() )
+        {
+            *_con << "Invalid port pair: " << args.at(i).toString() << "\n";
+            delete _multiSession;
+            _multiSession = 0;
+            return;
+        }
+        _multiSession->addPortPair( inNames.at(in-1),outNames.at(out-1) );
+    }
+
+    *_con << "Starting " << (_multiOp == DcDeviceSession::Fetch ? "fetch" : "write") << " on "
+          << _multiSession->sessions().length() << " devices\n";
+    _multiSession->start( _multiOp,writeList );
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::multiSessionFinished()
+{
+    *_con << _multiSession->summary();
+
+    if( _multiOp != DcDeviceSession::Fetch )
+    {
+        return;
+    }
+
+    // Store each device's presets the same way a device list backup is stored
+    QString t = QTime::currentTime().toString("'_'hhmmss'.syx'");
+    QString filename = QDate::currentDate().toString("'_dl_'yy_MM_dd");
+    const QList<DcDeviceSession*>& sessions = _multiSession->sessions();
+    for( int i = 0; i < sessions.length(); i++ )
+    {
+        DcDeviceSession* s = sessions.at(i);
+        if( s->succeeded() )
+        {
+            QString fullPath = _devlistBackupPath + s->deviceDetails().Name.toLower() + "_" + QString::number(i+1) + "_" + filename + t;
+            if( savePresetBinary( fullPath,s->getDataList() ) )
+            {
+                *_con << "Saved: " << QDir::toNativeSeparators(fullPath) << "\n";
+            }
+            else
+            {
+                *_con << _lastErrorMsgStr << "\n";
+            }
+        }
+    }
+}
+
 //-------------------------------------------------------------------------
 void DcPresetLib::conCmd_char( DcConArgs args )
 {
@@ -2922,7 +3572,7 @@ void DcPresetLib::conCmd_lswl( DcConArgs args )
     {
         for (int r = 0; r < ui.workList->count() ; r++)
         {
-            *_con << ui.workList->item(r)->text() << "\n";	
+            *_con << ui.workList->rowText(r) << "\n";	
         }
     }
 }
@@ -3212,7 +3862,7 @@ void DcPresetLib::conCmd_ioConfig( DcConArgs args )
 
 void DcPresetLib::copySelectedPresets( QString numAndBank )
 {
-    QList<QListWidgetItem *> itemsToMove = ui.workList->selectedItems();
+    QList<int> itemsToMove = ui.workList->selectedRows();
     
     if(!itemsToMove.count())
     {
@@ -3239,22 +3889,22 @@ void DcPresetLib::copySelectedPresets( QString numAndBank )
 
     // Store all the preset data
     QList<DcMidiData> selectedPresets;
-    foreach(QListWidgetItem* item,itemsToMove)
+    foreach(int idx,itemsToMove)
     {
-        int idx = ui.workList->row(item);
-
         DcMidiData srcPreset = _workListData.at(idx);
         selectedPresets.append(srcPreset);
     }
 
     // Copy the presets
+    QList<int> changedRows;
     foreach(DcMidiData md, selectedPresets)
     {
         md.set14bit(_devDetails.PresetNumberOffset,dstPresetNum++);
+        changedRows.append(dstIdx);
         _workListData.replace(dstIdx++,md);
     }
 
-    checkSyncState();
+    worklistRowsChanged(changedRows);
 }
 
 
@@ -3263,8 +3913,9 @@ void DcPresetLib::initInvalidPresets()
     
     DcMidiData srcPreset = _workListData.at(ui.workList->currentRow());
 
-    // compare the work list with the device list and update the dirty list
+    // Replace the invalid presets and redraw just those rows
     int len = _workListData.length();
+    QList<int> changedRows;
 
     for (int i = 0; i < len; ++i) 
     {
@@ -3273,10 +3924,11 @@ void DcPresetLib::initInvalidPresets()
             int pnum = getPresetNumber(_workListData.at(i));
             srcPreset.set14bit(_devDetails.PresetNumberOffset,pnum);
             _workListData.replace(i,srcPreset);
+            changedRows.append(i);
         }
     }
 
-    checkSyncState();
+    worklistRowsChanged(changedRows);
 }
 
 //-------------------------------------------------------------------------
@@ -3296,21 +3948,24 @@ quint16 DcPresetLib::getPresetNumber( const DcMidiData &preset )
 
 bool DcPresetLib::programSysexFile(QString fileName)
 {
-    QList<DcMidiData> sysexList;
+    DcSysexScanner scanner;
 
-    // check for file
-    if(!loadSysexFile(fileName,sysexList))
+    // Messages are sent as they are parsed
+    if(!scanner.open(fileName))
     {
         // TODO: log error
         return false;
     }
 
-    int outputStat= sysexList.count()/20;
+    DcMidiData md;
+    int sentCnt = 0;
     int donecnt = 0;
-    for (int i = 0; i < sysexList.count() ; i++)
+    while(scanner.next(md))
     {
-        _midiOut.dataOutThrottled(sysexList.at(i));
-        if(i % outputStat == 0)
+        _midiOut.dataOutThrottled(md);
+        sentCnt++;
+
+        if(scanner.size() && scanner.pos()*20 >= scanner.size()*donecnt)
         {
             *_con << (donecnt*5) << "% complete " << "\n";
             donecnt++;
@@ -3318,7 +3973,7 @@ bool DcPresetLib::programSysexFile(QString fileName)
         QApplication::processEvents();
     }
 
-    return true;
+    return sentCnt > 0;
 }
 
 //-------------------------------------------------------------------------
@@ -3437,40 +4092,30 @@ void DcPresetLib::conCmd_cpsel( DcConArgs args )
 //-------------------------------------------------------------------------
 void DcPresetLib::conCmd_ExportWorklistPresets( DcConArgs args )
 {
-    if(!args.noArgs())
+    if(args.first("").toString() == "cancel")
+    {
+        _exporter.cancel();
+    }
+    else if(!args.noArgs())
     {
         QString dstPath = args.first("").toString();
         QString username = QFileInfo(QDir::homePath()).baseName();
         QString path = QDir::toNativeSeparators(dstPath + "/" + username + "_preset_wl");
         QDir().mkpath(path);
-        QStringList nameList;
 
-        QFile fout(QDir::toNativeSeparators(path + "/" + "preset_info.csv"));
-
-        if (!fout.open(QIODevice::WriteOnly | QIODevice::Text))
-        {
-            return;
-        }
-        QTextStream out(&fout);
-        out << "Preset Name,Location,Type\n";
-        foreach(DcMidiData p,_workListData)
+        QList<DcMidiData> presets;
+        for (int row = 0; row < _workListData.length(); row++)
         {
+            DcMidiData p = _workListData.at(row);
             if(p.contains("47 F7"))
                 continue;
-            QString location = getPresetBankPresetNumber(p);
-            QString presetName = getPresetName(p);
-            QString etype = getEffectType(p);
-            out << presetName + "," + location + (etype.isEmpty() ? "\n" : QString("," + etype + "\n"));
-
-            QString name = location + "_" + presetName + (etype.isEmpty() ? "\n" : QString("_" + etype));
-
-            name = QDir::toNativeSeparators(path + "/" + name + ".syx");
-            
-            midiDataToBinFile(name,p);
+            presets.append(p);
         }
 
-        fout.close();
-        *_con << "The worklist has been exported to this directory: " << path << "\n";
+        QList<DcPresetExporter::Job> jobs;
+        QSet<QString> used;
+        DcPresetExporter::appendPresetJobs(presets,path,jobs,used);
+        startExport(jobs,"The worklist has been exported to this directory: " + path);
     }
     else
     {
@@ -3482,22 +4127,86 @@ void DcPresetLib::conCmd_ExportWorklistPresets( DcConArgs args )
 //-------------------------------------------------------------------------
 void DcPresetLib::conCmd_SplitPresetBundle( DcConArgs args )
 {
-    if(!args.noArgs())
+    if(args.first("").toString() == "cancel")
     {
-        // First arg is the source file
+        _exporter.cancel();
+    }
+    else if(!args.noArgs())
+    {
+        // First arg is the source file, or a folder of bundles
         QString fileName = args.first("").toString();
 
         // Second arg is the destination path
         QString destPath = args.second("").toString();
 
-        exportPresetBundleToPath(fileName, destPath);
+        if(_exporter.isRunning())
+        {
+            *_con << "An export is already running, use 'exportfile cancel' to stop it\n";
+            return;
+        }
+
+        // The bundles are read and split on the export pool
+        _exportWhat.clear();
+        _exportTimer.start();
+        _exporter.startSplit(fileName,destPath);
     }
 }
 
+//-------------------------------------------------------------------------
+bool DcPresetLib::startExport( const QList<DcPresetExporter::Job>& jobs, const QString& what )
+{
+    if(_exporter.isRunning())
+    {
+        *_con << "An export is already running, use 'exportfile cancel' to stop it\n";
+        return false;
+    }
+
+    _exportWhat = what;
+    _exportTimer.start();
+    *_con << "Exporting " << jobs.length() << " files\n";
+    return _exporter.start(jobs);
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::exportPrepared( int bundles, int files )
+{
+    _exportWhat = QString("Exported %1 bundles").arg(bundles);
+    *_con << "Exporting " << files << " files\n";
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::exportSkipped( const QString& path, const QString& reason )
+{
+    *_con << "Skipped " << path << ": " << reason << "\n";
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::exportProgress( int done, int total )
+{
+    *_con << "export: " << done << "/" << total << "\n";
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::exportFinished( int written, int failed, bool cancelled )
+{
+    qint64 ms = qMax((qint64)1,_exportTimer.elapsed());
+    if(cancelled)
+    {
+        *_con << "Export cancelled after " << written << " files\n";
+    }
+    else
+    {
+        *_con << _exportWhat << "\n";
+    }
+    *_con << written << " files written, " << failed << " failed in " << ms << " ms ("
+          << QString::number(written * 1000.0 / ms,'f',0) << " files/s)\n";
+}
+
+
 //-------------------------------------------------------------------------
 void DcPresetLib::setFamilyDetails( DcDeviceDetails &details )
 {
-    if(gUseAltPresetSize)
+    if(details.Codec.isCompactRead())
     {
         details.PresetRd_NAK.setPattern(details.SOXHdr.toString() + QLatin1String("(67....47|47)F7"));
         details.PresetRd_ACK.setPattern(details.SOXHdr.toString() + QLatin1String("67"));
@@ -3521,13 +4230,19 @@ void DcPresetLib::setFamilyDetails( DcDeviceDetails &details )
     details.PresetWr_ACK.setPattern(details.SOXHdr.toString() + QLatin1String("....45F7"));
                                                                   
     
-    details.PresetSize              = 650;
-    details.PresetNumberOffset      = 7;
-    details.PresetStartOfDataOffset = 9;
-    details.PresetNameLen           = 16;
-    details.PresetNameOffset        = 632;
-    details.PresetChkSumOffset      = details.PresetSize - 2;
-    details.PresetDataLength        = details.PresetChkSumOffset - details.PresetStartOfDataOffset;
+    const DcPresetSchema::Layout* layout = DcPresetSchema::forDevice(details.Name);
+    if(!layout)
+    {
+        layout = &DcPresetSchema::defaultLayout();
+    }
+
+    details.PresetSize              = layout->Size;
+    details.PresetNumberOffset      = layout->offset(DcPresetSchema::Number);
+    details.PresetStartOfDataOffset = layout->offset(DcPresetSchema::Data);
+    details.PresetNameLen           = layout->width(DcPresetSchema::Name);
+    details.PresetNameOffset        = layout->offset(DcPresetSchema::Name);
+    details.PresetChkSumOffset      = layout->offset(DcPresetSchema::Checksum);
+    details.PresetDataLength        = layout->width(DcPresetSchema::Data);
 }
 
 //-------------------------------------------------------------------------
@@ -3535,6 +4250,7 @@ bool DcPresetLib::updateDeviceDetails( const DcMidiData &data,DcDeviceDetails& d
 {
     bool rtval = true;
     int fastfetch_feature_thresh = 9999;
+    const DcPresetSchema::Layout* layout = 0;
 
 
     // Enable/disable fast fetch feature
@@ -3542,39 +4258,40 @@ bool DcPresetLib::updateDeviceDetails( const DcMidiData &data,DcDeviceDetails& d
 
     if(data.contains(DcMidiDevDefs::kTimeLineIdent) || data.contains("0001551201"))
     {
-        details.Name                    = "TimeLine";
-        details.PresetsPerBank          = 2;
-        details.PresetCount             = 200;
+        layout                          = DcPresetSchema::forProduct(0x01);
         fastfetch_feature_thresh        = 156;
     }
     else if(data.contains(DcMidiDevDefs::kMobiusIdent) ||  data.contains("0001551202") )
     {
-        details.Name                      = "Mobius";
-        details.PresetsPerBank          = 2;
-        details.PresetCount             = 200;
+        layout                          = DcPresetSchema::forProduct(0x02);
         fastfetch_feature_thresh        = 115;
     }
     else if(data.contains(DcMidiDevDefs::kBigSkyIdent) ||  data.contains("0001551203"))
     {
-        details.Name                      = "Big Sky";
-        details.PresetsPerBank          = 3;
-        details.PresetCount             = 300;
+        layout                          = DcPresetSchema::forProduct(0x03);
         fastfetch_feature_thresh        = 123;
     }
     else
     {
         rtval = false;
     }
+
+    if(layout)
+    {
+        details.Name                    = layout->Device;
+        details.PresetsPerBank          = layout->PresetsPerBank;
+        details.PresetCount             = layout->PresetCount;
+    }
     
     if( fastfetch_feature_thresh != 9999 && details.FwVerInt >= fastfetch_feature_thresh )
     {
         DCLOG() << "Fastfetch feature auto enabled";
-        gUseAltPresetSize = true;
+        details.Codec.setCompactRead(true);
     }
     else
     {
         DCLOG() << "Fastfetch feature auto disabled";
-        gUseAltPresetSize = false;
+        details.Codec.setCompactRead(false);
     }
 
     setFamilyDetails( details );
@@ -3588,140 +4305,12 @@ bool DcPresetLib::updateDeviceDetails( const DcMidiData &data,DcDeviceDetails& d
 //-------------------------------------------------------------------------
 QString DcPresetLib::getEffectType( const DcMidiData &data )
 {
-    enum {
-        BLOOM = 0,
-        DUST,
-        CHORALE,
-        SHIMMER_1,
-        MAG_REVERSE,
-        NONLINEAR,
-        REFLECTIONS,
-        ROOM,
-        HALL,
-        PLATE,
-        SPRING,	
-        SWELL,
-        NUM_EFFECT_TYPES
-    } ;
-
-
-    int etype = data.at(_devDetails.PresetNumberOffset + 2);
-    QString rtval = "Unknown";
-    
-    if(data.contains("01551203"))
-    {
-        switch (etype)
-        {
-        case BLOOM:
-            rtval = "Bloom";
-    	    break;
-        case DUST:
-            rtval = "Cloud";
-            break;
-        case CHORALE:
-            rtval = "Chorale";
-            break;
-        case SHIMMER_1:
-            rtval = "Shimmer";
-            break;
-        case MAG_REVERSE:
-            rtval = "Magneto";
-            break;
-        case NONLINEAR:
-            rtval = "Nonlinear";
-            break;
-        case REFLECTIONS:
-            rtval = "Reflection";
-            break;
-        case ROOM:
-            rtval = "Room";
-            break;
-        case HALL:
-            rtval = "Hall";
-            break;
-        case PLATE:
-            rtval = "Plate";
-            break;
-        case SPRING:
-            rtval = "Spring";
-            break;
-        case SWELL:
-            rtval = "Swell";
-            break;
-        default:
-            break;
-        };
-    }
-
-    return rtval;
-
-}
-
-//-------------------------------------------------------------------------
-void DcPresetLib::exportPresetBundleToPath( QString fileName, QString &destPath )
-{
-    QList<DcMidiData> sysexList;
-    QList<DcMidiData> filterList;
-
-    filterList << "47 F7";
-
-    if(!loadSysexFile(fileName,sysexList,&filterList))
-    {
-        *_con << _lastErrorMsgStr;
-        return;
-    }
-
-    QString path;
-
-
-    if(destPath.isEmpty())
+    DcPresetRef preset(data.toByteArray());
+    if(!preset.layout() || data.length() <= preset.layout()->offset(DcPresetSchema::EffectType))
     {
-        path  = QFileInfo(fileName).absolutePath();
+        return "Unknown";
     }
-    else
-    {
-        path = destPath;
-    }
-
-    QString exportDirName  = QFileInfo(fileName).baseName();
-    exportDirName.replace(" ","_");
-
-    path = QDir::toNativeSeparators(path + "/" + exportDirName);
-
-    // Make the preset export directory
-    QDir().mkpath(path);
-
-    DcDeviceDetails d = _devDetails;
-    
-    QFile fout(QDir::toNativeSeparators(path + "/" + "preset_info.csv"));
-
-    if (!fout.open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        return;
-    }
-    
-    QTextStream out(&fout);
-    out << "Preset Name,Location,Type\n";
-
-    updateDeviceDetails(sysexList[0],_devDetails);
-
-    foreach(DcMidiData p,sysexList)
-    {
-        QString location = getPresetBankPresetNumber(p);
-        QString presetName = getPresetName(p);
-        QString etype = getEffectType(p);
-
-        out << presetName + "," + location + (etype.isEmpty() ? "\n" : QString("," + etype + "\n"));
-        
-        QString name = location + "_" + presetName + (etype.isEmpty() ? "\n" : QString("_" + etype));
-                
-        name = QDir::toNativeSeparators(path + "/" + name + ".syx");
-
-        midiDataToBinFile(name,p);
-    }
-    fout.close();
-
-    _devDetails = d;
+    return preset.effectTypeName();
 }
 
 //-------------------------------------------------------------------------
@@ -3819,6 +4408,7 @@ void DcPresetLib::clearMidiInConnections()
     QObject::disconnect(&_midiIn, &DcMidiIn::dataIn, this, &DcPresetLib::recvIdData);
     QObject::disconnect(&_midiIn, &DcMidiIn::dataIn, &_xferInMachine, &DcXferMachine::replySlotForDataIn);
     QObject::disconnect(&_midiIn, &DcMidiIn::dataIn, &_xferOutMachine, &DcXferMachine::replySlotForDataOut);
+    QObject::disconnect(&_midiIn, &DcMidiIn::dataIn, &_xferVerifyMachine, &DcXferMachine::replySlotForDataIn);
     _midiIn.removeTrigger(*_idResponceTrigger);
 }
 
@@ -3874,8 +4464,8 @@ void DcPresetLib::conCmd_showlog( DcConArgs args )
 void DcPresetLib::clearWorklist()
 {
     _workListData.clear();
-    _dirtyItemsIndex.clear();
-    ui.workList->clear();
+    _dirtyRows.clear();
+    _workListModel->reset();
 }
 //-------------------------------------------------------------------------
 void DcPresetLib::clearDeviceUI()
@@ -3903,7 +4493,7 @@ void DcPresetLib::UpdateFirmwareHelper(const QString& FirmwareFile)
     QMessageBox* msgBox = new QMessageBox( this );
     msgBox->setModal( true );
 
-    if( _dirtyItemsIndex.length() )
+    if( _dirtyRows.count() )
     {
         if( QMessageBox::Discard != QMessageBox::question( this,"Unsaved Worklist Warning",
             "You have unsaved presets in the Worklist.\nAre you sure you want to update the device firmware?",
@@ -3954,6 +4544,7 @@ void DcPresetLib::UpdateFirmwareHelper(const QString& FirmwareFile)
     DcBootControl bctrl( _midiIn,_midiOut,_devDetails);
 
     DcUpdateDialogMgr* udmgr = new DcUpdateDialogMgr( _updatesPath,&bctrl,_devDetails,this );
+    udmgr->setRetryBackoff( _retryBackoff );
     
     DcUpdateDialogMgr::DcUpdate_Result result = FirmwareFile.isEmpty() ? udmgr->getLatestAndShowDialog() : udmgr->justDownloadFile( FirmwareFile );
 
@@ -4010,7 +4601,6 @@ void DcPresetLib::UpdateFirmwareHelper(const QString& FirmwareFile)
     *_con << fileName << "\n" ;
      DCLOG() << "File Drop: " << fileName;
 
-    DcMidiDataList_t mdl;
     DcMidiData md;
     ui.devImgLabel->setDisabled(true);
     QApplication::processEvents();
@@ -4018,13 +4608,38 @@ void DcPresetLib::UpdateFirmwareHelper(const QString& FirmwareFile)
     if(_devDetails.isEmpty())
         return;
 
-    if( loadPresetBinary( fileName,mdl ) )
+    // A folder is imported into the work list
+    if( QFileInfo(fileName).isDir() )
+    {
+        importFiles( DcBatchImport::collect( fileName ) );
+        ui.devImgLabel->setDisabled(false);
+        return;
+    }
+
+    // Decide what was dropped from the file size, so the file is only mapped once
+    bool bankFile = QFileInfo(fileName).size() > _devDetails.PresetSize || DcBackupStore::isManifest( fileName );
+
+    // Archives are compressed, so their header count decides instead
+    if( DcPresetArchive::isArchive( fileName ) )
     {
-        _workListData = mdl;
-        checkSyncState();
+        DcPresetArchiveReader reader;
+        bankFile = !reader.open( fileName ) || reader.header().PresetCount != 1;
     }
 
-    if( loadPresetBinary( fileName,md ) )
+    if( bankFile )
+    {
+        DcPresetBank bank;
+        if( loadPresetBinary( fileName,bank ) )
+        {
+            _workListData = bank;
+            checkSyncState();
+        }
+        else
+        {
+            UpdateFirmwareHelper( fileName );
+        }
+    }
+    else if( loadPresetBinary( fileName,md ) )
     {
         *_con << md.toString() << "\n";
     }
@@ -4036,8 +4651,760 @@ void DcPresetLib::UpdateFirmwareHelper(const QString& FirmwareFile)
 }
 
 
+//-------------------------------------------------------------------------
+void DcPresetLib::importFiles( const QStringList& files )
+{
+    if( files.isEmpty() )
+    {
+        *_con << "No preset files found\n";
+        return;
+    }
+
+    QElapsedTimer t;
+    t.start();
+    DcBatchImport importer( _devDetails.PresetWriteHdr.toByteArray() );
+    QList<DcBatchImport::Result> results = importer.run( files );
+    qint64 readMs = t.elapsed();
+
+    // Report what was found
+    QMap<int,int> kinds;
+    int badChecksums = 0;
+    foreach( const DcBatchImport::Result& r,results )
+    {
+        kinds[r.Type]++;
+        badChecksums += r.BadChecksums;
+        if( r.Type == DcBatchImport::Invalid || r.Type == DcBatchImport::Foreign || r.BadChecksums )
+        {
+            *_con << "  " << r.Path << ": " << DcBatchImport::kindName( r.Type );
+            if( r.BadChecksums )
+            {
+                *_con << ", " << r.BadChecksums << " bad checksums";
+            }
+            if( !r.Error.isEmpty() )
+            {
+                *_con << " (" << r.Error << ")";
+            }
+            *_con << "\n";
+        }
+    }
+
+    *_con << results.length() << " files read in " << readMs << " ms:";
+    QMapIterator<int,int> kit( kinds );
+    while( kit.hasNext() )
+    {
+        kit.next();
+        *_con << " " << kit.value() << " " << DcBatchImport::kindName( (DcBatchImport::Kind)kit.key() );
+    }
+    *_con << ", " << badChecksums << " presets with bad checksums skipped\n";
+
+    if( _workListData.isEmpty() )
+    {
+        *_con << "The work list is empty, fetch or open presets first, or use 'import <folder> lib'\n";
+        return;
+    }
+
+    // Presets land in the slot for their preset number, later files win
+    int firstPresetNumber = getPresetNumber( _workListData.first() );
+    QSet<int> rows;
+    foreach( const DcBatchImport::Result& r,results )
+    {
+        foreach( const DcMidiData& md,r.Presets )
+        {
+            int row = getPresetNumber( md ) - firstPresetNumber;
+            if( row >= 0 && row < _workListData.length() )
+            {
+                _workListData.replace( row,md );
+                rows.insert( row );
+            }
+        }
+    }
+
+    worklistRowsChanged( rows.toList() );
+    if( _dirtyRows.count() )
+    {
+        _machine.postEvent( new WorkListDirtyEvent() );
+    }
+    *_con << rows.size() << " work list slots updated\n";
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_dupes( DcConArgs args )
+{
+    QString source = args.first("").toString();
+    bool ok = false;
+    int maxDiff = args.second("").toString().toInt(&ok);
+    if(!ok)
+    {
+        maxDiff = 8;
+    }
+    QString outDir = args.at(3).toString();
+
+    if(source.isEmpty() || (source != "wl" && source != "lib" && !QFileInfo(source).isDir()))
+    {
+        *_con << "usage: dupes <wl | lib | folder> [maxdiff] [<out folder>]\n";
+        return;
+    }
+
+    // Gather the presets and where each one came from
+    QList<DcMidiData> presets;
+    QStringList origins;
+    QList<DcBatchImport::Result> files;
+    QList<int> fileOf;
+
+    if(source == "wl")
+    {
+        presets = _workListData.toList();
+        for (int row = 0; row < presets.length(); row++)
+        {
+            origins.append("work list " + presetToBankPatchName(presets[row]));
+        }
+    }
+    else
+    {
+        QStringList roots;
+        if(source == "lib")
+        {
+            initPresetLibrary();
+            roots = _presetIndex.roots();
+        }
+        else
+        {
+            roots << source;
+        }
+
+        QStringList paths;
+        foreach(const QString& root,roots)
+        {
+            paths << DcBatchImport::collect(root);
+        }
+
+        // Every device's presets are compared, the header bytes keep the
+        // devices apart, so take any complete preset with a good checksum
+        DcBatchImport importer(_devDetails.PresetWriteHdr.toByteArray());
+        files = importer.run(paths);
+        for (int f = 0; f < files.length(); f++)
+        {
+            foreach(const DcMidiData& md,files.at(f).Messages)
+            {
+                DcPresetRef preset(md.toByteArray());
+                if(!preset.isValid() || preset.computeChecksum() != preset.checksum())
+                {
+                    continue;
+                }
+                presets.append(md);
+                origins.append(files.at(f).Path + " " + preset.location() + " - " + preset.name());
+                fileOf.append(f);
+            }
+        }
+    }
+
+    QElapsedTimer t;
+    t.start();
+    DcPresetSimilarity sim;
+    QList<DcPresetSimilarity::Cluster> clusters = sim.find(presets,maxDiff);
+    qint64 ms = t.elapsed();
+
+    int exactGroups = 0;
+    int redundant = 0;
+    foreach(const DcPresetSimilarity::Cluster& c,clusters)
+    {
+        exactGroups += c.isExact();
+        redundant += c.Members.length() - 1;
+    }
+
+    *_con << presets.length() << " presets compared in " << ms << " ms (" << sim.comparisons() << " pairs checked";
+    if(sim.splitBuckets())
+    {
+        *_con << ", " << sim.splitBuckets() << " large buckets split";
+    }
+    *_con << ")\n";
+    *_con << exactGroups << " exact and " << clusters.length() - exactGroups << " near duplicate groups, "
+          << redundant << " redundant presets\n";
+
+    // Biggest groups first
+    QList<DcPresetSimilarity::Cluster> shown = clusters;
+    std::sort(shown.begin(),shown.end(),[](const DcPresetSimilarity::Cluster& a,const DcPresetSimilarity::Cluster& b)
+        { return a.Members.length() > b.Members.length(); });
+    for (int idx = 0; idx < shown.length() && idx < 20; idx++)
+    {
+        const DcPresetSimilarity::Cluster& c = shown.at(idx);
+        *_con << (c.isExact() ? "exact" : QString("near, up to %1 bytes").arg(c.MaxDiff)) << ":\n";
+        for (int m = 0; m < c.Members.length() && m < 8; m++)
+        {
+            *_con << "  " << origins.at(c.Members.at(m)) << "\n";
+        }
+        if(c.Members.length() > 8)
+        {
+            *_con << "  ... " << c.Members.length() - 8 << " more\n";
+        }
+    }
+
+    if(outDir.isEmpty())
+    {
+        return;
+    }
+    if(source == "wl")
+    {
+        *_con << "Clean up writes library bundles, use 'lib' or a folder as the source\n";
+        return;
+    }
+
+    // Keep the first preset of every group, drop the rest
+    QSet<int> dropped;
+    foreach(const DcPresetSimilarity::Cluster& c,clusters)
+    {
+        for (int m = 1; m < c.Members.length(); m++)
+        {
+            dropped.insert(c.Members.at(m));
+        }
+    }
+
+    QVector<QList<DcMidiData> > kept(files.length());
+    for (int idx = 0; idx < presets.length(); idx++)
+    {
+        if(!dropped.contains(idx))
+        {
+            kept[fileOf.at(idx)].append(presets.at(idx));
+        }
+    }
+
+    QDir().mkpath(outDir);
+    QSet<QString> used;
+    int written = 0;
+    for (int f = 0; f < files.length(); f++)
+    {
+        if(kept.at(f).isEmpty())
+        {
+            continue;
+        }
+        QString path = DcPresetExporter::uniquePath(outDir,QFileInfo(files.at(f).Path).completeBaseName(),".syx",used);
+        if(savePresetBinary(path,kept.at(f)))
+        {
+            written++;
+        }
+        else
+        {
+            *_con << _lastErrorMsgStr << "\n";
+        }
+    }
+    *_con << written << " deduplicated bundles written to " << outDir << ", " << dropped.size() << " presets dropped\n";
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetLib::loadPresetColumns( const QString& source )
+{
+    // The lists are small and always reloaded
+    if(source == "wl" || source == "dl")
+    {
+        _presetColumns.clear();
+        _presetColumnsSource.clear();
+
+        const DcPresetBank& bank = source == "wl" ? _workListData : _deviceListData;
+        QString origin = source == "wl" ? "work list" : "device";
+        for (int row = 0; row < bank.length(); row++)
+        {
+            _presetColumns.append(bank.at(row).toByteArray(),origin);
+        }
+        return true;
+    }
+
+    // Files are read again only when the library or the folder changed
+    QByteArray stamp;
+    QStringList paths;
+    if(source == "lib")
+    {
+        // Same as 'lib', picks up new backups and imports
+        initPresetLibrary();
+        if(_presetIndex.update())
+        {
+            _presetIndex.save();
+        }
+        stamp = QByteArray::number(_presetIndex.generation());
+    }
+    else if(QFileInfo(source).isDir())
+    {
+        paths = DcBatchImport::collect(source);
+        QCryptographicHash h(QCryptographicHash::Sha1);
+        foreach(const QString& path,paths)
+        {
+            QFileInfo fi(path);
+            h.addData(path.toUtf8());
+            h.addData(QByteArray::number(fi.lastModified().toMSecsSinceEpoch()) + ':' + QByteArray::number(fi.size()));
+        }
+        stamp = h.result();
+    }
+    else
+    {
+        return false;
+    }
+
+    if(source == _presetColumnsSource && stamp == _presetColumnsStamp)
+    {
+        return true;
+    }
+
+    _presetColumns.clear();
+    _presetColumnsSource.clear();
+
+    if(source == "lib")
+    {
+        // Only the indexed presets are read, each file once
+        QList<DcMidiData> presets;
+        QStringList origins;
+        int stale = _presetIndex.loadAll(presets,origins);
+        if(stale)
+        {
+            *_con << stale << " library presets changed since they were indexed, use 'lib scan'\n";
+        }
+        for (int idx = 0; idx < presets.length(); idx++)
+        {
+            _presetColumns.append(presets.at(idx).toByteArray(),origins.at(idx));
+        }
+    }
+    else
+    {
+        // Every device's presets are kept, not just the connected one's
+        DcBatchImport importer(_devDetails.PresetWriteHdr.toByteArray());
+        QList<DcBatchImport::Result> files = importer.run(paths);
+        foreach(const DcBatchImport::Result& r,files)
+        {
+            foreach(const DcMidiData& md,r.Messages)
+            {
+                _presetColumns.append(md.toByteArray(),r.Path);
+            }
+        }
+    }
+
+    _presetColumnsSource = source;
+    _presetColumnsStamp = stamp;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_query( DcConArgs args )
+{
+    QString source = args.first("").toString();
+    if(source.isEmpty() || (source != "wl" && source != "dl" && source != "lib" && !QFileInfo(source).isDir()))
+    {
+        *_con << "usage: query <wl | dl | lib | folder> [<field><op><value> ...] [count | hist <field> | stats <field> | list [n]]\n";
+        return;
+    }
+
+    QElapsedTimer t;
+    t.start();
+    if(!loadPresetColumns(source))
+    {
+        *_con << "Could not read " << source << "\n";
+        return;
+    }
+    qint64 loadMs = t.elapsed();
+
+    // Conditions come first, then an optional action and its argument
+    QList<DcPresetColumns::Condition> conds;
+    QString action = "count";
+    QString actionArg;
+    for (int idx = 2; idx <= args.argCount(); idx++)
+    {
+        QString tok = args.at(idx).toString();
+        if(tok == "count" || tok == "hist" || tok == "stats" || tok == "list")
+        {
+            action = tok;
+            actionArg = args.at(idx + 1).toString();
+            break;
+        }
+
+        DcPresetColumns::Condition c;
+        if(!_presetColumns.parseCondition(tok,c))
+        {
+            *_con << _presetColumns.getLastErrorString() << "\n";
+            return;
+        }
+        conds.append(c);
+    }
+
+    int key = 0;
+    if((action == "hist" || action == "stats") && !_presetColumns.parseKey(actionArg,key))
+    {
+        *_con << _presetColumns.getLastErrorString() << "\n";
+        return;
+    }
+
+    t.restart();
+    QVector<quint8> mask = _presetColumns.filter(conds);
+    int matches = DcPresetColumns::count(mask);
+
+    if(action == "hist")
+    {
+        QList<QPair<QString,int> > hist = _presetColumns.histogram(key,mask);
+        for (int idx = 0; idx < hist.length() && idx < 50; idx++)
+        {
+            *_con << "  " << hist.at(idx).first << ": " << hist.at(idx).second << " ("
+                  << QString::number(100.0 * hist.at(idx).second / qMax(1,matches),'f',1) << "%)\n";
+        }
+        if(hist.length() > 50)
+        {
+            *_con << "  ... " << hist.length() - 50 << " more values\n";
+        }
+    }
+    else if(action == "stats")
+    {
+        int min,max;
+        double mean;
+        if(_presetColumns.stats(key,mask,min,max,mean))
+        {
+            *_con << "  " << _presetColumns.keyName(key) << " min " << min << " max " << max
+                  << " mean " << QString::number(mean,'f',2) << "\n";
+        }
+        else
+        {
+            *_con << _presetColumns.getLastErrorString() << "\n";
+        }
+    }
+    else if(action == "list")
+    {
+        bool ok;
+        int limit = actionArg.toInt(&ok);
+        limit = ok ? limit : 20;
+        for (int row = 0, shown = 0; row < mask.size() && shown < limit; row++)
+        {
+            if(mask.at(row))
+            {
+                *_con << "  " << _presetColumns.rowText(row) << "\n";
+                shown++;
+            }
+        }
+    }
+
+    *_con << matches << " of " << _presetColumns.rowCount() << " presets match in " << t.elapsed() << " ms";
+    if(loadMs)
+    {
+        *_con << " (" << loadMs << " ms to load)";
+    }
+    *_con << "\n";
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_import( DcConArgs args )
+{
+    QString path = args.first("").toString();
+    bool toLibrary = args.second("").toString() == "lib";
+
+    if( path.isEmpty() || !QFileInfo(path).exists() )
+    {
+        *_con << "usage: import <folder or file> [lib]\n";
+        return;
+    }
+
+    // Library paths must match the ones the index scan produces.  A single
+    // file is its own root, so its folder is not pulled into the library
+    QFileInfo fi( path );
+    QString root = QDir::cleanPath( fi.absoluteFilePath() );
+
+    // The index reads presets for every device itself, so no device is needed
+    if( toLibrary )
+    {
+        initPresetLibrary();
+        _presetIndex.addRoot( root );
+        int indexed = _presetIndex.update();
+        if( !_presetIndex.save() )
+        {
+            *_con << _presetIndex.getLastErrorString() << "\n";
+        }
+        *_con << indexed << " files indexed, library now has " << _presetIndex.presetCount() << " presets in " << _presetIndex.fileCount() << " files\n";
+        return;
+    }
+
+    importFiles( fi.isDir() ? DcBatchImport::collect( root ) : QStringList( root ) );
+}
+
 void DcPresetLib::on_actionShow_Log_triggered()
 {
     DcLogDialog* ld = new DcLogDialog(0,_log);
     ld->show();
 }
+
+//-------------------------------------------------------------------------
+void DcPresetLib::initPresetLibrary()
+{
+    if(_presetIndexLoaded)
+    {
+        return;
+    }
+
+    if(!_presetIndex.load(_dataPath + "library.idx"))
+    {
+        DCLOG() << _presetIndex.getLastErrorString();
+    }
+    _presetIndex.addRoot(_devlistBackupPath);
+    _presetIndex.addRoot(_worklistBackupPath);
+    _presetIndex.setBackupStore(&_backupStore);
+    _presetIndexLoaded = true;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::on_actionShow_Library_triggered()
+{
+    initPresetLibrary();
+
+    if(!_libraryDlg)
+    {
+        _libraryDlg = new DcPresetLibraryDialog(&_presetIndex,this);
+        connect(_libraryDlg,&DcPresetLibraryDialog::presetActivated,this,&DcPresetLib::libraryPresetActivated);
+    }
+    _libraryDlg->show();
+    _libraryDlg->raise();
+    _libraryDlg->rescan();
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::libraryPresetActivated( const DcMidiData& md )
+{
+    int row = ui.workList->currentRow();
+    if(row < 0 || row >= _workListData.length())
+    {
+        QMessageBox::information(this,"Preset Library","Select the work list slot the preset should go in first.");
+        return;
+    }
+
+    if(!md.toByteArray().startsWith(_devDetails.PresetWriteHdr.toByteArray()) || md.length() != _devDetails.PresetSize)
+    {
+        QMessageBox::warning(this,"Preset Library","The preset is not for the connected " + _devDetails.Name + ".");
+        return;
+    }
+
+    replaceWorklistPreset(row,md);
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_backup( DcConArgs args )
+{
+    QString cmd = args.first("").toString();
+    QSettings settings;
+
+    if(cmd == "dedup")
+    {
+        if(args.argCount() > 1)
+        {
+            QString v = args.second("").toString().toLower();
+            _backupDedup = (v == "on" || v == "1" || v == "true");
+            settings.setValue("backup/dedup",_backupDedup);
+        }
+        *_con << "backup dedup is " << (_backupDedup ? "enabled" : "disabled") << "\n";
+    }
+    else if(cmd == "fsync")
+    {
+        if(args.argCount() > 1)
+        {
+            int policy = qBound(0,args.second(1).toInt(),2);
+            _backupWriter.setFsyncPolicy((DcBackupWriter::FsyncPolicy)policy);
+            settings.setValue("backup/fsync",policy);
+        }
+        *_con << "backup fsync policy is " << settings.value("backup/fsync",DcBackupWriter::FsyncFile).toInt()
+              << " (0 = none, 1 = each file, 2 = each file and folder)\n";
+    }
+    else if(cmd == "migrate")
+    {
+        bool removeOriginals = args.second("").toString() == "delete";
+        int cnt = _backupStore.migrate(_devlistBackupPath,kPresetNumberOffset,removeOriginals);
+        cnt += _backupStore.migrate(_worklistBackupPath,kPresetNumberOffset,removeOriginals);
+        *_con << "migrated " << cnt << " backups, " << (_backupStore.bytesSaved()/1024) << " KB of duplicate presets not stored\n";
+        if(!removeOriginals)
+        {
+            *_con << "the original .syx backups were kept, use 'backup migrate delete' to remove them\n";
+        }
+    }
+    else if(cmd == "restore")
+    {
+        QString manifest = args.second("").toString();
+        QString bundle = args.at(3).toString();
+        if(manifest.isEmpty() || bundle.isEmpty())
+        {
+            *_con << "usage: backup restore <manifest.dcm> <bundle.syx>\n";
+        }
+        else if(_backupStore.restoreToBundle(manifest,bundle))
+        {
+            *_con << "restored " << manifest << " to " << bundle << "\n";
+        }
+        else
+        {
+            *_con << _backupStore.getLastErrorString() << "\n";
+        }
+    }
+    else
+    {
+        *_con << "doc: " << args.cmd() << " " << args.meta("doc") << "\n";
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_archive( DcConArgs args )
+{
+    QString cmd = args.first("").toString();
+    QString src = args.second("").toString();
+    QString dst = args.at(3).toString();
+
+    if(cmd == "pack" || cmd == "unpack")
+    {
+        if(src.isEmpty() || dst.isEmpty())
+        {
+            *_con << "usage: archive " << cmd << " <source> <destination>\n";
+            return;
+        }
+
+        QList<DcMidiData> presets;
+        QString errorMsg;
+        bool ok;
+        if(cmd == "pack")
+        {
+            ok = DcSysexScanner::loadFile(src,presets,0,errorMsg) &&
+                 DcPresetArchive::save(dst,presets,_devDetails.Name,_devDetails.FwVersion,errorMsg);
+        }
+        else
+        {
+            ok = DcPresetArchive::load(src,presets,errorMsg);
+            if(ok)
+            {
+                ok = savePresetBinary(dst,presets);
+                errorMsg = _lastErrorMsgStr;
+            }
+        }
+
+        if(ok)
+        {
+            *_con << "wrote " << presets.length() << " presets to " << dst << " ("
+                  << QFileInfo(src).size() << " -> " << QFileInfo(dst).size() << " bytes)\n";
+        }
+        else
+        {
+            *_con << errorMsg << "\n";
+        }
+    }
+    else if(cmd == "stats")
+    {
+        // Compress every raw backup to a temp file, and time loading both forms
+        QStringList dirs;
+        if(src.isEmpty())
+        {
+            dirs << _devlistBackupPath << _worklistBackupPath;
+        }
+        else
+        {
+            dirs << src;
+        }
+
+        qint64 rawBytes = 0, zBytes = 0, rawNs = 0, zNs = 0;
+        int files = 0;
+        QString tmpPath = QDir::tempPath() + "/spl_archive_stats.syz";
+        QElapsedTimer t;
+
+        foreach(const QString& dir,dirs)
+        {
+            foreach(const QFileInfo& fi,QDir(dir).entryInfoList(QStringList() << "*.syx",QDir::Files))
+            {
+                QList<DcMidiData> presets;
+                QString errorMsg;
+
+                t.start();
+                if(!DcSysexScanner::loadFile(fi.absoluteFilePath(),presets,0,errorMsg))
+                {
+                    continue;
+                }
+                rawNs += t.nsecsElapsed();
+
+                if(!DcPresetArchive::save(tmpPath,presets,QString(),QString(),errorMsg))
+                {
+                    *_con << errorMsg << "\n";
+                    return;
+                }
+
+                presets.clear();
+                t.start();
+                DcPresetArchive::load(tmpPath,presets,errorMsg);
+                zNs += t.nsecsElapsed();
+
+                rawBytes += fi.size();
+                zBytes += QFileInfo(tmpPath).size();
+                files++;
+            }
+        }
+        QFile::remove(tmpPath);
+
+        if(0 == files)
+        {
+            *_con << "no .syx backups found\n";
+            return;
+        }
+
+        *_con << files << " files, " << rawBytes << " -> " << zBytes << " bytes, ratio "
+              << QString::number(double(rawBytes)/qMax(zBytes,qint64(1)),'f',1) << ":1\n";
+        *_con << "average load: raw " << QString::number(rawNs/files/1000.0,'f',1) << " us, compressed "
+              << QString::number(zNs/files/1000.0,'f',1) << " us\n";
+    }
+    else if(cmd == "compress")
+    {
+        if(!src.isEmpty())
+        {
+            QString v = src.toLower();
+            _backupCompress = (v == "on" || v == "1" || v == "true");
+            QSettings settings;
+            settings.setValue("backup/compress",_backupCompress);
+        }
+        *_con << "compressed backups are " << (_backupCompress ? "enabled" : "disabled")
+              << (_backupDedup ? " (only used when backup dedup is off)\n" : "\n");
+    }
+    else
+    {
+        *_con << "doc: " << args.cmd() << " " << args.meta("doc") << "\n";
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLib::conCmd_library( DcConArgs args )
+{
+    initPresetLibrary();
+
+    QString cmd = args.first("").toString();
+
+    if(cmd == "add")
+    {
+        QString dir = args.second("").toString();
+        if(dir.isEmpty() || !QDir(dir).exists())
+        {
+            *_con << "usage: lib add <existing folder>\n";
+            return;
+        }
+        _presetIndex.addRoot(dir);
+        cmd = "scan";
+    }
+
+    QElapsedTimer t;
+    t.start();
+    int changed = _presetIndex.update();
+    if(changed)
+    {
+        _presetIndex.save();
+    }
+
+    if(cmd == "scan")
+    {
+        *_con << "indexed " << changed << " new or changed files in " << t.elapsed() << " ms, "
+              << _presetIndex.presetCount() << " presets in " << _presetIndex.fileCount() << " files\n";
+        return;
+    }
+
+    // Everything after "lib" is the search text
+    QStringList words;
+    for (int idx = 1; idx <= args.argCount(); idx++)
+    {
+        words << args.at(idx).toString();
+    }
+
+    t.restart();
+    QList<DcPresetIndexHit> hits = _presetIndex.find(words.join(" "),50);
+    foreach(const DcPresetIndexHit& h,hits)
+    {
+        *_con << h.Entry.Location << " " << h.Entry.Name << " (" << h.Entry.EffectType << ", " << h.Entry.Device << ") x"
+              << h.Copies << " " << h.Path << "\n";
+    }
+    *_con << hits.length() << " matches in " << t.elapsed() << " ms\n";
+}
@@ -34,6 +34,22 @@
 #include "IoProgressDialog.h"
 #include "DcXferMachine.h"
 #include "DcDeviceDetails.h"
+#include "DcMultiDeviceSession.h"
+#include "DcPresetIndex.h"
+#include "DcTrigramIndex.h"
+#include "DcPresetDiff.h"
+#include "DcDirtyTracker.h"
+#include "DcPresetListModel.h"
+#include <QElapsedTimer>
+#include "DcPresetExporter.h"
+#include "DcBatchImport.h"
+#include "DcPresetSimilarity.h"
+#include "DcPresetColumns.h"
+#include "DcPresetBank.h"
+#include "DcPortScanner.h"
+#include "DcBackupStore.h"
+#include "DcBackupWriter.h"
+#include "DcPresetLibraryDialog.h"
 #include "DcFileDownloader.h"
 
 #include "dcconbool.h"
@@ -56,6 +72,19 @@ public:
     DcPresetLib(QWidget *parent = 0);
     ~DcPresetLib();
 
+    /*!
+      Method is given a ref to the device details var and updates the object
+      with the basic identity information contained in the Identify response data
+      received in response to an MIDI identity request.
+    */ 
+    static bool updateDeviceDetails( const DcMidiData &data,DcDeviceDetails& details );
+
+    /*!
+      Method will modify the given "partially initialized" details object
+      with further, family specific, Strymon MIDI device configuration.
+    */ 
+    static void setFamilyDetails( DcDeviceDetails &details );
+
 //    // Plugin Test Code
 //    void loadConsolePlugins();
 //    QDir locatePluginsPath();
@@ -140,6 +169,7 @@ private slots:
 // State machine handlers
     void readPresetsComplete_entered();
     void writePresetsComplete_entered();
+    void verifyWritesComplete_entered();
     void setupWritePresetXfer_entered();
     void midiPortSelect_enter();
     void presetEdit_entered();
@@ -153,6 +183,13 @@ private slots:
 
     bool checkTestAndConfigureMidiPorts( QString in_port,QString out_port );
 
+    /*!
+      Looks for a supported device on every MIDI port pair at once, then
+      runs the device check on each pair found, fastest first.  The first
+      pair that passes is saved as the current ports and configured.
+    */
+    bool discoverMidiPorts( QString& in_port,QString& out_port );
+
     void dlgMsg(const QString& msg);
 
   
@@ -188,6 +225,22 @@ private slots:
     void conCmd_SplitPresetBundle( DcConArgs args );
 
     void conCmd_enableFastFetch(DcConArgs args);
+    void conCmd_xferStats(DcConArgs args);
+    void conCmd_verifyWrites(DcConArgs args);
+    void conCmd_multiDevice(DcConArgs args);
+    void multiSessionFinished();
+    void conCmd_library(DcConArgs args);
+    void conCmd_find(DcConArgs args);
+    void conCmd_diff(DcConArgs args);
+    void conCmd_import(DcConArgs args);
+    void conCmd_dupes(DcConArgs args);
+    void conCmd_query(DcConArgs args);
+    void conCmd_portScan(DcConArgs args);
+    void conCmd_backup(DcConArgs args);
+    void conCmd_archive(DcConArgs args);
+    void backupWritten(const QString& path);
+    void backupFailed(const QString& path,const QString& error);
+    void libraryPresetActivated(const DcMidiData& md);
     void conCmd_PrintEnvi( DcConArgs args );
 
     //void conCmd_devTestExec( DcConArgs args );
@@ -204,11 +257,19 @@ private slots:
     void conCmd_RenameItemInWorklist( DcConArgs args );
 
     /*!
-      For the given preset bundle file path, export each preset
-      into separate files, each using the preset name as the file name.
-      The destination path is also specified.
-    */ 
-    void exportPresetBundleToPath( QString fileName, QString &destPath );
+      Starts writing jobs on the export pool, what is reported when done.
+    */
+    bool startExport( const QList<DcPresetExporter::Job>& jobs, const QString& what );
+
+    /*!
+      Reads and classifies files in parallel, then merges the valid presets
+      into the work list.
+    */
+    void importFiles( const QStringList& files );
+    void exportPrepared( int bundles, int files );
+    void exportSkipped( const QString& path, const QString& reason );
+    void exportProgress( int done, int total );
+    void exportFinished( int written, int failed, bool cancelled );
 
     /*!
       Transform the given MIDI data list to text (HEX) and save using the 
@@ -233,6 +294,8 @@ private slots:
     void midiDataOutToConHandler(const DcMidiData &data);
 
     void on_actionShow_Log_triggered();
+    void on_actionShow_Library_triggered();
+    void on_workListFilter_textChanged(const QString& text);
 
 private:
     
@@ -254,22 +317,36 @@ private:
     void updateWorkListFromDeviceList();
 
     /*!
-      Method is given a ref to the device details var and updates the object
-      with the basic identity information contained in the Identify response data
-      received in response to an MIDI identity request.
+      Return the effect type contain in the given 
+      preset MIDI data.
     */ 
-    bool updateDeviceDetails( const DcMidiData &data,DcDeviceDetails& details );
+    QString getEffectType( const DcMidiData &data);
 
     /*!
-      Method will modify the given "partially initialized" details object
-      with further, family specific, Strymon MIDI device configuration.
+      Puts the given preset in the work list at row, renumbered for that
+      slot.  Returns true if the work list changed.
     */ 
-    void setFamilyDetails( DcDeviceDetails &details );
+    bool replaceWorklistPreset( int row,DcMidiData md );
+
     /*!
-      Return the effect type contain in the given 
-      preset MIDI data.
+      Brings the work list search index up to date with _workListData and
+      re-applies the work list filter.  Only changed rows are re-indexed.
     */ 
-    QString getEffectType( const DcMidiData &data);
+    void updateWorklistSearch();
+    void applyWorklistFilter();
+
+    /*!
+      Loads the preset library index and adds the backup folders to it,
+      the first time the library is used.
+    */ 
+    void initPresetLibrary();
+
+    /*!
+      Fills the query column store from the work list (wl), device list (dl),
+      the library (lib) or a folder.  Files are only read again when the
+      source, the library index or a file in the folder changes.
+    */
+    bool loadPresetColumns( const QString& source );
     
     /*!
       Returns true if the given string is a valid Bank/PresetNum
@@ -286,7 +363,7 @@ private:
     /*!
       Translate the list of patch files to the current devices bank/patch name format      
     */ 
-    QStringList presetListToBankPatchName(QList<DcMidiData>& listData);
+    QStringList presetListToBankPatchName(const DcPresetBank& listData);
 
     /*!
       For the given linear preset number, return a string that represents its
@@ -299,6 +376,12 @@ private:
 
     quint16 getPresetNumber( const DcMidiData &preset );
 
+    /*!
+      Returns true if the preset read back from the device has the same
+      number, checksum and name as the preset that was written.
+    */
+    bool readbackMatches( const DcMidiData &written, const DcMidiData &readback );
+
     QString presetToName(DcMidiData& p);
 
     QString presetToBankPatchName(DcMidiData& p);
@@ -312,9 +395,22 @@ private:
     // Compares the device and work lists, updates the dirtyItems
     // list and decorates the work list names if found different.
     // Will also generate WorkListIsDifferntThanDeviceListEvent and
-    // WorkListIsSameAsDeviceListEvent.
+    // WorkListIsSameAsDeviceListEvent.  Rescans every row, use
+    // worklistRowsChanged() after an edit.
     bool checkSyncState();
 
+    // Posts the sync state event for the current dirty rows
+    bool postSyncState();
+
+    /*!
+      Call after rows of _workListData were changed in place.  Only those
+      rows are compared with the device list and redrawn.
+    */
+    void worklistRowsChanged( const QList<int>& rows );
+
+    // Tooltip for a modified work list row, what changed since the fetch
+    QString worklistRowToolTip( int row );
+
     /*!
       Update the worklist view by transforming the worklist data
       into the correct ListBox item strings.
@@ -368,12 +464,25 @@ private:
     // Preset Data transfer helper objects
     DcXferMachine _xferInMachine;
     DcXferMachine _xferOutMachine;
+    DcXferMachine _xferVerifyMachine;
+
+    // Verify-after-write: presets written and awaiting readback, and the
+    // number of rewrite passes made for the current sync
+    static const int kMaxVerifyRewrites = 2;
+    bool _verifyWrites;
+
+    // Search every port pair when the saved MIDI ports don't answer
+    bool _autoDiscover;
+    int _verifyPass;
+    QList<DcMidiData> _verifyPending;
 
 
     // MOVED TO PEDAL CLASS
-    QList<DcMidiData>     _deviceListData;
-    QList<DcMidiData>     _workListData;
-    QList<int>      _dirtyItemsIndex;
+    DcPresetBank          _deviceListData;
+    DcPresetBank          _workListData;
+    DcDirtyTracker  _dirtyRows;
+    DcPresetListModel* _deviceListModel;
+    DcPresetListModel* _workListModel;
     unsigned int _workListDataDeviceUid; // The device from which the data was received
     // MIDI IO Stuff
     DcMidiIn           _midiIn;
@@ -402,6 +511,13 @@ private:
     QString _dataPath;
     QString _updatesPath;
     bool _backupEnabled;
+    bool _backupDedup;
+    bool _backupCompress;
+    DcBackupStore _backupStore;
+    DcBackupWriter _backupWriter;
+    DcPresetExporter _exporter;
+    QElapsedTimer _exportTimer;
+    QString _exportWhat;
 
     QStringList _styleHistory;
 
@@ -415,6 +531,17 @@ private:
 
 
     int         _maxMsgSize;
+    DcRetryBackoff _retryBackoff;
+
+    DcMultiDeviceSession* _multiSession;
+    DcPresetIndex _presetIndex;
+    DcTrigramIndex _worklistSearch;
+    DcPresetColumns _presetColumns;
+    QString _presetColumnsSource;
+    QByteArray _presetColumnsStamp;
+    DcPresetLibraryDialog* _libraryDlg;
+    bool _presetIndexLoaded;
+    DcDeviceSession::Op _multiOp;
     int         _delayPerMsgChunk;
     
     //DcPortNamePairList_t _tstDevList;
@@ -432,10 +559,14 @@ protected:
     bool sendAndWait( DcMidiData& md,const QString& cmd,const QString& waitForData,int timeout );
     bool savePresetBinary( const QString &fileName,const QList<DcMidiData>& dataList );
     bool savePresetBinary(const QString &fileName,const DcMidiData& md);
+    bool savePresetBinary(const QString &fileName,const DcPresetBank& bank);
     bool loadPresetBinary(const QString &fileName,QList<DcMidiData>& dataList);
     bool loadPresetBinary( const QString &fileName,DcMidiData& md );
+    bool loadPresetBinary( const QString &fileName,DcPresetBank& bank );
+    bool appendCheckedPresets( const QList<DcMidiData>& presets,QList<DcMidiData>& dataList );
     void backupDeviceList();
     void backupWorklist();
+    bool writeBackup( const QString& basePath,const QList<DcMidiData>& dataList );
     
     bool loadSysexFile( const QString &fileName,QList<DcMidiData>& dataList, QList<DcMidiData>* pRejectDataList  = 0 );
     bool hasDevSupport( const DcMidiData &data );
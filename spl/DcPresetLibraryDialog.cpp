@@ -0,0 +1,129 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetLibraryDialog.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QMessageBox>
+#include <QApplication>
+
+//-------------------------------------------------------------------------
+DcPresetLibraryDialog::DcPresetLibraryDialog( DcPresetIndex* index, QWidget* parent /*= 0*/ )
+    : QDialog(parent),_index(index)
+{
+    setWindowTitle( "Preset Library" );
+    resize( 720,480 );
+
+    _filter = new QLineEdit( this );
+    _filter->setPlaceholderText( "Search name, effect type, device or location" );
+
+    QPushButton* rescanButton = new QPushButton( "Rescan",this );
+
+    QHBoxLayout* top = new QHBoxLayout();
+    top->addWidget( _filter );
+    top->addWidget( rescanButton );
+
+    _tree = new QTreeWidget( this );
+    _tree->setRootIsDecorated( false );
+    _tree->setUniformRowHeights( true );
+    _tree->setHeaderLabels( QStringList() << "Name" << "Type" << "Device" << "Location" << "Copies" << "Last Seen" << "File" );
+    _tree->header()->setSectionResizeMode( QHeaderView::ResizeToContents );
+
+    _status = new QLabel( this );
+
+    QVBoxLayout* layout = new QVBoxLayout( this );
+    layout->addLayout( top );
+    layout->addWidget( _tree );
+    layout->addWidget( _status );
+
+    connect( _filter,SIGNAL(textChanged(const QString&)),this,SLOT(filterChanged(const QString&)) );
+    connect( rescanButton,SIGNAL(clicked()),this,SLOT(rescan()) );
+    connect( _tree,SIGNAL(itemActivated(QTreeWidgetItem*,int)),this,SLOT(itemActivated(QTreeWidgetItem*,int)) );
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLibraryDialog::rescan()
+{
+    _status->setText( "Scanning..." );
+    QApplication::processEvents();
+
+    int changed = _index->update();
+    if( changed )
+    {
+        _index->save();
+    }
+    filterChanged( _filter->text() );
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLibraryDialog::filterChanged( const QString& text )
+{
+    QElapsedTimer t;
+    t.start();
+    _hits = text.trimmed().isEmpty() ? _index->find( QString() ) : _index->fuzzyFind( text,500 );
+    qint64 ms = t.elapsed();
+
+    _tree->setUpdatesEnabled( false );
+    _tree->clear();
+
+    QList<QTreeWidgetItem*> items;
+    for( int idx = 0; idx < _hits.size(); idx++ )
+    {
+        const DcPresetIndexHit& h = _hits.at( idx );
+        QTreeWidgetItem* item = new QTreeWidgetItem();
+        item->setText( 0,h.Entry.Name );
+        item->setText( 1,h.Entry.EffectType );
+        item->setText( 2,h.Entry.Device );
+        item->setText( 3,h.Entry.Location );
+        item->setText( 4,QString::number( h.Copies ) );
+        item->setText( 5,QDateTime::fromMSecsSinceEpoch( h.MTime ).toString( "yyyy-MM-dd hh:mm" ) );
+        item->setText( 6,QFileInfo( h.Path ).fileName() );
+        item->setToolTip( 6,h.Path );
+        item->setData( 0,Qt::UserRole,idx );
+        items.append( item );
+    }
+    _tree->addTopLevelItems( items );
+    _tree->setUpdatesEnabled( true );
+
+    _status->setText( QString( "%1 presets in %2 files, %3 shown (%4 ms)" )
+        .arg( _index->presetCount() ).arg( _index->fileCount() ).arg( _hits.size() ).arg( ms ) );
+}
+
+//-------------------------------------------------------------------------
+void DcPresetLibraryDialog::itemActivated( QTreeWidgetItem* item, int /*column*/ )
+{
+    int idx = item->data( 0,Qt::UserRole ).toInt();
+    if( idx < 0 || idx >= _hits.size() )
+    {
+        return;
+    }
+
+    DcMidiData md;
+    if( !_index->loadPreset( _hits.at( idx ),md ) )
+    {
+        QMessageBox::warning( this,"Preset Library",_index->getLastErrorString() );
+        return;
+    }
+    emit presetActivated( md );
+}
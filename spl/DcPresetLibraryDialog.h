@@ -0,0 +1,58 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetLibraryDialog.h
+ \brief Library pane for browsing and searching the preset index.
+ Activating a preset hands a copy of it to the work list.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QDialog>
+#include <QList>
+#include "DcPresetIndex.h"
+
+class QLineEdit;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QLabel;
+
+class DcPresetLibraryDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    DcPresetLibraryDialog( DcPresetIndex* index, QWidget* parent = 0 );
+
+signals:
+    void presetActivated( const DcMidiData& md );
+
+public slots:
+    /*!
+      Rescans the library folders and re-runs the current search.
+    */
+    void rescan();
+
+private slots:
+    void filterChanged( const QString& text );
+    void itemActivated( QTreeWidgetItem* item, int column );
+
+private:
+    DcPresetIndex* _index;
+    QLineEdit* _filter;
+    QTreeWidget* _tree;
+    QLabel* _status;
+    QList<DcPresetIndexHit> _hits;
+};
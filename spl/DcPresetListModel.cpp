@@ -0,0 +1,170 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetListModel.h"
+#include "DcDirtyTracker.h"
+#include <QFont>
+#include <QBrush>
+
+//-------------------------------------------------------------------------
+DcPresetListModel::DcPresetListModel( QObject* parent )
+    : QAbstractListModel( parent ),_presets( 0 ),_dirty( 0 ),_count( 0 )
+{
+}
+
+//-------------------------------------------------------------------------
+void DcPresetListModel::setPresets( const DcPresetBank* presets )
+{
+    _presets = presets;
+    reset();
+}
+
+//-------------------------------------------------------------------------
+void DcPresetListModel::reset()
+{
+    beginResetModel();
+    _count = _presets ? _presets->length() : 0;
+    _labels.clear();
+    _labels.resize( _count );
+    endResetModel();
+}
+
+//-------------------------------------------------------------------------
+void DcPresetListModel::clear()
+{
+    beginResetModel();
+    _count = 0;
+    _labels.clear();
+    endResetModel();
+}
+
+//-------------------------------------------------------------------------
+void DcPresetListModel::rowsChanged( QList<int> rows )
+{
+    qSort( rows );
+
+    int first = -1;
+    int last = -1;
+    foreach(int row,rows)
+    {
+        if(row < 0 || row >= _count)
+        {
+            continue;
+        }
+        _labels[row] = QString();
+
+        if(first != -1 && row > last + 1)
+        {
+            emit dataChanged( index( first ),index( last ) );
+            first = -1;
+        }
+        if(first == -1)
+        {
+            first = row;
+        }
+        last = row;
+    }
+
+    if(first != -1)
+    {
+        emit dataChanged( index( first ),index( last ) );
+    }
+}
+
+//-------------------------------------------------------------------------
+QString DcPresetListModel::label( int row ) const
+{
+    if(row < 0 || row >= _count || row >= _presets->length())
+    {
+        return QString();
+    }
+
+    QString& cached = _labels[row];
+    if(cached.isNull())
+    {
+        DcMidiData md = _presets->at( row );
+        cached = _labelFn ? _labelFn( md ) : md.toString();
+    }
+    return cached;
+}
+
+//-------------------------------------------------------------------------
+int DcPresetListModel::rowCount( const QModelIndex& parent ) const
+{
+    return parent.isValid() ? 0 : _count;
+}
+
+//-------------------------------------------------------------------------
+QVariant DcPresetListModel::data( const QModelIndex& index,int role ) const
+{
+    int row = index.row();
+    if(!index.isValid() || row >= _count || row >= _presets->length())
+    {
+        return QVariant();
+    }
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return label( row );
+
+    case Qt::FontRole:
+        if(isDirty( row ))
+        {
+            QFont font;
+            font.setItalic( true );
+            return font;
+        }
+        break;
+
+    case Qt::ForegroundRole:
+        if(isDirty( row ))
+        {
+            return QBrush( Qt::red );
+        }
+        break;
+
+    case Qt::ToolTipRole:
+        if(isDirty( row ) && _toolTipFn)
+        {
+            return _toolTipFn( row );
+        }
+        break;
+
+    case PresetRole:
+        return _presets->at( row ).toByteArray();
+
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+//-------------------------------------------------------------------------
+Qt::ItemFlags DcPresetListModel::flags( const QModelIndex& index ) const
+{
+    if(!index.isValid())
+    {
+        return Qt::ItemIsDropEnabled;
+    }
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled;
+}
+
+//-------------------------------------------------------------------------
+bool DcPresetListModel::isDirty( int row ) const
+{
+    return _dirty && _dirty->isDirty( row );
+}
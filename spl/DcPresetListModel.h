@@ -0,0 +1,93 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetListModel.h
+ \brief List model over a preset list, shared by the device list and the
+ work list views.  Row labels are built on first use and cached, edits
+ invalidate just the changed rows.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <functional>
+#include <QAbstractListModel>
+#include <QList>
+#include <QVector>
+#include <QString>
+#include "DcPresetBank.h"
+
+class DcDirtyTracker;
+
+class DcPresetListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<QString( const DcMidiData& )> LabelFunction;
+    typedef std::function<QString( int )> ToolTipFunction;
+
+    enum Roles
+    {
+        PresetRole = Qt::UserRole + 1
+    };
+
+    explicit DcPresetListModel( QObject* parent = 0 );
+
+    /*!
+      The list shown by the model, it must outlive the model.  Call reset()
+      after the list is replaced.
+    */
+    void setPresets( const DcPresetBank* presets );
+
+    /*!
+      Rows marked dirty by the tracker are drawn italic and red and get a
+      tooltip from the tooltip function.
+    */
+    void setDirtyTracker( const DcDirtyTracker* dirty ) { _dirty = dirty; }
+    void setLabelFunction( LabelFunction fn ) { _labelFn = fn; }
+    void setToolTipFunction( ToolTipFunction fn ) { _toolTipFn = fn; }
+
+    /*!
+      Re-reads the row count and drops every cached label.
+    */
+    void reset();
+
+    /*!
+      Shows no rows until the next reset().
+    */
+    void clear();
+
+    /*!
+      Drops the cached labels of the given rows and emits dataChanged for
+      each run of adjacent rows.
+    */
+    void rowsChanged( QList<int> rows );
+
+    QString label( int row ) const;
+
+    int rowCount( const QModelIndex& parent = QModelIndex() ) const;
+    QVariant data( const QModelIndex& index,int role = Qt::DisplayRole ) const;
+    Qt::ItemFlags flags( const QModelIndex& index ) const;
+
+private:
+    bool isDirty( int row ) const;
+
+    const DcPresetBank* _presets;
+    const DcDirtyTracker* _dirty;
+    LabelFunction _labelFn;
+    ToolTipFunction _toolTipFn;
+    int _count;
+    mutable QVector<QString> _labels;
+};
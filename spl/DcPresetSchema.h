@@ -0,0 +1,226 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetSchema.h
+ \brief Preset layout for each supported device, as constexpr tables.
+ The product byte of the sysex header selects the table directly, so
+ field reads are a table lookup plus an offset, with no regex or string
+ work.  DcPresetRef gives typed access to the fields of one preset.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+
+namespace DcPresetSchema
+{
+    enum Field
+    {
+        Number,         // 14 bit preset number
+        EffectType,     // machine / reverb type
+        Data,           // checksummed region, holds the type, parameters and name
+        Name,           // space padded ASCII
+        Checksum,       // 7 bit sum of Data
+        FieldCount
+    };
+
+    struct FieldDef
+    {
+        const char* Name;
+        quint16 Offset;
+        quint16 Width;
+    };
+
+    struct Layout
+    {
+        const char* Device;
+        quint8  Product;
+        quint16 Size;
+        quint16 PresetCount;
+        quint8  PresetsPerBank;
+        FieldDef Fields[FieldCount];
+        const char* const* EffectTypes;     // indexed by the EffectType byte, 0 if unknown
+        quint8  EffectTypeCount;
+
+        constexpr quint16 offset( Field f ) const { return Fields[f].Offset; }
+        constexpr quint16 width( Field f ) const { return Fields[f].Width; }
+        constexpr quint16 end( Field f ) const { return Fields[f].Offset + Fields[f].Width; }
+
+        /*!
+          Parameters are the checksummed data less the type byte and name.
+        */
+        constexpr quint16 paramsBegin() const { return end( EffectType ); }
+        constexpr quint16 paramsEnd() const { return offset( Name ); }
+    };
+
+    // F0 00 01 55 12 <product> <command>
+    constexpr int     kHeaderLen        = 6;
+    constexpr int     kFamilyOffset     = 4;
+    constexpr int     kProductOffset    = 5;
+    constexpr int     kCommandOffset    = 6;
+    constexpr quint8  kFamily           = 0x12;
+    constexpr quint8  kPresetWriteCmd   = 0x62;
+
+    constexpr const char* kBigSkyEffectTypes[] =
+    {
+        "Bloom","Cloud","Chorale","Shimmer","Magneto","Nonlinear",
+        "Reflection","Room","Hall","Plate","Spring","Swell"
+    };
+
+    // Every current firmware shares the same 650 byte preset layout
+    constexpr Layout kLayouts[] =
+    {
+        { "TimeLine",0x01,650,200,2,
+          { { "number",7,2 },{ "effect type",9,1 },{ "data",9,639 },{ "name",632,16 },{ "checksum",648,1 } },
+          0,0 },
+        { "Mobius",0x02,650,200,2,
+          { { "number",7,2 },{ "effect type",9,1 },{ "data",9,639 },{ "name",632,16 },{ "checksum",648,1 } },
+          0,0 },
+        { "Big Sky",0x03,650,300,3,
+          { { "number",7,2 },{ "effect type",9,1 },{ "data",9,639 },{ "name",632,16 },{ "checksum",648,1 } },
+          kBigSkyEffectTypes,sizeof( kBigSkyEffectTypes ) / sizeof( kBigSkyEffectTypes[0] ) }
+    };
+
+    constexpr int kLayoutCount = sizeof( kLayouts ) / sizeof( kLayouts[0] );
+
+    static_assert( kLayouts[0].end( Checksum ) < 650,"checksum must be inside the preset" );
+    static_assert( kLayouts[2].end( Name ) <= kLayouts[2].offset( Checksum ),"name must precede the checksum" );
+
+    /*!
+      Layout used when the device is not known yet.
+    */
+    inline const Layout& defaultLayout() { return kLayouts[0]; }
+
+    /*!
+      Layout for a product byte, 0 for an unknown product.
+    */
+    inline const Layout* forProduct( quint8 product )
+    {
+        return (product >= 1 && product <= kLayoutCount) ? &kLayouts[product - 1] : 0;
+    }
+
+    /*!
+      Layout for a device name as reported by the identity reply.
+    */
+    inline const Layout* forDevice( const QString& name )
+    {
+        for (int idx = 0; idx < kLayoutCount; idx++)
+        {
+            if(name == QLatin1String( kLayouts[idx].Device ))
+            {
+                return &kLayouts[idx];
+            }
+        }
+        return 0;
+    }
+
+    /*!
+      Layout for a Strymon sysex message, from its header bytes.
+    */
+    inline const Layout* forMessage( const QByteArray& msg )
+    {
+        if(msg.length() <= kCommandOffset ||
+           (uchar)msg.at( 0 ) != 0xF0 || msg.at( 1 ) != 0x00 || msg.at( 2 ) != 0x01 || msg.at( 3 ) != 0x55 ||
+           (uchar)msg.at( kFamilyOffset ) != kFamily)
+        {
+            return 0;
+        }
+        return forProduct( (quint8)msg.at( kProductOffset ) );
+    }
+}
+
+/*!
+  Typed, read only access to the fields of one preset.  Holds a shallow
+  copy of the bytes.
+*/
+class DcPresetRef
+{
+public:
+    explicit DcPresetRef( const QByteArray& preset )
+        : _data( preset ),_layout( DcPresetSchema::forMessage( preset ) ) {}
+
+    /*!
+      True for a complete preset write message of a known device.
+    */
+    bool isValid() const
+    {
+        return _layout && _data.length() == _layout->Size &&
+               (uchar)_data.at( DcPresetSchema::kCommandOffset ) == DcPresetSchema::kPresetWriteCmd;
+    }
+
+    const DcPresetSchema::Layout* layout() const { return _layout; }
+    const QByteArray& bytes() const { return _data; }
+
+    const uchar* field( DcPresetSchema::Field f ) const
+    {
+        return reinterpret_cast<const uchar*>( _data.constData() ) + _layout->offset( f );
+    }
+
+    int number() const
+    {
+        const uchar* p = field( DcPresetSchema::Number );
+        return (p[0] << 7) + p[1];
+    }
+
+    quint8 effectType() const { return *field( DcPresetSchema::EffectType ); }
+
+    /*!
+      Name of the effect type, "Unknown" when the device has no table.
+    */
+    QString effectTypeName() const
+    {
+        quint8 type = effectType();
+        return (_layout->EffectTypes && type < _layout->EffectTypeCount) ?
+            QString( QLatin1String( _layout->EffectTypes[type] ) ) : QString( "Unknown" );
+    }
+
+    QString name() const
+    {
+        return QString::fromLatin1( (const char*)field( DcPresetSchema::Name ),_layout->width( DcPresetSchema::Name ) ).trimmed();
+    }
+
+    quint8 checksum() const { return *field( DcPresetSchema::Checksum ); }
+
+    /*!
+      Checksum computed over the data region.
+    */
+    quint8 computeChecksum() const
+    {
+        const uchar* p = field( DcPresetSchema::Data );
+        const uchar* end = p + _layout->width( DcPresetSchema::Data );
+        unsigned int accum = 0;
+        while(p < end)
+        {
+            accum += *p++ & 0x7F;
+        }
+        return accum & 0x7F;
+    }
+
+    /*!
+      Bank and preset, e.g. "12B".
+    */
+    QString location() const
+    {
+        int n = number();
+        int perBank = _layout->PresetsPerBank;
+        return QString( "%1%2" ).arg( n / perBank,2,10,QChar( '0' ) ).arg( QChar( 'A' + n % perBank ) );
+    }
+
+private:
+    QByteArray _data;
+    const DcPresetSchema::Layout* _layout;
+};
@@ -0,0 +1,317 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcPresetSimilarity.h"
+#include <QHash>
+#include <QMap>
+#include <string.h>
+
+namespace
+{
+    //-------------------------------------------------------------------------
+    quint64 hashBytes( const uchar* p,const int* pos,int count,quint64 seed )
+    {
+        // FNV-1a over the selected byte positions
+        quint64 h = 14695981039346656037ULL ^ seed;
+        for (int idx = 0; idx < count; idx++)
+        {
+            h ^= p[pos[idx]];
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    //-------------------------------------------------------------------------
+    int paramsEnd( const DcPresetLayout& layout )
+    {
+        // Parameters run from the start of the data up to the name
+        return qMin( layout.NameOffset,layout.DataOffset + layout.DataLength );
+    }
+}
+
+//-------------------------------------------------------------------------
+DcPresetSimilarity::DcPresetSimilarity()
+    : _comparisons( 0 ),_splitBuckets( 0 )
+{
+}
+
+//-------------------------------------------------------------------------
+int DcPresetSimilarity::paramDiff( const DcMidiData& a,const DcMidiData& b ) const
+{
+    const QByteArray& ba = a.toByteArray();
+    const QByteArray& bb = b.toByteArray();
+    const DcPresetSchema::Layout* schema = DcPresetSchema::forMessage( ba );
+    DcPresetLayout layout = schema ? DcPresetLayout( *schema ) : DcPresetLayout();
+    int begin = layout.DataOffset;
+    int end = paramsEnd( layout );
+    if(ba.length() < end || bb.length() < end || DcPresetSchema::forMessage( bb ) != schema)
+    {
+        return end - begin;
+    }
+
+    int diff = 0;
+    for (int idx = begin; idx < end; idx++)
+    {
+        diff += (ba.at( idx ) != bb.at( idx ));
+    }
+    return diff;
+}
+
+//-------------------------------------------------------------------------
+QList<DcPresetSimilarity::Cluster> DcPresetSimilarity::find( const QList<DcMidiData>& presets,int maxDiff )
+{
+    int count = presets.length();
+    _parent.resize( count );
+    _maxDiff.fill( 0,count );
+    for (int idx = 0; idx < count; idx++)
+    {
+        _parent[idx] = idx;
+    }
+    _comparisons = 0;
+    _splitBuckets = 0;
+
+    // Only complete presets of a known device take part, and each device
+    // layout is searched on its own
+    QList<int> usable;
+    QMap<const DcPresetSchema::Layout*,QList<int> > byLayout;
+    for (int idx = 0; idx < count; idx++)
+    {
+        const QByteArray& ba = presets.at( idx ).toByteArray();
+        const DcPresetSchema::Layout* schema = DcPresetSchema::forMessage( ba );
+        if(schema && ba.length() >= schema->Size)
+        {
+            usable.append( idx );
+            byLayout[schema].append( idx );
+        }
+    }
+
+    QMap<const DcPresetSchema::Layout*,QList<int> >::const_iterator it;
+    for (it = byLayout.constBegin(); it != byLayout.constEnd(); ++it)
+    {
+        findInLayout( presets,it.value(),DcPresetLayout( *it.key() ),maxDiff );
+    }
+
+    // Collect the groups with more than one member
+    QMap<int,Cluster> byRoot;
+    foreach(int idx,usable)
+    {
+        int root = rootOf( idx );
+        Cluster& c = byRoot[root];
+        c.Members.append( idx );
+        c.MaxDiff = _maxDiff.at( root );
+    }
+
+    QList<Cluster> clusters;
+    foreach(const Cluster& c,byRoot)
+    {
+        if(c.Members.length() > 1)
+        {
+            clusters.append( c );
+        }
+    }
+    return clusters;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetSimilarity::findInLayout( const QList<DcMidiData>& presets,const QList<int>& usable,
+                                       const DcPresetLayout& layout,int maxDiff )
+{
+    int begin = layout.DataOffset;
+    int end = paramsEnd( layout );
+
+    // Device header, preset data and the effect type all live in these
+    QVector<int> keyPos;
+    for (int pos = 0; pos < layout.NumberOffset; pos++)
+    {
+        keyPos.append( pos );
+    }
+    QVector<int> paramPos;
+    for (int pos = begin; pos < end; pos++)
+    {
+        paramPos.append( pos );
+    }
+
+    // Exact copies, one representative of each goes on to the near search
+    QHash<QPair<quint64,quint64>,int> exact;
+    QList<int> reps;
+    foreach(int idx,usable)
+    {
+        const uchar* p = reinterpret_cast<const uchar*>( presets.at( idx ).toByteArray().constData() );
+        QPair<quint64,quint64> key( hashBytes( p,keyPos.constData(),keyPos.size(),0 ),
+                                    hashBytes( p,paramPos.constData(),paramPos.size(),0 ) );
+        QHash<QPair<quint64,quint64>,int>::const_iterator it = exact.constFind( key );
+        if(it != exact.constEnd() && paramDiff( presets.at( it.value() ),presets.at( idx ) ) == 0)
+        {
+            unite( it.value(),idx,0 );
+        }
+        else
+        {
+            exact.insert( key,idx );
+            reps.append( idx );
+        }
+    }
+
+    if(maxDiff > 0 && reps.length() > 1)
+    {
+        // Bytes that never change carry no information, band over the rest
+        QByteArray first = presets.at( reps.first() ).toByteArray();
+        QVector<bool> varies( end,false );
+        foreach(int idx,reps)
+        {
+            const QByteArray& ba = presets.at( idx ).toByteArray();
+            for (int pos = begin; pos < end; pos++)
+            {
+                if(ba.at( pos ) != first.at( pos ))
+                {
+                    varies[pos] = true;
+                }
+            }
+        }
+        QVector<int> varying;
+        for (int pos = begin; pos < end; pos++)
+        {
+            if(varies.at( pos ))
+            {
+                varying.append( pos );
+            }
+        }
+
+        int bands = qMin( maxDiff + 1,qMax( 1,varying.size() ) );
+        for (int band = 0; band < bands; band++)
+        {
+            int from = varying.size() * band / bands;
+            int to = varying.size() * (band + 1) / bands;
+
+            QHash<QPair<quint64,quint64>,QList<int> > buckets;
+            foreach(int idx,reps)
+            {
+                const uchar* p = reinterpret_cast<const uchar*>( presets.at( idx ).toByteArray().constData() );
+                QPair<quint64,quint64> key( hashBytes( p,keyPos.constData(),keyPos.size(),band ),
+                                            hashBytes( p,varying.constData() + from,to - from,band ) );
+                buckets[key].append( idx );
+            }
+
+            // Members already match on this band, any difference is elsewhere
+            QVector<int> rest = varying.mid( 0,from ) + varying.mid( to );
+            foreach(const QList<int>& bucket,buckets)
+            {
+                if(bucket.length() >= 2)
+                {
+                    compareBucket( presets,bucket,rest,maxDiff,band );
+                }
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcPresetSimilarity::compareBucket( const QList<DcMidiData>& presets,const QList<int>& bucket,
+                                        const QVector<int>& positions,int maxDiff,quint64 seed )
+{
+    // Only bytes that differ inside the bucket can split it
+    QVector<int> varying;
+    if(bucket.length() > kMaxBucket)
+    {
+        const QByteArray& first = presets.at( bucket.first() ).toByteArray();
+        foreach(int pos,positions)
+        {
+            foreach(int idx,bucket)
+            {
+                if(presets.at( idx ).toByteArray().at( pos ) != first.at( pos ))
+                {
+                    varying.append( pos );
+                    break;
+                }
+            }
+        }
+    }
+
+    if(varying.isEmpty())
+    {
+        for (int i = 0; i < bucket.length(); i++)
+        {
+            for (int j = i + 1; j < bucket.length(); j++)
+            {
+                if(rootOf( bucket.at( i ) ) == rootOf( bucket.at( j ) ))
+                {
+                    continue;
+                }
+                _comparisons++;
+                int diff = paramDiff( presets.at( bucket.at( i ) ),presets.at( bucket.at( j ) ) );
+                if(diff <= maxDiff)
+                {
+                    unite( bucket.at( i ),bucket.at( j ),diff );
+                }
+            }
+        }
+        return;
+    }
+
+    // Same pigeonhole split as find(), each level drops at least one byte
+    _splitBuckets++;
+    seed = seed * 31 + 1;
+    int bands = qMin( maxDiff + 1,varying.size() );
+    for (int band = 0; band < bands; band++)
+    {
+        int from = varying.size() * band / bands;
+        int to = varying.size() * (band + 1) / bands;
+
+        QHash<quint64,QList<int> > buckets;
+        foreach(int idx,bucket)
+        {
+            const uchar* p = reinterpret_cast<const uchar*>( presets.at( idx ).toByteArray().constData() );
+            buckets[hashBytes( p,varying.constData() + from,to - from,seed + band )].append( idx );
+        }
+
+        QVector<int> rest = varying.mid( 0,from ) + varying.mid( to );
+        foreach(const QList<int>& sub,buckets)
+        {
+            if(sub.length() >= 2)
+            {
+                compareBucket( presets,sub,rest,maxDiff,seed + band );
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+int DcPresetSimilarity::rootOf( int idx )
+{
+    while(_parent.at( idx ) != idx)
+    {
+        _parent[idx] = _parent.at( _parent.at( idx ) );
+        idx = _parent.at( idx );
+    }
+    return idx;
+}
+
+//-------------------------------------------------------------------------
+void DcPresetSimilarity::unite( int a,int b,int diff )
+{
+    int ra = rootOf( a );
+    int rb = rootOf( b );
+    int d = qMax( diff,qMax( _maxDiff.at( ra ),_maxDiff.at( rb ) ) );
+    if(ra != rb)
+    {
+        // The lower index stays the root so the first copy is kept on cleanup
+        if(rb < ra)
+        {
+            qSwap( ra,rb );
+        }
+        _parent[rb] = ra;
+    }
+    _maxDiff[ra] = d;
+}
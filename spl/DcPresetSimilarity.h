@@ -0,0 +1,86 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcPresetSimilarity.h
+ \brief Finds exact and near duplicate presets by comparing the parameter
+ region, from the start of the preset data to the name field.  Names,
+ numbers and checksums are ignored.  The region comes from the schema
+ layout of each preset's device.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QList>
+#include <QVector>
+#include "DcMidi/DcMidiData.h"
+#include "DcPresetDiff.h"
+
+class DcPresetSimilarity
+{
+public:
+
+    /*!
+      Presets that are copies of each other.  Members are indexes into the
+      list passed to find(), in ascending order.
+    */
+    struct Cluster
+    {
+        Cluster() : MaxDiff( 0 ) {}
+        bool isExact() const { return MaxDiff == 0; }
+
+        QList<int> Members;
+        int MaxDiff;        // most differing parameter bytes seen in a matched pair
+    };
+
+    // Buckets bigger than this are split again before comparing pairs
+    static const int kMaxBucket = 256;
+
+    DcPresetSimilarity();
+
+    /*!
+      Groups presets for the same device whose parameter regions differ in
+      at most maxDiff bytes, 0 finds exact duplicates only.
+
+      Exact copies are grouped by hash first.  For near copies the bytes
+      that vary anywhere in the set are split into maxDiff + 1 bands, two
+      presets within maxDiff bytes of each other must have one identical
+      band, so only presets sharing a band hash are compared.  A bucket of
+      more than kMaxBucket presets is banded again over the bytes outside
+      its band, which keeps that guarantee while bounding the pairs.
+    */
+    QList<Cluster> find( const QList<DcMidiData>& presets,int maxDiff );
+
+    /*!
+      Number of differing bytes in the parameter region of a.  The whole
+      region counts as different when b is short or for another device.
+    */
+    int paramDiff( const DcMidiData& a,const DcMidiData& b ) const;
+
+    int comparisons() const { return _comparisons; }
+    int splitBuckets() const { return _splitBuckets; }
+
+private:
+    void findInLayout( const QList<DcMidiData>& presets,const QList<int>& usable,
+                       const DcPresetLayout& layout,int maxDiff );
+    void compareBucket( const QList<DcMidiData>& presets,const QList<int>& bucket,
+                        const QVector<int>& positions,int maxDiff,quint64 seed );
+    int rootOf( int idx );
+    void unite( int a,int b,int diff );
+
+    QVector<int> _parent;
+    QVector<int> _maxDiff;
+    int _comparisons;
+    int _splitBuckets;
+};
@@ -0,0 +1,148 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcSysexRejectFilter.h"
+#include <QQueue>
+
+//-------------------------------------------------------------------------
+DcSysexRejectFilter::DcSysexRejectFilter()
+{
+}
+
+//-------------------------------------------------------------------------
+void DcSysexRejectFilter::clear()
+{
+    _exact.clear();
+    _next.clear();
+    _hasOutput.clear();
+}
+
+//-------------------------------------------------------------------------
+void DcSysexRejectFilter::compile( const QList<DcMidiData>& patterns )
+{
+    clear();
+
+    QList<QByteArray> partial;
+    foreach( const DcMidiData& md,patterns )
+    {
+        QByteArray ba = md.toByteArray();
+        if( ba.isEmpty() )
+        {
+            continue;
+        }
+
+        // A whole message can only be contained in an identical message
+        if( ba.size() > 1 && (unsigned char)ba.at( 0 ) == 0xF0 &&
+            (unsigned char)ba.at( ba.size() - 1 ) == 0xF7 &&
+            !ba.mid( 1,ba.size() - 2 ).contains( (char)0xF0 ) &&
+            !ba.mid( 1,ba.size() - 2 ).contains( (char)0xF7 ) )
+        {
+            _exact.insert( ba );
+        }
+        else
+        {
+            partial.append( ba );
+        }
+    }
+
+    if( partial.isEmpty() )
+    {
+        return;
+    }
+
+    // Build the trie
+    _next.fill( -1,256 );
+    _hasOutput.fill( false,1 );
+    foreach( const QByteArray& ba,partial )
+    {
+        int state = 0;
+        for( int idx = 0; idx < ba.size(); idx++ )
+        {
+            int slot = state*256 + (unsigned char)ba.at( idx );
+            if( _next[slot] < 0 )
+            {
+                _next[slot] = _hasOutput.size();
+                _next.insert( _next.size(),256,-1 );
+                _hasOutput.append( false );
+            }
+            state = _next[slot];
+        }
+        _hasOutput[state] = true;
+    }
+
+    // Turn it into a DFA by following failure links breadth first
+    QVector<int> fail( _hasOutput.size(),0 );
+    QQueue<int> queue;
+    for( int c = 0; c < 256; c++ )
+    {
+        int& n = _next[c];
+        if( n < 0 )
+        {
+            n = 0;
+        }
+        else
+        {
+            queue.enqueue( n );
+        }
+    }
+
+    while( !queue.isEmpty() )
+    {
+        int state = queue.dequeue();
+        _hasOutput[state] = _hasOutput[state] || _hasOutput[fail[state]];
+
+        for( int c = 0; c < 256; c++ )
+        {
+            int& n = _next[state*256 + c];
+            if( n < 0 )
+            {
+                n = _next[fail[state]*256 + c];
+            }
+            else
+            {
+                fail[n] = _next[fail[state]*256 + c];
+                queue.enqueue( n );
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+bool DcSysexRejectFilter::rejects( const DcMidiData& md ) const
+{
+    if( !_exact.isEmpty() && _exact.contains( md.toByteArray() ) )
+    {
+        return true;
+    }
+
+    if( _hasOutput.isEmpty() )
+    {
+        return false;
+    }
+
+    const unsigned char* p = (const unsigned char*)md.data();
+    int len = md.length();
+    int state = 0;
+    for( int idx = 0; idx < len; idx++ )
+    {
+        state = _next[state*256 + p[idx]];
+        if( _hasOutput[state] )
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,57 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcSysexRejectFilter.h
+ \brief Reject filter for sysex file loading.  Filter patterns are compiled
+ once; complete F0..F7 messages go in a hash set and everything else in an
+ Aho-Corasick automaton, so each message is checked in a single pass no
+ matter how many patterns there are.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QSet>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+#include "DcMidi/DcMidiData.h"
+
+class DcSysexRejectFilter
+{
+public:
+
+    DcSysexRejectFilter();
+
+    /*!
+      Compiles the given patterns.  A message is rejected if it contains
+      any of them.  Empty patterns are ignored.
+    */
+    void compile( const QList<DcMidiData>& patterns );
+
+    void clear();
+    bool isEmpty() const { return _exact.isEmpty() && _hasOutput.isEmpty(); }
+
+    /*!
+      Returns true if md contains any of the compiled patterns.
+    */
+    bool rejects( const DcMidiData& md ) const;
+
+private:
+    QSet<QByteArray> _exact;
+
+    // Automaton, 256 transitions per state, state 0 is the root
+    QVector<int> _next;
+    QVector<bool> _hasOutput;
+};
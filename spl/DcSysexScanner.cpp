@@ -0,0 +1,164 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcSysexScanner.h"
+#include <string.h>
+
+//-------------------------------------------------------------------------
+DcSysexScanner::DcSysexScanner()
+    : _blockPos(0), _filePos(0)
+{
+}
+
+//-------------------------------------------------------------------------
+bool DcSysexScanner::open( const QString& fileName )
+{
+    close();
+
+    _file.setFileName( fileName );
+    if( !_file.open( QIODevice::ReadOnly ) )
+    {
+        _lastErrorString = "Unable to open the file: " + fileName;
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+void DcSysexScanner::close()
+{
+    if( _file.isOpen() )
+    {
+        _file.close();
+    }
+    _block.clear();
+    _blockPos = 0;
+    _filePos = 0;
+}
+
+//-------------------------------------------------------------------------
+bool DcSysexScanner::fillBlock()
+{
+    _block = _file.read( kBlockSize );
+    _blockPos = 0;
+    _filePos += _block.size();
+    return !_block.isEmpty();
+}
+
+//-------------------------------------------------------------------------
+bool DcSysexScanner::next( DcMidiData& md )
+{
+    while( true )
+    {
+        // Find the start of the next message
+        const char* sox = 0;
+        while( !sox )
+        {
+            if( _blockPos >= _block.size() && !fillBlock() )
+            {
+                return false;
+            }
+            const char* p = _block.constData() + _blockPos;
+            sox = (const char*)memchr( p,0xF0,_block.size() - _blockPos );
+            _blockPos = sox ? int( sox - _block.constData() ) : _block.size();
+        }
+
+        // Slice up to the F7, or a new F0, carrying over block boundaries
+        QByteArray msg;
+        bool done = false;
+        int start = _blockPos;
+        int idx = _blockPos + 1;
+
+        while( !done )
+        {
+            const char* p = _block.constData();
+            const char* end = p + _block.size();
+            const char* eox = (const char*)memchr( p + idx,0xF7,end - (p + idx) );
+            const char* nextSox = (const char*)memchr( p + idx,0xF0,(eox ? eox : end) - (p + idx) );
+
+            if( nextSox )
+            {
+                msg.append( p + start,int( nextSox - p ) - start );
+                msg.append( (char)0xF7 );
+                _blockPos = int( nextSox - p );
+                done = true;
+            }
+            else if( eox )
+            {
+                msg.append( p + start,int( eox - p ) - start + 1 );
+                _blockPos = int( eox - p ) + 1;
+                done = true;
+            }
+
+            if( !done )
+            {
+                msg.append( p + start,_block.size() - start );
+                if( !fillBlock() )
+                {
+                    // Unterminated message at the end of the file is dropped
+                    return false;
+                }
+                start = 0;
+                idx = 0;
+            }
+        }
+
+        md = msg;
+        if( !_rejectFilter.rejects( md ) )
+        {
+            return true;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcSysexScanner::setRejectList( const QList<DcMidiData>* pRejectDataList )
+{
+    if( pRejectDataList )
+    {
+        _rejectFilter.compile( *pRejectDataList );
+    }
+    else
+    {
+        _rejectFilter.clear();
+    }
+}
+
+//-------------------------------------------------------------------------
+bool DcSysexScanner::loadFile( const QString& fileName, QList<DcMidiData>& dataList,
+                               const QList<DcMidiData>* pRejectDataList, QString& errorMsg )
+{
+    DcSysexScanner scanner;
+    if( !scanner.open( fileName ) )
+    {
+        errorMsg = scanner.getLastErrorString();
+        return false;
+    }
+    scanner.setRejectList( pRejectDataList );
+
+    DcMidiData md;
+    while( scanner.next( md ) )
+    {
+        dataList.append( md );
+    }
+
+    if( dataList.count() == 0 )
+    {
+        errorMsg = fileName + " did not contain any MIDI data\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcSysexScanner.h
+ \brief Streaming F0..F7 message scanner for sysex files.  The file is read
+ in large blocks and message boundaries are found with memchr, so messages
+ can be handed out (and sent) while the rest of the file is still unread.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QFile>
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include "DcMidi/DcMidiData.h"
+#include "DcSysexRejectFilter.h"
+
+class DcSysexScanner
+{
+public:
+
+    static const int kBlockSize = 64*1024;
+
+    DcSysexScanner();
+
+    /*!
+      Opens the file, nothing is read until the first call to next().
+    */
+    bool open( const QString& fileName );
+    void close();
+
+    /*!
+      Messages containing any of the given patterns are skipped by next(),
+      pass 0 to disable filtering.
+    */
+    void setRejectList( const QList<DcMidiData>* pRejectDataList );
+
+    /*!
+      Returns the next message in md, or false at the end of the file.
+      An F0 inside a message terminates it with an F7.
+    */
+    bool next( DcMidiData& md );
+
+    /*!
+      File position of the scanner, for progress reporting.
+    */
+    qint64 pos() const { return _filePos - (_block.size() - _blockPos); }
+    qint64 size() const { return _file.size(); }
+
+    QString getLastErrorString() const { return _lastErrorString; }
+
+    /*!
+      Reads the whole file into dataList.  Returns false if the file can't
+      be opened or contains no messages.
+    */
+    static bool loadFile( const QString& fileName, QList<DcMidiData>& dataList,
+                          const QList<DcMidiData>* pRejectDataList, QString& errorMsg );
+
+private:
+    bool fillBlock();
+
+    QFile _file;
+    QByteArray _block;
+    int _blockPos;
+    qint64 _filePos;
+    DcSysexRejectFilter _rejectFilter;
+    QString _lastErrorString;
+};
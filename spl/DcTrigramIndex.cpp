@@ -0,0 +1,194 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcTrigramIndex.h"
+#include <algorithm>
+
+//-------------------------------------------------------------------------
+DcTrigramIndex::DcTrigramIndex()
+{
+}
+
+//-------------------------------------------------------------------------
+void DcTrigramIndex::clear()
+{
+    _docs.clear();
+    _postings.clear();
+    _counts.clear();
+}
+
+//-------------------------------------------------------------------------
+QByteArray DcTrigramIndex::normalize( const QString& text )
+{
+    return text.simplified().toLower().toLatin1();
+}
+
+//-------------------------------------------------------------------------
+void DcTrigramIndex::trigrams( const QByteArray& text, bool pad, QVector<quint32>& grams )
+{
+    grams.clear();
+    QByteArray t = pad ? (" " + text + " ") : text;
+    for( int idx = 0; idx + 2 < t.size(); idx++ )
+    {
+        const uchar* p = (const uchar*)t.constData() + idx;
+        grams.append( (quint32( p[0] ) << 16) | (quint32( p[1] ) << 8) | p[2] );
+    }
+    std::sort( grams.begin(),grams.end() );
+    grams.erase( std::unique( grams.begin(),grams.end() ),grams.end() );
+}
+
+//-------------------------------------------------------------------------
+void DcTrigramIndex::set( int id, const QString& text )
+{
+    QByteArray norm = normalize( text );
+    if( id < _docs.size() && _docs.at( id ).Text == norm && !norm.isEmpty() )
+    {
+        return;
+    }
+
+    remove( id );
+    if( id >= _docs.size() )
+    {
+        _docs.resize( id + 1 );
+    }
+
+    Doc& d = _docs[id];
+    d.Text = norm;
+    trigrams( norm,true,d.Grams );
+    foreach( quint32 g,d.Grams )
+    {
+        _postings[g].append( id );
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcTrigramIndex::remove( int id )
+{
+    if( id >= _docs.size() )
+    {
+        return;
+    }
+
+    Doc& d = _docs[id];
+    foreach( quint32 g,d.Grams )
+    {
+        QHash<quint32,QVector<int> >::iterator it = _postings.find( g );
+        if( it != _postings.end() )
+        {
+            it->removeOne( id );
+            if( it->isEmpty() )
+            {
+                _postings.erase( it );
+            }
+        }
+    }
+    d.Text.clear();
+    d.Grams.clear();
+}
+
+//-------------------------------------------------------------------------
+void DcTrigramIndex::truncate( int count )
+{
+    for( int id = _docs.size() - 1; id >= count; id-- )
+    {
+        remove( id );
+    }
+    if( count < _docs.size() )
+    {
+        _docs.resize( qMax( count,0 ) );
+    }
+}
+
+//-------------------------------------------------------------------------
+QList<DcTrigramIndex::Match> DcTrigramIndex::search( const QString& query, int limit ) const
+{
+    QList<Match> results;
+    QByteArray q = normalize( query );
+    if( q.isEmpty() )
+    {
+        return results;
+    }
+
+    QVector<Match> candidates;
+
+    if( q.size() < 3 )
+    {
+        // Too short for a trigram, only substrings can match
+        for( int id = 0; id < _docs.size(); id++ )
+        {
+            int pos = _docs.at( id ).Text.indexOf( q );
+            if( pos >= 0 )
+            {
+                Match m = { id,pos == 0 ? 1.5f : 1.0f };
+                candidates.append( m );
+            }
+        }
+    }
+    else
+    {
+        QVector<quint32> qgrams;
+        trigrams( q,false,qgrams );
+
+        _counts.fill( 0,_docs.size() );
+        QVector<int> touched;
+        foreach( quint32 g,qgrams )
+        {
+            QHash<quint32,QVector<int> >::const_iterator it = _postings.constFind( g );
+            if( it == _postings.constEnd() )
+            {
+                continue;
+            }
+            foreach( int id,it.value() )
+            {
+                if( _counts[id]++ == 0 )
+                {
+                    touched.append( id );
+                }
+            }
+        }
+
+        // Require half the query trigrams, so typos still match
+        int minShared = qMax( 1,qgrams.size()/2 );
+        foreach( int id,touched )
+        {
+            int shared = _counts.at( id );
+            const Doc& d = _docs.at( id );
+            int pos = d.Text.indexOf( q );
+            if( shared < minShared && pos < 0 )
+            {
+                continue;
+            }
+
+            float score = float( shared )/float( qgrams.size() + d.Grams.size() - shared );
+            if( pos >= 0 )
+            {
+                score += (pos == 0) ? 1.5f : 1.0f;
+            }
+            Match m = { id,score };
+            candidates.append( m );
+        }
+    }
+
+    int n = qMin( limit,candidates.size() );
+    std::partial_sort( candidates.begin(),candidates.begin() + n,candidates.end(),
+        []( const Match& a, const Match& b ) { return a.Score > b.Score || (a.Score == b.Score && a.Id < b.Id); } );
+
+    for( int idx = 0; idx < n; idx++ )
+    {
+        results.append( candidates.at( idx ) );
+    }
+    return results;
+}
@@ -0,0 +1,78 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcTrigramIndex.h
+ \brief Fuzzy text search over short strings such as preset names.
+ Documents are broken into character trigrams; a query scores each
+ document by trigram overlap, with a bonus for plain substring matches.
+ Documents are identified by small dense integers, e.g. a work list row.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QList>
+
+class DcTrigramIndex
+{
+public:
+
+    struct Match
+    {
+        int Id;
+        float Score;
+    };
+
+    DcTrigramIndex();
+
+    void clear();
+
+    /*!
+      Adds or replaces the text for id, unchanged text is not re-indexed.
+    */
+    void set( int id, const QString& text );
+    void remove( int id );
+
+    /*!
+      Removes every id >= count.
+    */
+    void truncate( int count );
+
+    int size() const { return _docs.size(); }
+
+    /*!
+      Returns up to limit matches, best first.
+    */
+    QList<Match> search( const QString& query, int limit ) const;
+
+private:
+    struct Doc
+    {
+        QByteArray Text;
+        QVector<quint32> Grams;
+    };
+
+    static QByteArray normalize( const QString& text );
+    static void trigrams( const QByteArray& text, bool pad, QVector<quint32>& grams );
+
+    QVector<Doc> _docs;
+    QHash<quint32,QVector<int> > _postings;
+
+    // Scratch space for search, sized to the document count
+    mutable QVector<quint16> _counts;
+};
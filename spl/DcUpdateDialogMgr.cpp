@@ -24,6 +24,7 @@
 #include "DcSoftwareUpdate.h"
 #include "DcUpdateAvailableDialog.h"
 #include "DcBootControl.h"
+#include "DcSysexScanner.h"
 #include "cmn/DcQUtils.h"
 #include "cmn/DcLog.h"
 
@@ -231,22 +232,29 @@ bool DcUpdateDialogMgr::installUpdate( DcSoftwareUpdate &pm,bool okToInstallPres
                     _progressDialog->setMessage("Loading Preset Update #" + QString("%1").arg(presetSet));
                     
                     QApplication::processEvents();
-                    if(!loadSysexFile(f,sysexList))
+
+                    // Presets are programmed as they are read from the file
+                    DcSysexScanner scanner;
+                    if(!scanner.open(f))
                     {
-                        DCLOG() << "failed reading preset file: "  << f << " - " << _lastErrorMsgStr;
+                        DCLOG() << "failed reading preset file: "  << f << " - " << scanner.getLastErrorString();
                         _installUpdateResult = DcUpdate_PresetUpdateFailure;
                         break;
                     }
 
                     _progressDialog->reset();
                     _progressDialog->setMessage("Preset Update " + QString(" %1 out of %2").arg(presetSet++).arg(_updateWl.presetSysexFileList.count()));
-                    _progressDialog->setMax(sysexList.count());
+                    _progressDialog->setMax(100);
                     QApplication::processEvents();
                     DCLOG() << "Programming preset data";
-                    for (int idx = 0; idx < sysexList.count() ; idx++)
+
+                    DcMidiData md;
+                    int presetCnt = 0;
+                    while(scanner.next(md))
                     {
-                    	_bootCtl->writeMidi(sysexList[idx]);
-                        _progressDialog->inc();
+                    	_bootCtl->writeMidi(md);
+                        presetCnt++;
+                        _progressDialog->setProgress(int(scanner.pos()*100/qMax(scanner.size(),qint64(1))));
                         if(_progressDialog->cancled())
                         {
                             DCLOG() << "Preset programming canceled";
@@ -255,6 +263,13 @@ bool DcUpdateDialogMgr::installUpdate( DcSoftwareUpdate &pm,bool okToInstallPres
                         QApplication::processEvents();
                         // TODO: on error set: _installUpdateResult = DcUpdate_PresetUpdateFailure;
                     }
+
+                    if(0 == presetCnt)
+                    {
+                        DCLOG() << "failed reading preset file: "  << f << " - did not contain any MIDI data";
+                        _installUpdateResult = DcUpdate_PresetUpdateFailure;
+                        break;
+                    }
                     
                 }
                 
@@ -390,6 +405,11 @@ bool DcUpdateDialogMgr::updateFirmware(QString fileName )
                                         _progressDialog->setIoHealth( 1 );
                                     }
 
+                                    // Back off after every failed write, a late good status for this message still counts
+                                    if( retryCnt > 0 )
+                                    {
+                                        writeStatus = _bootCtl->waitForLateFirmwareReply( _retryBackoff.delayMs( 2 - retryCnt ) );
+                                    }
                                 }
                             }
 
@@ -455,99 +475,8 @@ bool DcUpdateDialogMgr::updateFirmware(QString fileName )
 }
 bool DcUpdateDialogMgr::loadSysexFile( const QString &fileName,QList<DcMidiData>& dataList, QList<DcMidiData>* pRejectDataList /* = 0 */)
 {
-    bool result = true;
     _lastErrorMsgStr.clear();
-
-    QFile file(fileName);
-
-    if (!file.open(QIODevice::ReadOnly))
-    {
-        _lastErrorMsgStr = "Unable to open the file: " + fileName;
-        return false;
-    }
-
-    QDataStream in(&file);
-
-    // Load one preset in, see if it matches the current Manufacture
-    unsigned char byte;
-    DcMidiData md;
-    bool lookForStatusByte = true;
-
-    while(1 == in.readRawData((char*)&byte,1))
-    {
-        if(lookForStatusByte)
-        {
-            if(byte == 0xF0)
-            {
-                md.clear();
-                md.appendNum(byte);
-                lookForStatusByte = false;
-            }
-        }
-        else
-        {
-            if(byte == 0xF7)
-            {
-                md.appendNum(byte);
-
-                if(0 == pRejectDataList)
-                {
-                    dataList.append(md);
-                }
-                else
-                {
-                    bool reject = false;
-                    // Apply the filter
-                    foreach(DcMidiData rejectMd,*pRejectDataList)
-                    {
-                        if(md.contains(rejectMd))
-                        {
-                            reject = true;
-                            break;
-                        }
-                    }
-
-                    if(!reject)
-                    {
-                        dataList.append(md);
-                    }
-                }
-
-                lookForStatusByte = true;
-            }
-            else if(byte == 0xF0)
-            {
-                // Terminate the MIDI stream
-                md.appendNum(0xF7);
-
-                if(0 == pRejectDataList)
-                {
-                    dataList.append(md);
-                }
-                else if(!pRejectDataList->contains(md))
-                {
-                    dataList.append(md);
-                }
-
-                md.clear();
-                md.appendNum(0xF0);
-            }
-            else
-            {
-                md.appendNum(byte);
-            }
-        }
-    }
-
-    if(dataList.count() == 0)
-    {
-        _lastErrorMsgStr = fileName + " did not contain any MIDI data\n";
-        result = false;
-    }
-
-    file.close();
-
-    return result ;
+    return DcSysexScanner::loadFile(fileName,dataList,pRejectDataList,_lastErrorMsgStr);
 }
 
 //-------------------------------------------------------------------------
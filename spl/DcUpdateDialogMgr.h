@@ -29,6 +29,7 @@
 #include <QListWidget>
 #include <QTextStream>
 #include "IoProgressDialog.h"
+#include "cmn/DcRetryBackoff.h"
 
 class DcUpdateDialogMgr
 {
@@ -67,6 +68,8 @@ public:
 
     QString getLastErrorMsg();
 
+    void setRetryBackoff( const DcRetryBackoff& backoff ) { _retryBackoff = backoff; }
+
 private:
 
     QWidget *_parent;
@@ -82,6 +85,7 @@ private:
     IoProgressDialog* _progressDialog; 
     DcUpdate_Result _installUpdateResult;
     QString _urlFileName;
+    DcRetryBackoff _retryBackoff;
 };
 
 #endif // DCUPDATEDIALOG_H
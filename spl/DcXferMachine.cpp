@@ -21,35 +21,75 @@
 #include <QDebug>
 #include <QTimer>
 #include "PresetLibSMDefs.h"
-#include <QThread>
 #include "DcMidiDevDefs.h"
 #include "DcDeviceDetails.h"
+#include "DcXferStats.h"
 #include "cmn/DcLog.h"
-extern bool gUseAltPresetSize;
+#include <QFile>
+#include <QDataStream>
+#include <QDateTime>
 
 //-------------------------------------------------------------------------
+// Entry point of the transfer, the outer state machine only sees this state
+// once per job.  From here on replies drive the loop directly via sendNext().
 void DcXferMachine::sendNext_entered()
+{
+    _active = true;
+    _overheadNs = 0;
+    _overheadCount = 0;
+    _overheadTimer.invalidate();
+    _outstanding = 0;
+    _staleReplies = 0;
+    _jobTimer.start();
+    sendNext();
+}
+
+//-------------------------------------------------------------------------
+void DcXferMachine::sendActive()
+{
+    DcMidiData msg = _isWriteMachine ? _devDetails->Codec.encodeWrite( _activeCmd ) : _activeCmd;
+    _stats.BytesOut += msg.length();
+    _outstanding++;
+    _requestTimer.start();
+    _midiOut->dataOutThrottled( msg );
+}
+
+//-------------------------------------------------------------------------
+void DcXferMachine::sendNext()
 {
     if(_progressDialog->cancled())
     {
-        _watchdog.stop();
-        _machine->postEvent(new DataXfer_CancledEvent());
+        // A cancelled transfer is not resumed, the device may be edited before the next one
+        clearCheckpoint();
+        finish(new DataXfer_CancledEvent(), "cancelled");
     }
     else if(_cmdList.isEmpty())
     {
         _progressDialog->hide();
-        _machine->postEvent(new DataXfer_ListEmptyEvent());
+        clearCheckpoint();
+        finish(new DataXfer_ListEmptyEvent(), "complete");
     }
     else
     {
         _activeCmd = _cmdList.takeFirst();
 
+        // Replies to earlier attempts of the previous command may still arrive
+        _staleReplies += _outstanding;
+        _outstanding = 0;
+
+        if(_overheadTimer.isValid())
+        {
+            _overheadNs += _overheadTimer.nsecsElapsed();
+            _overheadCount++;
+            _overheadTimer.invalidate();
+        }
+
         if( !_isWriteMachine && _devDetails->isCrippled() )
         {
             _midiOut->dataOut( _devDetails->SOXHdr + "21 F7" );
         }
 
-        _midiOut->dataOutThrottled(_activeCmd);
+        sendActive();
 
         if( _isWriteMachine && _devDetails->isCrippled() )
         {
@@ -61,13 +101,35 @@ void DcXferMachine::sendNext_entered()
         _watchdog.start(_timeout);
     }
 }
+
+//-------------------------------------------------------------------------
+void DcXferMachine::finish( QEvent* e, const char* result )
+{
+    _active = false;
+    _watchdog.stop();
+    _retryTimer.stop();
+
+    _stats.ElapsedMs = _jobTimer.elapsed();
+    _stats.Result = result;
+
+    if(_overheadCount)
+    {
+        DCLOG() << (_isWriteMachine ? "Write" : "Read") << " engine overhead: "
+                << (_overheadNs / _overheadCount) / 1000 << " us/preset over " << _overheadCount << " presets";
+    }
+
+    DCLOG() << "fastfetch " << (_devDetails->Codec.isCompactRead() ? "on" : "off") << ", " << _stats.toString();
+
+    _machine->postEvent(e);
+}
+
 //-------------------------------------------------------------------------
 void DcXferMachine::replySlotForDataIn( const DcMidiData &data )
 {
     // Expect to see sysex coming from the currently attached device.
     // This check will prevent other legal messages from blowing up
     // the transfer - like controller messages, etc...
-    if(data.contains(_devDetails->SOXHdr))
+    if(_active && data.contains(_devDetails->SOXHdr))
     {
         if(data == _activeCmd)
         {
@@ -77,44 +139,50 @@ void DcXferMachine::replySlotForDataIn( const DcMidiData &data )
             return;
         } 
 
-        // cancel the watchdog timer
+        bool NAK = data.match(_devDetails->PresetRd_NAK,true);
+        bool ACK = !NAK && data.match(_devDetails->PresetRd_ACK);
+
+        // A retry may have been sent before a slow reply arrived, the
+        // duplicate reply must not be taken for the next preset.
+        if( ACK && data.get14bit(_devDetails->PresetNumberOffset,-1) != _activeCmd.get14bit(_devDetails->PresetNumberOffset,-2) )
+        {
+            DCLOG() << "Ignoring late reply for a previous preset request";
+            return;
+        }
+
+        _overheadTimer.start();
+        _stats.BytesIn += data.length();
+
+        // cancel the watchdog and any pending retry, a late reply to an
+        // earlier attempt is as good as a reply to the retry.
         _watchdog.stop();
+        _retryTimer.stop();
 
         // Check for a Negative Acknowledgment of the data in request
-        if( data.match(_devDetails->PresetRd_NAK,true) )
+        if( NAK )
         {
             DCLOG() << "Preset read NAK detected, notify user and bail";
             _progressDialog->setError("Device Rejected Command");
-            _machine->postEvent(new DataXfer_NACKEvent());
+            _stats.Naks++;
+            checkpoint(true);
+            finish(new DataXfer_NACKEvent(), "rejected");
         }
-        else if( data.match(_devDetails->PresetRd_ACK) )
+        else if( ACK )
         {
-            DcMidiData recompinded;
-
-            if(gUseAltPresetSize)
-            {
-                int chnksz   = data.get14bit(9+2);
-                recompinded = data.mid(0,9);
-                recompinded[6] = 0x62;
-                recompinded.append(DcMidiData(data.mid(9+6,chnksz)));
-                recompinded.append(DcMidiData("18191A1B1C1D1E1F202122232425262728292A2B2C2D2E2F303132337F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F7F"));
-                recompinded.append(DcMidiData(data.mid(9+6+chnksz)));
-            }
-            else
-            {
-                        recompinded = data;
-            }
-
+            DcMidiData recompinded = _devDetails->Codec.decodeRead(data);
 
             if( verifyPresetData(recompinded,_progressDialog,_devDetails) == true )
             {    
                 _progressDialog->inc();
                 _midiDataList.append(recompinded);
-                _machine->postEvent(new DataXfer_ACKEvent());
+                _stats.addPreset(_requestTimer.elapsed(), _numRetries - _retryCount);
+                checkpoint();
+                sendNext();
             }
             else
             {
-                _machine->postEvent(new DataXfer_NACKEvent()); 
+                checkpoint(true);
+                finish(new DataXfer_NACKEvent(), "corrupt preset data"); 
             }
         }
         else
@@ -122,7 +190,8 @@ void DcXferMachine::replySlotForDataIn( const DcMidiData &data )
             DCLOG() << "Unexpected data received after preset read";
             DCLOG() << data.toString();
             _progressDialog->setError("Unexpected data received after requesting the preset.");
-            _machine->postEvent(new DataXfer_NACKEvent());
+            checkpoint(true);
+            finish(new DataXfer_NACKEvent(), "unexpected reply");
         }
     }
 }
@@ -133,7 +202,7 @@ void DcXferMachine::replySlotForDataOut( const DcMidiData &data )
     // Expect to see sysex coming from the currently attached device.
     // This check will prevent other legal messages from blowing up
     // out preset transfer - like controller messages
-    if(data.contains(_devDetails->SOXHdr))
+    if(_active && data.contains(_devDetails->SOXHdr))
     {
         bool NAK = data.match(_devDetails->PresetWr_NAK);
         bool ACK = data.match(_devDetails->PresetWr_ACK);
@@ -155,44 +224,47 @@ void DcXferMachine::replySlotForDataOut( const DcMidiData &data )
             return;
         }
 
-        // This is the response we were looking for, cancel the transfer timeout watchdog
+        // Write replies don't identify the preset, so replies still owed to
+        // retries of the previous write are consumed here.  Should one of
+        // them never arrive, the worst case is a redundant rewrite after
+        // the watchdog fires.
+        if(_staleReplies > 0)
+        {
+            _staleReplies--;
+            DCLOG() << "Ignoring late reply for a previous write";
+            return;
+        }
+        _outstanding = qMax(0, _outstanding - 1);
+
+        // This is the response we were looking for, cancel the transfer timeout
+        // watchdog and any pending retry, a late reply to an earlier attempt
+        // is as good as a reply to the retry.
+        _overheadTimer.start();
+        _stats.BytesIn += data.length();
         _watchdog.stop();
+        _retryTimer.stop();
         
         // Check for write preset Negative Acknowledgment
         if(NAK)
         {
+            _stats.Naks++;
             if(--_retryCount < 0)
             {
                 DCLOG() << "NAK - retries exhausted - notify user and bail";
                 _progressDialog->setError("Device Rejected Write Command");
-                _machine->postEvent(new DataXfer_NACKEvent());
+                checkpoint(true);
+                finish(new DataXfer_NACKEvent(), "rejected");
             }
             else
             {
-                // Retry the Write Command
-                QThread::msleep(100);
-
-                // Will this be the last try?  Also, if midiOut is not in 'safe mode'
-                // throttle back the output rate to work around troubled MIDI host adapters.
-                if(!_midiOut->isSafeMode())
-                {
-                    DCLOG() << "Throttling back MIDI output rate";
-                    _midiOut->setSafeMode();
-                    _progressDialog->setIoHealth( 1 );
-                }
-
                 DCLOG() << "NAK - retry count at " << _retryCount;
-                _midiOut->dataOutThrottled(_activeCmd);
-
-                // Restart watchdog
-                _watchdog.start(_timeout);
+                scheduleRetry();
             }
         }
         else if(ACK)
         {
             _progressDialog->inc();
             _progressDialog->setError("");
-            QApplication::processEvents();
 
             if( _retryCount < _numRetries )
             {
@@ -200,7 +272,9 @@ void DcXferMachine::replySlotForDataOut( const DcMidiData &data )
             }
 
             _writeSuccessList.append(_activeCmd);
-            _machine->postEvent(new DataXfer_ACKEvent());
+            _stats.addPreset(_requestTimer.elapsed(), _numRetries - _retryCount);
+            checkpoint();
+            sendNext();
         }
         else
         {
@@ -210,7 +284,8 @@ void DcXferMachine::replySlotForDataOut( const DcMidiData &data )
             DCLOG() << "Received: " << data.toString();
 
             _progressDialog->setError("Unexpected data after preset write");
-            _machine->postEvent(new DataXfer_NACKEvent());
+            checkpoint(true);
+            finish(new DataXfer_NACKEvent(), "unexpected reply");
         }
     }
 }
@@ -263,36 +338,75 @@ void DcXferMachine::xferTimeout()
 {
     _watchdog.stop();
 
+    if( !_active )
+    {
+        return;
+    }
+
     if( _progressDialog->cancled() )
     {
         DCLOG() << (_isWriteMachine ? "Write Preset" : "Read Preset") << " cancled";
-        _machine->postEvent( new DataXfer_CancledEvent() );
+        checkpoint( true );
+        finish( new DataXfer_CancledEvent(), "cancelled" );
     }
     else
     {
         DCLOG() << (_isWriteMachine ? "Write Preset" : "Read Preset") << " Transfer Timeout";
+        _stats.Timeouts++;
         if( --_retryCount < 0 )
         {
             DCLOG() << "No more retries, notify user";
             _progressDialog->setError( "Unable to communicate with the device." );
-            _machine->postEvent( new DataXfer_TimeoutEvent() );
+            checkpoint( true );
+            finish( new DataXfer_TimeoutEvent(), "timeout" );
         }
         else
         {
-            QThread::msleep( 100 );
-            if( !_midiOut->isSafeMode() )
-            {
-                DCLOG() << "Throttling back MIDI out data rate";
-                _midiOut->setSafeMode();
-                _progressDialog->setIoHealth( 1 );
-            }
+            // Anything still owed to the previous write has had a full
+            // timeout period to show up.
+            _staleReplies = 0;
+            scheduleRetry();
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+void DcXferMachine::scheduleRetry()
+{
+    // If midiOut is not in 'safe mode' throttle back the output rate to
+    // work around troubled MIDI host adapters.
+    if( !_midiOut->isSafeMode() )
+    {
+        DCLOG() << "Throttling back MIDI output rate";
+        _midiOut->setSafeMode();
+        _stats.SafeModeHit = true;
+        _progressDialog->setIoHealth( 1 );
+    }
 
-            _midiOut->dataOutThrottled( _activeCmd );
+    int delay = _backoff.delayMs( _numRetries - _retryCount - 1 );
+    DCLOG() << "Retrying in " << delay << " ms";
+    _retryTimer.start( delay );
+}
 
-            // Restart watchdog
-            _watchdog.start( _timeout );
-        }
+//-------------------------------------------------------------------------
+void DcXferMachine::retrySend()
+{
+    if( !_active )
+    {
+        return;
     }
+
+    if( _progressDialog->cancled() )
+    {
+        checkpoint( true );
+        finish( new DataXfer_CancledEvent(), "cancelled" );
+        return;
+    }
+
+    sendActive();
+
+    // Restart watchdog
+    _watchdog.start( _timeout );
 }
 
 //-------------------------------------------------------------------------
@@ -317,11 +431,13 @@ DcState* DcXferMachine::setupStateMachine(QStateMachine* m,DcMidiOut* out,DcStat
     QObject::disconnect(&_watchdog, &QTimer::timeout, 0,0);
     QObject::connect(&_watchdog, &QTimer::timeout, this, &DcXferMachine::xferTimeout);
 
-    DcCustomTransition *ct = new DcCustomTransition(DataXfer_ACKEvent::TYPE,sendNext);
-    ct->setTargetState(sendNext);
-    sendNext->addTransition(ct);
+    _retryTimer.setSingleShot(true);
+    QObject::disconnect(&_retryTimer, &QTimer::timeout, 0,0);
+    QObject::connect(&_retryTimer, &QTimer::timeout, this, &DcXferMachine::retrySend);
 
-    ct = new DcCustomTransition(DataXfer_NACKEvent::TYPE,sendNext);
+    // Per-preset ACKs are handled inside the object, only the terminal
+    // events are routed through the state machine.
+    DcCustomTransition *ct = new DcCustomTransition(DataXfer_NACKEvent::TYPE,sendNext);
     ct->setTargetState(errorState);
     sendNext->addTransition(ct);
 
@@ -360,17 +476,22 @@ void DcXferMachine::append( DcMidiData& cmd )
 void DcXferMachine::reset(bool isWriteMachine)
 {
     _isWriteMachine = isWriteMachine;
+    _active = false;
     _writeSuccessList.clear();
     _cmdList.clear();
     _midiDataList.clear();
     _cancel = false;
     _watchdog.stop();
+    _retryTimer.stop();
 }
 
 //-------------------------------------------------------------------------
 void DcXferMachine::go(DcDeviceDetails* devDetails, int maxPacketSize/*=-1*/, int delayPerPacket /*=0*/)
 {
     _devDetails = devDetails;
+    _activeUid = devDetails->getUid();
+    _jobLength = _cmdList.length();
+    _sinceCheckpoint = 0;
 
     (void)maxPacketSize;
     (void)delayPerPacket;
@@ -380,6 +501,14 @@ void DcXferMachine::go(DcDeviceDetails* devDetails, int maxPacketSize/*=-1*/, in
     _timeout = 2000;
     _cancel = false;
     _numRetries = kNumRetries;
+
+    _stats.clear();
+    _stats.IsWrite = _isWriteMachine;
+    _stats.Device = devDetails->Name;
+    _stats.Firmware = devDetails->FwVersion;
+    _stats.Interface = _midiOut->getPortName();
+    _stats.SafeModeHit = _midiOut->isSafeMode();
+
     _progressDialog->setProgress(0);
     _progressDialog->setMax(_cmdList.length());
     _progressDialog->show();
@@ -390,6 +519,171 @@ void DcXferMachine::go(DcDeviceDetails* devDetails, int maxPacketSize/*=-1*/, in
     }
 }
 
+//-------------------------------------------------------------------------
+int DcXferMachine::resume()
+{
+    // Prefer the in-memory checkpoint, fall back to the one on disk
+    if( _checkpointData.isEmpty() || _checkpointUid != _activeUid || _checkpointIsWrite != _isWriteMachine )
+    {
+        if( !loadCheckpoint() )
+        {
+            return 0;
+        }
+    }
+
+    if( _checkpointUid != _activeUid || _checkpointIsWrite != _isWriteMachine )
+    {
+        return 0;
+    }
+
+    if( QDateTime::currentMSecsSinceEpoch() - _checkpointTime > kCheckpointMaxAgeSecs * 1000LL )
+    {
+        DCLOG() << "Discarding stale transfer checkpoint";
+        clearCheckpoint();
+        return 0;
+    }
+
+    // Only a checkpoint that matches the head of the command list is
+    // salvaged, the transfer then continues at the first incomplete preset.
+    DcMidiDataList_t& done = completedList();
+    int salvaged = 0;
+    while( salvaged < _checkpointData.length() && !_cmdList.isEmpty() )
+    {
+        const DcMidiData& saved = _checkpointData.at( salvaged );
+        const DcMidiData& next = _cmdList.first();
+        bool same;
+        if( _isWriteMachine )
+        {
+            same = (saved == next);
+        }
+        else
+        {
+            same = saved.get14bit( _devDetails->PresetNumberOffset, -1 ) == next.get14bit( _devDetails->PresetNumberOffset, -2 );
+        }
+
+        if( !same )
+        {
+            break;
+        }
+
+        done.append( saved );
+        _cmdList.removeFirst();
+        salvaged++;
+    }
+
+    if( salvaged )
+    {
+        DCLOG() << "Resuming transfer: " << salvaged << " presets recovered from checkpoint";
+        _progressDialog->setProgress( salvaged );
+        _progressDialog->setMessage( QString( "Resuming: %1 presets recovered" ).arg( salvaged ) );
+    }
+    return salvaged;
+}
+
+//-------------------------------------------------------------------------
+void DcXferMachine::checkpoint( bool force /*= false*/ )
+{
+    if( !force && ++_sinceCheckpoint < kCheckpointInterval )
+    {
+        return;
+    }
+    _sinceCheckpoint = 0;
+
+    _checkpointUid = _activeUid;
+    _checkpointIsWrite = _isWriteMachine;
+    _checkpointTime = QDateTime::currentMSecsSinceEpoch();
+    _checkpointData = completedList();
+
+    // Short jobs are cheap to redo, only long ones are persisted
+    if( _checkpointPath.isEmpty() || _jobLength < kCheckpointInterval || _checkpointData.isEmpty() )
+    {
+        return;
+    }
+
+    QFile file( _checkpointPath );
+    if( !file.open( QIODevice::WriteOnly ) )
+    {
+        DCLOG() << "Unable to write transfer checkpoint: " << _checkpointPath;
+        return;
+    }
+
+    QDataStream out( &file );
+    out << (quint32)kCheckpointMagicNumber;
+    out << (qint32)1;
+    out.setVersion( QDataStream::Qt_5_1 );
+    out << (quint32)_checkpointUid << _checkpointIsWrite << _checkpointTime;
+    out << (qint32)_checkpointData.length();
+    for( int i = 0; i < _checkpointData.length(); i++ )
+    {
+        out << _checkpointData.at( i ).toByteArray();
+    }
+}
+
+//-------------------------------------------------------------------------
+bool DcXferMachine::loadCheckpoint()
+{
+    if( _checkpointPath.isEmpty() )
+    {
+        return false;
+    }
+
+    QFile file( _checkpointPath );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        return false;
+    }
+
+    QDataStream in( &file );
+
+    quint32 magic;
+    qint32 version;
+    in >> magic >> version;
+    if( magic != kCheckpointMagicNumber || version != 1 )
+    {
+        DCLOG() << "Invalid transfer checkpoint: " << _checkpointPath;
+        return false;
+    }
+    in.setVersion( QDataStream::Qt_5_1 );
+
+    quint32 uid;
+    bool isWrite;
+    qint64 ts;
+    qint32 count;
+    in >> uid >> isWrite >> ts >> count;
+
+    DcMidiDataList_t data;
+    for( int i = 0; i < count && in.status() == QDataStream::Ok; i++ )
+    {
+        QByteArray ba;
+        in >> ba;
+        data.append( DcMidiData( ba ) );
+    }
+
+    if( in.status() != QDataStream::Ok )
+    {
+        DCLOG() << "Truncated transfer checkpoint: " << _checkpointPath;
+        return false;
+    }
+
+    _checkpointUid = uid;
+    _checkpointIsWrite = isWrite;
+    _checkpointTime = ts;
+    _checkpointData = data;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+void DcXferMachine::clearCheckpoint()
+{
+    _checkpointData.clear();
+    _checkpointUid = 0;
+    _sinceCheckpoint = 0;
+    if( !_checkpointPath.isEmpty() )
+    {
+        QFile::remove( _checkpointPath );
+    }
+}
+
 //-------------------------------------------------------------------------
 bool DcXferMachine::verifyPresetData( const DcMidiData &data, IoProgressDialog* progDialog, const DcDeviceDetails* devinfo )
 {
@@ -22,8 +22,11 @@
 #include "DcMidi/DcMidiData.h"
 #include "DcMidi/DcMidiOut.h"
 #include <QTimer>
+#include <QElapsedTimer>
 #include "cmn/DcState.h"
+#include "cmn/DcRetryBackoff.h"
 #include "IoProgressDialog.h"
+#include "DcXferStats.h"
 
 
 struct DcDeviceDetails;
@@ -38,7 +41,13 @@ public:
 
     static const int kNumRetries = 4;
 
-    DcXferMachine() { }
+    // Checkpoint every N completed presets, and only persist jobs at least that long
+    static const int kCheckpointInterval = 16;
+    // Checkpoints only bridge a dropped connection, older ones may not match the device
+    static const int kCheckpointMaxAgeSecs = 120;
+    static const quint32 kCheckpointMagicNumber = 0x44435843;
+
+    DcXferMachine() : _outstanding(0), _staleReplies(0), _active(false), _overheadNs(0), _overheadCount(0), _activeUid(0), _jobLength(0), _checkpointUid(0), _checkpointIsWrite(false), _checkpointTime(0), _sinceCheckpoint(0) { }
      ~DcXferMachine () {}
 
     DcMidiDataList_t getCmdsWritten();
@@ -51,6 +60,12 @@ public slots:
  DcState* setupStateMachine(QStateMachine* m,DcMidiOut* out,DcState* doneState,DcState* errorState,DcState* cancelState);
 
   // State Handlers
+
+  /*!
+    Starts the transfer loop.  Each reply sends the next command directly,
+    the outer state machine only receives the final ListEmpty, NACK,
+    Timeout or Cancled event.
+  */
   void sendNext_entered();
     
   /*!
@@ -80,6 +95,11 @@ public slots:
   void xferTimeout();
   int getTimeout() const { return _timeout; }
   void setTimeout(int val) { _timeout = val; }
+
+  /*!
+    Sets the delay schedule used between retries after a NAK or timeout.
+  */
+  void setRetryBackoff( const DcRetryBackoff& backoff ) { _backoff = backoff; }
   
   QList<DcMidiData>& getDataList() { return _midiDataList; }
   
@@ -91,11 +111,43 @@ public slots:
   void append( DcMidiData& cmdStr );
 
   void reset(bool isWriteMachine);
+
+  /*!
+    Telemetry for the most recent session run by this machine.
+  */
+  const DcXferStats& getStats() const { return _stats; }
+
+  /*!
+    Sets the file used to persist transfer checkpoints.  An empty path
+    keeps checkpoints in memory only.
+  */
+  void setCheckpointPath( const QString& path ) { _checkpointPath = path; }
+
+  /*!
+    Call after go().  If a failed transfer for the same device and
+    direction left a checkpoint in the last kCheckpointMaxAgeSecs, the
+    presets it holds are restored and removed from the command list so
+    the transfer picks up at the first incomplete preset.
+    Returns the number of presets salvaged.
+  */
+  int resume();
+
+  /*!
+    Discards the in-memory and on-disk checkpoint.
+  */
+  void clearCheckpoint();
   //void strickedReplySlotForDataOut( const DcMidiData &data );
 private:
 
     int _timeout;
     QTimer _watchdog;
+    QTimer _retryTimer;
+    DcRetryBackoff _backoff;
+
+    // Sends of the active command not yet answered, and replies still owed
+    // to earlier commands
+    int _outstanding;
+    int _staleReplies;
 
     bool _cancel;
     IoProgressDialog* _progressDialog;
@@ -112,4 +164,36 @@ private:
     int _numRetries;
     bool _isWriteMachine;
     DcMidiDataList_t _writeSuccessList;
+
+    void sendNext();
+    void sendActive();
+    void scheduleRetry();
+    void retrySend();
+    void finish( QEvent* e, const char* result );
+
+    // True between entering the transfer state and posting the final event
+    bool _active;
+
+    // Time from a reply arriving to the next command being sent
+    QElapsedTimer _overheadTimer;
+    qint64 _overheadNs;
+    int _overheadCount;
+    QElapsedTimer _jobTimer;
+
+    DcXferStats _stats;
+    QElapsedTimer _requestTimer;
+
+    void checkpoint( bool force = false );
+    bool loadCheckpoint();
+    DcMidiDataList_t& completedList() { return _isWriteMachine ? _writeSuccessList : _midiDataList; }
+
+    unsigned int _activeUid;
+    int _jobLength;
+
+    QString _checkpointPath;
+    unsigned int _checkpointUid;
+    bool _checkpointIsWrite;
+    qint64 _checkpointTime;
+    DcMidiDataList_t _checkpointData;
+    int _sinceCheckpoint;
 };
@@ -0,0 +1,91 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+#include "DcXferStats.h"
+#include <QTextStream>
+
+//-------------------------------------------------------------------------
+int DcXferStats::latencyBucketLimit( int idx )
+{
+    static const int limits[kLatencyBuckets - 1] = { 10, 20, 50, 100, 200, 500, 1000, 2000 };
+    return (idx < kLatencyBuckets - 1) ? limits[idx] : -1;
+}
+
+//-------------------------------------------------------------------------
+void DcXferStats::addPreset( int latencyMs, int retries )
+{
+    if( Presets == 0 || latencyMs < LatencyMin )
+    {
+        LatencyMin = latencyMs;
+    }
+    if( latencyMs > LatencyMax )
+    {
+        LatencyMax = latencyMs;
+    }
+    LatencySum += latencyMs;
+    Presets++;
+
+    int b = 0;
+    while( b < kLatencyBuckets - 1 && latencyMs >= latencyBucketLimit( b ) )
+    {
+        b++;
+    }
+    LatencyHist[b]++;
+
+    RetryHist[qBound( 0, retries, (int)kMaxRetryBucket )]++;
+}
+
+//-------------------------------------------------------------------------
+QString DcXferStats::toString() const
+{
+    QString s;
+    QTextStream ts( &s );
+
+    ts << (IsWrite ? "Write" : "Fetch") << " session: " << Result << "\n";
+    ts << "  device: " << Device << " fw " << Firmware << " via '" << Interface << "'\n";
+    ts << "  presets: " << Presets << "  time: " << ElapsedMs << " ms\n";
+    ts << "  bytes out: " << BytesOut << "  in: " << BytesIn << "  rate: " << bytesPerSec() << " bytes/sec\n";
+    ts << "  NAKs: " << Naks << "  timeouts: " << Timeouts << "  safe mode: " << (SafeModeHit ? "yes" : "no") << "\n";
+
+    if( Presets )
+    {
+        ts << "  latency ms: min " << LatencyMin << " avg " << (LatencySum / Presets) << " max " << LatencyMax << "\n";
+        ts << "  latency histogram:";
+        for( int i = 0; i < kLatencyBuckets; i++ )
+        {
+            int lim = latencyBucketLimit( i );
+            if( lim < 0 )
+            {
+                ts << "  >=" << latencyBucketLimit( i - 1 ) << ":" << LatencyHist[i];
+            }
+            else
+            {
+                ts << "  <" << lim << ":" << LatencyHist[i];
+            }
+        }
+        ts << "\n  retry histogram:";
+        for( int i = 0; i <= kMaxRetryBucket; i++ )
+        {
+            if( RetryHist[i] )
+            {
+                ts << "  " << i << (i == kMaxRetryBucket ? "+" : "") << ":" << RetryHist[i];
+            }
+        }
+        ts << "\n";
+    }
+    ts.flush();
+    return s;
+}
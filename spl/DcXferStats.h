@@ -0,0 +1,98 @@
+/*-------------------------------------------------------------------------
+	    Copyright 2013 Damage Control Engineering, LLC
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*-------------------------------------------------------------------------*/
+/*!
+ \file DcXferStats.h
+ \brief Telemetry gathered by DcXferMachine for one fetch or write session.
+--------------------------------------------------------------------------*/
+#pragma once
+#include <QString>
+#include <QtGlobal>
+
+struct DcXferStats
+{
+    // Upper bounds, in ms, of the request to reply latency buckets.  The
+    // last bucket collects everything slower.
+    static const int kLatencyBuckets = 9;
+    static const int kMaxRetryBucket = 8;
+
+    DcXferStats() { clear(); }
+
+    void clear()
+    {
+        IsWrite = false;
+        Device.clear();
+        Firmware.clear();
+        Interface.clear();
+        Result.clear();
+        Presets = 0;
+        Naks = 0;
+        Timeouts = 0;
+        BytesOut = 0;
+        BytesIn = 0;
+        ElapsedMs = 0;
+        SafeModeHit = false;
+        LatencyMin = 0;
+        LatencyMax = 0;
+        LatencySum = 0;
+        for( int i = 0; i < kLatencyBuckets; i++ )
+        {
+            LatencyHist[i] = 0;
+        }
+        for( int i = 0; i <= kMaxRetryBucket; i++ )
+        {
+            RetryHist[i] = 0;
+        }
+    }
+
+    bool isEmpty() const { return Result.isEmpty(); }
+
+    /*!
+      Records a completed preset, latency is measured from the last
+      request sent to the reply that completed it.
+    */
+    void addPreset( int latencyMs, int retries );
+
+    qint64 bytesPerSec() const
+    {
+        return ElapsedMs ? ((BytesOut + BytesIn) * 1000) / ElapsedMs : 0;
+    }
+
+    /*!
+      Multi-line, human readable summary used by the log and the console.
+    */
+    QString toString() const;
+
+    static int latencyBucketLimit( int idx );
+
+    bool    IsWrite;
+    QString Device;
+    QString Firmware;
+    QString Interface;
+    QString Result;
+    int     Presets;
+    int     Naks;
+    int     Timeouts;
+    qint64  BytesOut;
+    qint64  BytesIn;
+    qint64  ElapsedMs;
+    bool    SafeModeHit;
+    int     LatencyMin;
+    int     LatencyMax;
+    qint64  LatencySum;
+    int     LatencyHist[kLatencyBuckets];
+    int     RetryHist[kMaxRetryBucket + 1];
+};
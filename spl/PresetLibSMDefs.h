@@ -44,6 +44,8 @@ enum DcEventOffset
     DataXfer_Retry,
     DataXfer_CancledOffset,
 
+    VerifyWritesOffset,
+    RewriteMismatchesOffset,
 };
 
 typedef DcSimpleEvent<VerifyDeviceConnectionOffset> VerifyDeviceConnection;
@@ -64,6 +66,9 @@ typedef DcSimpleEvent<FetchCancledOffset> FetchCancledEvent;
 
 typedef DcSimpleEvent<DeviceListInSyncOffset> DeviceListInSyncEvent;
 
+typedef DcSimpleEvent<VerifyWritesOffset> VerifyWritesEvent;
+typedef DcSimpleEvent<RewriteMismatchesOffset> RewriteMismatchesEvent;
+
 // Events defined for the DataXfer class
 typedef DcSimpleEvent<DataXfer_ListEmptyOffset> DataXfer_ListEmptyEvent;
 typedef DcSimpleEvent<DataXfer_NACKOffset> DataXfer_NACKEvent;
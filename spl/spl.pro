@@ -40,7 +40,28 @@ SOURCES += main.cpp\
         DcUpdateDialogMgr.cpp \
         DcImgLabel.cpp \
         DcDropLabel.cpp \
-        DcLogDialog.cpp
+        DcLogDialog.cpp \
+        DcPresetCodec.cpp \
+        DcXferStats.cpp \
+        DcMultiDeviceSession.cpp \
+        DcPresetBundle.cpp \
+        DcSysexScanner.cpp \
+        DcSysexRejectFilter.cpp \
+        DcPresetIndex.cpp \
+        DcPresetLibraryDialog.cpp \
+        DcBackupStore.cpp \
+        DcPresetArchive.cpp \
+        DcBackupWriter.cpp \
+        DcTrigramIndex.cpp \
+        DcPresetDiff.cpp \
+        DcDirtyTracker.cpp \
+        DcPresetListModel.cpp \
+        DcPresetExporter.cpp \
+        DcBatchImport.cpp \
+        DcPresetSimilarity.cpp \
+        DcPresetColumns.cpp \
+        DcPresetBank.cpp \
+        DcPortScanner.cpp
 
 
 HEADERS  += DcPresetLib.h \
@@ -61,7 +82,30 @@ HEADERS  += DcPresetLib.h \
             DcUpdateDialogMgr.h \
             DcImgLabel.h \
             DcDropLabel.h \
-            DcLogDialog.h
+            DcLogDialog.h \
+            DcPresetCodec.h \
+            DcXferStats.h \
+            DcMultiDeviceSession.h \
+            DcPresetBundle.h \
+            DcSysexScanner.h \
+            DcSysexRejectFilter.h \
+            DcPresetIndex.h \
+            DcPresetLibraryDialog.h \
+            DcBackupStore.h \
+            DcPresetArchive.h \
+            DcBackupWriter.h \
+            DcTrigramIndex.h \
+            DcPresetDiff.h \
+            DcDirtyTracker.h \
+            DcPresetListModel.h \
+            DcPresetExporter.h \
+            DcBatchImport.h \
+            DcPresetSimilarity.h \
+            DcPresetSchema.h \
+            DcPresetColumns.h \
+            DcPresetBank.h \
+            DcPortScanner.h \
+            DcListWidget.h
 
 FORMS += DcPresetLib.ui IoProgressDialog.ui MoveDialog.ui RenameDialog.ui DcplAbout.ui \
     DcConsoleForm.ui MidiPortSelect.ui \
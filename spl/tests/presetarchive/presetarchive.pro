@@ -0,0 +1,5 @@
+TARGET = t_presetarchive
+include("../tests.pri")
+SOURCES += $$LIB_DIR/DcMidi/DcMidiData.cpp
+SOURCES += $$SPL_DIR/DcPresetArchive.cpp
+SOURCES += t_presetarchive.cpp
@@ -0,0 +1,255 @@
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "DcPresetArchive.h"
+
+class t_DcPresetArchive: public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir _dir;
+
+    QList<DcMidiData> makePresets( int count )
+    {
+        QList<DcMidiData> presets;
+        for (int n = 0; n < count; n++)
+        {
+            QByteArray ba = DcMidiData("F0 00 01 55 12 01 62").toByteArray();
+            ba.append(char(n >> 7)).append(char(n & 0x7F));
+            for (int i = ba.size(); i < 649; i++)
+            {
+                ba.append(char((i * 7 + n * 13) & 0x7F));
+            }
+            ba.append(char(0xF7));
+            presets << DcMidiData(ba);
+        }
+        return presets;
+    }
+
+    QString save( const QString& name,int count )
+    {
+        QString path = _dir.filePath(name);
+        QString errorMsg;
+        bool ok = DcPresetArchive::save(path,makePresets(count),"TimeLine","1.0",errorMsg);
+        if(!ok)
+        {
+            qWarning() << errorMsg;
+        }
+        return ok ? path : QString();
+    }
+
+    // Offset of the preset count, the header before it is written the same way
+    qint64 countOffset()
+    {
+        QByteArray hdr;
+        QDataStream out(&hdr,QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_1);
+        out.writeRawData("DCPZ",4);
+        out << quint16(1) << QString("TimeLine") << QString("1.0");
+        return hdr.size();
+    }
+
+    // Lengths of the compressed frames, up to the terminator
+    QList<quint32> frameLengths( const QString& path )
+    {
+        QList<quint32> lens;
+        QFile file(path);
+        if(!file.open(QIODevice::ReadOnly) || !file.seek(countOffset() + 4))
+        {
+            return lens;
+        }
+
+        QDataStream in(&file);
+        quint32 len = 0;
+        in >> len;
+        while(in.status() == QDataStream::Ok && len)
+        {
+            lens << len;
+            in.skipRawData(len);
+            in >> len;
+        }
+        return lens;
+    }
+
+    void truncate( const QString& path,qint64 size )
+    {
+        QFile file(path);
+        QVERIFY(file.resize(size));
+    }
+
+    // Reads every preset it can, returns how many
+    int readAll( const QString& path,DcPresetArchiveReader& r )
+    {
+        int read = 0;
+        DcMidiData md;
+        if(r.open(path))
+        {
+            while(r.next(md))
+            {
+                read++;
+            }
+        }
+        return read;
+    }
+
+private slots:
+
+    void initTestCase()
+    {
+        QVERIFY(_dir.isValid());
+    }
+
+    void roundTrip_data()
+    {
+        QTest::addColumn<int>("count");
+        QTest::addColumn<int>("frames");
+
+        QTest::newRow("empty") << 0 << 0;
+        QTest::newRow("one") << 1 << 1;
+        QTest::newRow("one short of a frame") << 31 << 1;
+        QTest::newRow("exactly one frame") << 32 << 1;
+        QTest::newRow("one over a frame") << 33 << 2;
+        QTest::newRow("exactly two frames") << 64 << 2;
+        QTest::newRow("bank") << 300 << 10;
+    }
+
+    void roundTrip()
+    {
+        QFETCH(int,count);
+        QFETCH(int,frames);
+
+        QString path = save("roundtrip.syz",count);
+        QVERIFY(!path.isEmpty());
+        QVERIFY(DcPresetArchive::isArchive(path));
+        QCOMPARE(frameLengths(path).size(),frames);
+
+        QList<DcMidiData> loaded;
+        QString errorMsg;
+        QVERIFY(DcPresetArchive::load(path,loaded,errorMsg));
+        QCOMPARE(loaded.size(),count);
+
+        QList<DcMidiData> expected = makePresets(count);
+        for (int n = 0; n < count; n++)
+        {
+            QVERIFY(loaded.at(n) == expected.at(n));
+        }
+
+        DcPresetArchiveReader r;
+        QCOMPARE(readAll(path,r),count);
+        QVERIFY(r.atEnd());
+        QCOMPARE(r.header().PresetCount,quint32(count));
+        QCOMPARE(r.header().Device,QString("TimeLine"));
+        QVERIFY(r.getLastErrorString().isEmpty());
+    }
+
+    void notAnArchive()
+    {
+        QString path = _dir.filePath("raw.syx");
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(makePresets(1).first().toByteArray());
+        file.close();
+
+        QVERIFY(!DcPresetArchive::isArchive(path));
+        QList<DcMidiData> loaded;
+        QString errorMsg;
+        QVERIFY(!DcPresetArchive::load(path,loaded,errorMsg));
+        QVERIFY(!errorMsg.isEmpty());
+    }
+
+    void truncatedFrame()
+    {
+        QString path = save("truncated.syz",40);
+        QList<quint32> lens = frameLengths(path);
+        QCOMPARE(lens.size(),2);
+
+        // Cut the second frame in half, the first still reads
+        qint64 secondFrame = countOffset() + 4 + 4 + lens.at(0) + 4;
+        truncate(path,secondFrame + lens.at(1) / 2);
+
+        DcPresetArchiveReader r;
+        QCOMPARE(readAll(path,r),32);
+        QVERIFY(!r.atEnd());
+        QVERIFY(!r.getLastErrorString().isEmpty());
+
+        QList<DcMidiData> loaded;
+        QString errorMsg;
+        QVERIFY(!DcPresetArchive::load(path,loaded,errorMsg));
+        QVERIFY(!errorMsg.isEmpty());
+        QVERIFY(loaded.isEmpty());
+    }
+
+    void truncatedFrameLength()
+    {
+        // The file ends part way through a frame length
+        QString path = save("shortlen.syz",40);
+        QList<quint32> lens = frameLengths(path);
+        truncate(path,countOffset() + 4 + 4 + lens.at(0) + 2);
+
+        DcPresetArchiveReader r;
+        QCOMPARE(readAll(path,r),32);
+        QVERIFY(!r.atEnd());
+
+        QList<DcMidiData> loaded;
+        QString errorMsg;
+        QVERIFY(!DcPresetArchive::load(path,loaded,errorMsg));
+    }
+
+    void missingTerminator()
+    {
+        QString path = save("noterm.syz",40);
+        QFileInfo fi(path);
+        truncate(path,fi.size() - 4);
+
+        // Every preset is there, but the archive may have had more
+        DcPresetArchiveReader r;
+        QCOMPARE(readAll(path,r),40);
+        QVERIFY(!r.atEnd());
+
+        QList<DcMidiData> loaded;
+        QString errorMsg;
+        QVERIFY(!DcPresetArchive::load(path,loaded,errorMsg));
+        QVERIFY(!errorMsg.isEmpty());
+        QVERIFY(loaded.isEmpty());
+    }
+
+    void headerCountMismatch_data()
+    {
+        QTest::addColumn<int>("count");
+        QTest::addColumn<quint32>("recorded");
+
+        QTest::newRow("more recorded") << 40 << quint32(41);
+        QTest::newRow("fewer recorded") << 40 << quint32(39);
+        QTest::newRow("frame boundary") << 32 << quint32(33);
+    }
+
+    void headerCountMismatch()
+    {
+        QFETCH(int,count);
+        QFETCH(quint32,recorded);
+
+        QString path = save("count.syz",count);
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.seek(countOffset()));
+        QDataStream out(&file);
+        out << recorded;
+        file.close();
+
+        // The frames themselves are intact
+        DcPresetArchiveReader r;
+        QCOMPARE(readAll(path,r),count);
+        QVERIFY(r.atEnd());
+        QCOMPARE(r.header().PresetCount,recorded);
+
+        QList<DcMidiData> loaded;
+        QString errorMsg;
+        QVERIFY(!DcPresetArchive::load(path,loaded,errorMsg));
+        QVERIFY(!errorMsg.isEmpty());
+        QVERIFY(loaded.isEmpty());
+    }
+};
+
+QTEST_MAIN(t_DcPresetArchive);
+
+#include "t_presetarchive.moc"
@@ -0,0 +1,6 @@
+TARGET = t_presetsimilarity
+include("../tests.pri")
+SOURCES += $$LIB_DIR/DcMidi/DcMidiData.cpp
+SOURCES += $$SPL_DIR/DcPresetDiff.cpp
+SOURCES += $$SPL_DIR/DcPresetSimilarity.cpp
+SOURCES += t_presetsimilarity.cpp
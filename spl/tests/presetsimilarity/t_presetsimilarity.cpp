@@ -0,0 +1,191 @@
+#include <QtTest>
+#include <random>
+#include <algorithm>
+
+#include "DcPresetSimilarity.h"
+
+class t_DcPresetSimilarity: public QObject
+{
+    Q_OBJECT
+
+    // A base preset with a few bytes changed, for the given product
+    DcMidiData variant( quint8 product,int number,const QList<QPair<int,char> >& changes )
+    {
+        QByteArray ba = DcMidiData("F0 00 01 55 12").toByteArray();
+        ba.append(char(product)).append(char(0x62));
+        ba.append(char(number >> 7)).append(char(number & 0x7F));
+        for (int i = ba.size(); i < 649; i++)
+        {
+            ba.append(char((i * 11) & 0x7F));
+        }
+        ba.append(char(0xF7));
+
+        for (int c = 0; c < changes.size(); c++)
+        {
+            ba[changes.at(c).first] = changes.at(c).second;
+        }
+        return DcMidiData(ba);
+    }
+
+    // Presets that mostly differ in the lowest few of a set of hot bytes,
+    // so most of them share every other band and those buckets are far
+    // over kMaxBucket
+    QList<DcMidiData> generate( int count,quint32 seed )
+    {
+        std::mt19937 rng(seed);
+        const DcPresetSchema::Layout& schema = DcPresetSchema::defaultLayout();
+        int begin = schema.offset(DcPresetSchema::Data);
+        int end = schema.offset(DcPresetSchema::Name);
+
+        QVector<int> hot;
+        for (int h = 0; h < 40; h++)
+        {
+            hot << begin + int(rng() % (end - begin));
+        }
+        std::sort(hot.begin(),hot.end());
+
+        QList<DcMidiData> presets;
+        for (int n = 0; n < count; n++)
+        {
+            QList<QPair<int,char> > changes;
+            int changeCount = 1 + rng() % 3;
+            for (int c = 0; c < changeCount; c++)
+            {
+                int pos = (rng() % 10) ? hot.at(rng() % 5) : hot.at(rng() % hot.size());
+                changes << qMakePair(pos,char(rng() % 32));
+            }
+            presets << variant(0x01,n % 200,changes);
+        }
+
+        // Another device with the same parameters never matches these
+        for (int n = 0; n < 20; n++)
+        {
+            presets << variant(0x02,n,QList<QPair<int,char> >());
+        }
+
+        // Too short to hold the parameters
+        presets << DcMidiData(presets.first().toByteArray().left(100));
+        return presets;
+    }
+
+    // Groups from every pair, as sorted member lists
+    QList<QList<int> > bruteForce( const DcPresetSimilarity& sim,const QList<DcMidiData>& presets,int maxDiff )
+    {
+        QVector<int> parent(presets.size());
+        for (int i = 0; i < parent.size(); i++)
+        {
+            parent[i] = i;
+        }
+        auto rootOf = [&parent]( int i ) { while(parent.at(i) != i) i = parent.at(i); return i; };
+
+        for (int i = 0; i < presets.size(); i++)
+        {
+            for (int j = i + 1; j < presets.size(); j++)
+            {
+                if(sim.paramDiff(presets.at(i),presets.at(j)) <= maxDiff)
+                {
+                    int ri = rootOf(i);
+                    int rj = rootOf(j);
+                    if(ri != rj)
+                    {
+                        parent[qMax(ri,rj)] = qMin(ri,rj);
+                    }
+                }
+            }
+        }
+
+        QMap<int,QList<int> > byRoot;
+        for (int i = 0; i < presets.size(); i++)
+        {
+            byRoot[rootOf(i)].append(i);
+        }
+
+        QList<QList<int> > groups;
+        foreach(const QList<int>& g,byRoot)
+        {
+            if(g.size() > 1)
+            {
+                groups << g;
+            }
+        }
+        std::sort(groups.begin(),groups.end());
+        return groups;
+    }
+
+    QList<QList<int> > membersOf( const QList<DcPresetSimilarity::Cluster>& clusters )
+    {
+        QList<QList<int> > groups;
+        foreach(const DcPresetSimilarity::Cluster& c,clusters)
+        {
+            QList<int> members = c.Members;
+            std::sort(members.begin(),members.end());
+            groups << members;
+        }
+        std::sort(groups.begin(),groups.end());
+        return groups;
+    }
+
+private slots:
+
+    void paramDiff()
+    {
+        DcPresetSimilarity sim;
+        QList<QPair<int,char> > changes;
+        DcMidiData a = variant(0x01,0,changes);
+
+        changes << qMakePair(100,char(0x7E)) << qMakePair(200,char(0x7E));
+        DcMidiData b = variant(0x01,5,changes);
+        QCOMPARE(sim.paramDiff(a,b),2);
+
+        // The name is not a parameter
+        changes.clear();
+        changes << qMakePair(DcPresetSchema::defaultLayout().offset(DcPresetSchema::Name),'X');
+        QCOMPARE(sim.paramDiff(a,variant(0x01,0,changes)),0);
+
+        // Other devices and short presets differ everywhere
+        DcMidiData other = variant(0x02,0,QList<QPair<int,char> >());
+        QVERIFY(sim.paramDiff(a,other) > 600);
+        QVERIFY(sim.paramDiff(a,DcMidiData(a.toByteArray().left(100))) > 600);
+    }
+
+    void matchesBruteForce_data()
+    {
+        QTest::addColumn<int>("count");
+        QTest::addColumn<int>("maxDiff");
+        QTest::addColumn<quint32>("seed");
+
+        QTest::newRow("exact only") << 800 << 0 << quint32(1);
+        QTest::newRow("one byte") << 800 << 1 << quint32(2);
+        QTest::newRow("two bytes") << 800 << 2 << quint32(3);
+        QTest::newRow("four bytes") << 600 << 4 << quint32(4);
+    }
+
+    void matchesBruteForce()
+    {
+        QFETCH(int,count);
+        QFETCH(int,maxDiff);
+        QFETCH(quint32,seed);
+
+        QList<DcMidiData> presets = generate(count,seed);
+        DcPresetSimilarity sim;
+        QList<DcPresetSimilarity::Cluster> clusters = sim.find(presets,maxDiff);
+
+        // The set must exercise the bucket splitting
+        if(maxDiff > 0)
+        {
+            QVERIFY(sim.splitBuckets() > 0);
+        }
+
+        QVERIFY(!clusters.isEmpty());
+        QCOMPARE(membersOf(clusters),bruteForce(sim,presets,maxDiff));
+
+        foreach(const DcPresetSimilarity::Cluster& c,clusters)
+        {
+            QVERIFY(c.MaxDiff <= maxDiff);
+        }
+    }
+};
+
+QTEST_MAIN(t_DcPresetSimilarity);
+
+#include "t_presetsimilarity.moc"
@@ -0,0 +1,5 @@
+TARGET = t_sysexrejectfilter
+include("../tests.pri")
+SOURCES += $$LIB_DIR/DcMidi/DcMidiData.cpp
+SOURCES += $$SPL_DIR/DcSysexRejectFilter.cpp
+SOURCES += t_sysexrejectfilter.cpp
@@ -0,0 +1,165 @@
+#include <QtTest>
+#include <random>
+
+#include "DcSysexRejectFilter.h"
+
+class t_DcSysexRejectFilter: public QObject
+{
+    Q_OBJECT
+
+    DcSysexRejectFilter filterOf( const char* p1,const char* p2 = 0,const char* p3 = 0 )
+    {
+        QList<DcMidiData> patterns;
+        patterns << DcMidiData(p1);
+        if(p2) patterns << DcMidiData(p2);
+        if(p3) patterns << DcMidiData(p3);
+
+        DcSysexRejectFilter f;
+        f.compile(patterns);
+        return f;
+    }
+
+private slots:
+
+    void emptyFilter()
+    {
+        DcSysexRejectFilter f;
+        QVERIFY(f.isEmpty());
+        QVERIFY(!f.rejects(DcMidiData("F0 01 02 F7")));
+
+        f.compile(QList<DcMidiData>() << DcMidiData());
+        QVERIFY(f.isEmpty());
+        QVERIFY(!f.rejects(DcMidiData("F0 01 02 F7")));
+
+        f = filterOf("01 02");
+        QVERIFY(!f.isEmpty());
+        f.clear();
+        QVERIFY(f.isEmpty());
+        QVERIFY(!f.rejects(DcMidiData("F0 01 02 F7")));
+    }
+
+    void overlappingPatterns()
+    {
+        // The second pattern starts inside the first
+        DcSysexRejectFilter f = filterOf("01 02 03 04","02 03 05");
+        QVERIFY(f.rejects(DcMidiData("F0 01 02 03 04 F7")));
+        QVERIFY(f.rejects(DcMidiData("F0 01 02 03 05 F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 01 02 03 06 F7")));
+
+        // A short pattern inside a longer one is found part way along it
+        f = filterOf("01 02 03 04","02");
+        QVERIFY(f.rejects(DcMidiData("F0 01 02 05 F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 01 03 04 F7")));
+
+        // Patterns that share a suffix
+        f = filterOf("11 22 33","22 33","33");
+        QVERIFY(f.rejects(DcMidiData("F0 33 F7")));
+        QVERIFY(f.rejects(DcMidiData("F0 44 22 33 F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 11 22 F7")));
+
+        // Repeated bytes need the failure links to back up one byte
+        f = filterOf("05 05 06");
+        QVERIFY(f.rejects(DcMidiData("F0 05 05 05 06 F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 05 06 05 F7")));
+    }
+
+    void patternAtStartAndEnd()
+    {
+        DcSysexRejectFilter f = filterOf("F0 00 01 55 10","7E F7");
+        QVERIFY(f.rejects(DcMidiData("F0 00 01 55 10 01 F7")));
+        QVERIFY(f.rejects(DcMidiData("F0 00 01 55 12 7E F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 00 01 55 12 7E 00 F7")));
+
+        // The last byte of the message completes the match
+        f = filterOf("01 F7");
+        QVERIFY(f.rejects(DcMidiData("F0 00 01 F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 01 00 F7")));
+
+        // The first byte of the message starts it
+        f = filterOf("F0 01");
+        QVERIFY(f.rejects(DcMidiData("F0 01 02 F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 02 01 F7")));
+    }
+
+    void wholeMessageVsSubstring()
+    {
+        // A complete message only matches itself
+        DcSysexRejectFilter f = filterOf("F0 01 02 F7");
+        QVERIFY(f.rejects(DcMidiData("F0 01 02 F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 01 02 03 F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 00 01 02 F7")));
+
+        // Without the F7 it is a prefix like any other pattern
+        f = filterOf("F0 01 02");
+        QVERIFY(f.rejects(DcMidiData("F0 01 02 F7")));
+        QVERIFY(f.rejects(DcMidiData("F0 01 02 03 F7")));
+
+        // A message boundary inside the pattern makes it a substring
+        f = filterOf("02 F7 F0 03");
+        QVERIFY(f.rejects(DcMidiData("F0 01 02 F7 F0 03 F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 02 F7")));
+
+        // Both kinds together
+        f = filterOf("F0 01 02 F7","7F 7F");
+        QVERIFY(f.rejects(DcMidiData("F0 01 02 F7")));
+        QVERIFY(f.rejects(DcMidiData("F0 7F 7F F7")));
+        QVERIFY(!f.rejects(DcMidiData("F0 01 7F F7")));
+    }
+
+    void parityWithContains()
+    {
+        // A small alphabet makes overlaps and partial matches common
+        std::mt19937 rng(20130);
+        const char alphabet[] = { 0x01,0x02,0x03,0x7F };
+
+        for (int round = 0; round < 50; round++)
+        {
+            QList<DcMidiData> patterns;
+            int patternCount = 1 + rng() % 8;
+            for (int p = 0; p < patternCount; p++)
+            {
+                QByteArray ba;
+                int len = 1 + rng() % 4;
+                for (int i = 0; i < len; i++)
+                {
+                    ba.append(alphabet[rng() % sizeof(alphabet)]);
+                }
+
+                // Some patterns are complete messages
+                if(rng() % 4 == 0)
+                {
+                    ba.prepend((char)0xF0);
+                    ba.append((char)0xF7);
+                }
+                patterns << DcMidiData(ba);
+            }
+
+            DcSysexRejectFilter f;
+            f.compile(patterns);
+
+            for (int m = 0; m < 200; m++)
+            {
+                QByteArray ba;
+                ba.append((char)0xF0);
+                int len = rng() % 10;
+                for (int i = 0; i < len; i++)
+                {
+                    ba.append(alphabet[rng() % sizeof(alphabet)]);
+                }
+                ba.append((char)0xF7);
+                DcMidiData md(ba);
+
+                bool expected = false;
+                foreach(const DcMidiData& p,patterns)
+                {
+                    expected = expected || md.contains(p);
+                }
+                QCOMPARE(f.rejects(md),expected);
+            }
+        }
+    }
+};
+
+QTEST_MAIN(t_DcSysexRejectFilter);
+
+#include "t_sysexrejectfilter.moc"
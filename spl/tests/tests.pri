@@ -0,0 +1,9 @@
+# Each test builds the few spl and DcMidi sources it needs
+QT += core testlib
+TEMPLATE = app
+CONFIG += c++11
+
+SPL_DIR = $$PWD/..
+LIB_DIR = $$PWD/../../lib
+
+INCLUDEPATH += $$SPL_DIR $$LIB_DIR $$LIB_DIR/DcMidi